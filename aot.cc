@@ -0,0 +1,675 @@
+#include "aot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#include <dlfcn.h>
+
+#ifndef XEOUZ_AOT_INCLUDE_DIR
+#define XEOUZ_AOT_INCLUDE_DIR "."
+#endif
+
+namespace xeouz
+{
+
+namespace
+{
+
+// Every byte that is not plainly printable is written as a 3 digit octal escape, so `value` can hold anything
+std::string quote(std::string_view value)
+{
+    std::string quoted = "\"";
+    for(unsigned char c: value)
+    {
+        if(c >= ' ' && c <= '~' && c != '"' && c != '\\' && c != '?')
+        {
+            quoted += (char)c;
+            continue;
+        }
+        char escape[8];
+        std::snprintf(escape, sizeof(escape), "\\%03o", c);
+        quoted += escape;
+    }
+    return quoted + "\"";
+}
+std::string quoteString(std::string_view value)
+{
+    return "std::string("+quote(value)+", "+std::to_string(value.size())+")";
+}
+// Hexadecimal floating point literals keep every bit of the value
+std::string number(double value)
+{
+    if(std::isnan(value))
+        return "std::numeric_limits<double>::quiet_NaN()";
+    if(std::isinf(value))
+        return value > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+
+    char literal[64];
+    std::snprintf(literal, sizeof(literal), "%a", value);
+    return literal;
+}
+
+// Every header in `include_dir` with its name, the generated code is built against them
+std::string readHeaders(std::string const& include_dir)
+{
+    std::error_code error;
+    std::vector<std::filesystem::path> paths;
+    for(auto const& entry: std::filesystem::directory_iterator(include_dir, error))
+        if(entry.path().extension() == ".h")
+            paths.push_back(entry.path());
+    std::sort(paths.begin(), paths.end());
+
+    std::string headers;
+    for(auto const& path: paths)
+    {
+        std::ifstream file(path, std::ios::binary);
+        headers += path.filename().string()+"\n";
+        headers.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    return headers;
+}
+
+Value take(AotValue value)
+{
+    if(value.type == VT_NUMBER)
+        return Value::createNumber(value.number);
+    return Value::createOwned(std::unique_ptr<VariableDataBase>(value.object));
+}
+// A borrowed object is copied, the AotValue owns what it points to
+AotValue release(Value value)
+{
+    if(value.isNumber())
+        return AotValue{VT_NUMBER, value.getNumber(), nullptr};
+    int type = value.getType();
+    return AotValue{type, 0, value.take().takeData().release()};
+}
+
+}
+
+///--- AOT Runtime ---///
+AotRuntime::AotRuntime(Interpreter& _interpreter): interpreter(_interpreter)
+{
+
+}
+
+AotRuntime::Slot* const AotRuntime::addSlot(char const* name)
+{
+    slots.push_back(Slot{name, nullptr});
+    return &slots.back();
+}
+void AotRuntime::resolveSlots()
+{
+    for(auto& slot: slots)
+    {
+        auto it = interpreter.memory.find(slot.name);
+        slot.value = it == interpreter.memory.end() ? nullptr : &it->second;
+    }
+}
+FCIFunction* const AotRuntime::getFunction(char const* name)
+{
+    if(!interpreter.isFunctionDefined(name))
+        return nullptr;
+    return interpreter.getFunction(name);
+}
+
+AotValue AotRuntime::error(std::string const& message)
+{
+    interpreter.LogError(message);
+    return AotValue{-1, 0, nullptr};
+}
+AotValue AotRuntime::string(std::string value)
+{
+    return AotValue{VT_STRING, 0, new VariableStringData(value)};
+}
+AotValue AotRuntime::variable(Slot* slot)
+{
+    if(!slot->value)
+        return error(std::string("INTERPRETER: interpretVariable(): Variable `")+slot->name+"` is not defined");
+    return release(slot->value->borrow());
+}
+// Everything but number operators, through the interpreter
+AotValue AotRuntime::binary(int op, AotValue lhs, AotValue rhs)
+{
+    Value l = take(lhs);
+    Value r = take(rhs);
+    if(!l || !r)
+        return error("INTERPRETER: interpretBinaryOperation(): Binary operation has invalid LHS or RHS");
+    return release(interpreter.useBinaryOperation(op, l, r));
+}
+double AotRuntime::modulo(double lhs, double rhs)
+{
+    return (long)lhs % (long)rhs;
+}
+AotValue AotRuntime::sequence(std::uint32_t index)
+{
+    std::vector<FunctionCallAST*> calls;
+    for(auto&& call: sequences[index]->getBody())
+        calls.push_back(call.get());
+    return AotValue{VT_SEQUENCE, 0, new VariableSequenceData(calls)};
+}
+
+// The arguments go on the interpreter's `call_arguments`, like the tree walker's
+bool AotRuntime::begin(FCIFunction* function, char const* name)
+{
+    calls.push_back(Call{function, name, interpreter.call_arguments.size()});
+    if(function)
+        return true;
+    error(std::string("INTERPRETER: interpretFunctionCall(): Function `")+name+"` was not found");
+    return false;
+}
+bool AotRuntime::argument(AotValue value)
+{
+    auto& call = calls.back();
+    auto& stack = interpreter.call_arguments;
+    Value val = take(value);
+    if(!val)
+    {
+        error(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+call.name+"`, argument at index "+std::to_string(stack.size() - call.base)+" is invalid");
+        return false;
+    }
+    stack.push_back(std::move(val));
+    return true;
+}
+AotValue AotRuntime::call(bool ready)
+{
+    Call call = calls.back();
+    calls.pop_back();
+    auto& stack = interpreter.call_arguments;
+    Value result;
+    if(ready)
+        result = call.function->callValues(stack.data() + call.base, stack.size() - call.base);
+    stack.erase(stack.begin() + call.base, stack.end());
+    if(!ready)
+        return AotValue{-1, 0, nullptr};
+    return release(std::move(result));
+}
+
+bool AotRuntime::definable(Slot* slot)
+{
+    if(!slot->value)
+        return true;
+    interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)")+slot->name+"` is already defined");
+    return false;
+}
+bool AotRuntime::assignable(Slot* slot)
+{
+    if(slot->value)
+        return true;
+    interpreter.LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+slot->name+"` is not defined");
+    return false;
+}
+void AotRuntime::define(Slot* slot, AotValue value)
+{
+    Value val = take(value);
+    if(!val)
+    {
+        interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `")+slot->name+"`");
+        return;
+    }
+    slot->value = &interpreter.memory.emplace(slot->name, std::move(val)).first->second;
+}
+void AotRuntime::store(Slot* slot, AotValue value, int shorthand_operator)
+{
+    interpreter.assignVariable(*slot->value, slot->name, take(value), shorthand_operator);
+}
+
+bool AotRuntime::condition(AotValue value)
+{
+    Value val = take(value);
+    if(!val.isNumber())
+    {
+        interpreter.LogError("INTERPRETER: interpretIf(): Expression in if conditional is not of type number");
+        return false;
+    }
+    return val.getNumber() > 0;
+}
+bool AotRuntime::times(AotValue value, double& times)
+{
+    Value val = take(value);
+    if(!val)
+    {
+        interpreter.LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of valid");
+        return false;
+    }
+    if(!val.isNumber())
+    {
+        interpreter.LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of type number");
+        return false;
+    }
+    times = val.getNumber();
+    return true;
+}
+// Sequence values hold ASTs, their calls run on the tree walker
+bool AotRuntime::runSequence(Slot* slot)
+{
+    if(!slot->value)
+    {
+        interpreter.LogError(std::string("INTERPRETER: interpretVariable(): Variable `")+slot->name+"` is not defined");
+        interpreter.LogError("INTERPRETER: interpretDoFor(): Sequence variable given is invalid");
+        return false;
+    }
+    if(slot->value->getType() != VT_SEQUENCE)
+    {
+        interpreter.LogError("INTERPRETER: interpretDoFor(): Sequence variable given is not of type <sequence>");
+        return false;
+    }
+
+    auto* seq = slot->value->getSequence();
+    for(auto* call: seq->getValue())
+        interpreter.interpretFunctionCall(call);
+    for(auto call: seq->getPoolCalls())
+        interpreter.interpretPoolFunctionCall(call);
+    return true;
+}
+
+ASTBase* AotRuntime::numberAST(double value)
+{
+    return new NumberAST(value);
+}
+ASTBase* AotRuntime::stringAST(std::string value)
+{
+    return new StringAST(value);
+}
+ASTBase* AotRuntime::variableAST(char const* name)
+{
+    return new VariableAST(name);
+}
+ASTBase* AotRuntime::binaryAST(int op, ASTBase* lhs, ASTBase* rhs)
+{
+    return new BinaryOperationAST(op, std::unique_ptr<ASTBase>(lhs), std::unique_ptr<ASTBase>(rhs));
+}
+FunctionCallAST* AotRuntime::callAST(char const* name, std::vector<ASTBase*> arguments)
+{
+    ASTList<ASTBase> args;
+    for(auto* arg: arguments)
+        args.push_back(std::unique_ptr<ASTBase>(arg));
+    return new FunctionCallAST(name, std::move(args));
+}
+ASTBase* AotRuntime::sequenceAST(std::vector<FunctionCallAST*> calls)
+{
+    ASTList<FunctionCallAST> body;
+    for(auto* call: calls)
+        body.push_back(std::unique_ptr<FunctionCallAST>(call));
+    return new SequenceAST(std::move(body));
+}
+void AotRuntime::addSequence(std::vector<FunctionCallAST*> calls)
+{
+    sequences.push_back(std::unique_ptr<SequenceAST>((SequenceAST*)sequenceAST(std::move(calls))));
+}
+///--- AOT Runtime ---///
+
+///--- AOT Compiler ---///
+std::string const getAotIncludeDirectory()
+{
+    return XEOUZ_AOT_INCLUDE_DIR;
+}
+
+AotCompiler::AotCompiler(Interpreter& _interpreter): interpreter(_interpreter), lazy_failures(0)
+{
+
+}
+
+std::uint32_t const AotCompiler::slot(std::string_view name)
+{
+    auto it = slot_ids.find(std::string(name));
+    if(it != slot_ids.end())
+        return it->second;
+    std::uint32_t id = slot_names.size();
+    slot_ids.emplace(std::string(name), id);
+    slot_names.emplace_back(name);
+    return id;
+}
+std::uint32_t const AotCompiler::function(std::string_view name)
+{
+    auto it = function_ids.find(std::string(name));
+    if(it != function_ids.end())
+        return it->second;
+    std::uint32_t id = function_names.size();
+    function_ids.emplace(std::string(name), id);
+    function_names.emplace_back(name);
+    return id;
+}
+
+// An expression building `ast` again at runtime, for the sequence values that carry it
+std::string AotCompiler::lowerAST(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        default: return "nullptr";
+        case AST_NUMBER: return "rt.numberAST("+number(((NumberAST*)ast)->getValue())+")";
+        case AST_STRING: return "rt.stringAST("+quoteString(((StringAST*)ast)->getValue())+")";
+        case AST_VAR: return "rt.variableAST("+quote(((VariableAST*)ast)->getName())+")";
+        case AST_BINOP: {
+            auto* binop = (BinaryOperationAST*)ast;
+            return "rt.binaryAST("+std::to_string(binop->getOperator())+", "+lowerAST(binop->getLHS())+", "+lowerAST(binop->getRHS())+")";
+        }
+        case AST_CALL: {
+            auto* call = (FunctionCallAST*)ast;
+            std::string arguments;
+            for(auto&& arg: call->getArguments())
+                arguments += (arguments.empty() ? "" : ", ")+lowerAST(arg.get());
+            return "rt.callAST("+quote(call->getName())+", {"+arguments+"})";
+        }
+        case AST_SEQUENCE: {
+            std::string calls;
+            for(auto&& call: ((SequenceAST*)ast)->getBody())
+                calls += (calls.empty() ? "" : ", ")+lowerAST(call.get());
+            return "rt.sequenceAST({"+calls+"})";
+        }
+    }
+}
+std::string AotCompiler::lowerExpression(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        default: return "rt.error("+quote("INTERPRETER: interpretExpression(): Unable to interpret invalid AST type `"+ast->toString()+"`")+")";
+        case AST_NUMBER: return "AotRuntime::number("+number(((NumberAST*)ast)->getValue())+")";
+        case AST_STRING: return "rt.string("+quoteString(((StringAST*)ast)->getValue())+")";
+        case AST_VAR: return "rt.variable(st.s"+std::to_string(slot(((VariableAST*)ast)->getName()))+")";
+        case AST_CALL: return lowerCall((FunctionCallAST*)ast);
+        case AST_BINOP: return lowerBinary((BinaryOperationAST*)ast);
+        case AST_SEQUENCE: {
+            std::string calls;
+            for(auto&& call: ((SequenceAST*)ast)->getBody())
+                calls += (calls.empty() ? "" : ", ")+lowerAST(call.get());
+            sequences.push_back("rt.addSequence({"+calls+"});");
+            return "rt.sequence("+std::to_string(sequences.size()-1)+")";
+        }
+    }
+}
+// The braced operands are evaluated left to right
+std::string AotCompiler::lowerBinary(BinaryOperationAST* ast)
+{
+    return "rt.operate<"+std::to_string(ast->getOperator())+">({"+lowerExpression(ast->getLHS())+", "+lowerExpression(ast->getRHS())+"})";
+}
+// The && chain stops at a missing function or the first invalid argument, after it logged that
+std::string AotCompiler::lowerCall(FunctionCallAST* ast)
+{
+    std::string name(ast->getName());
+    std::string code = "rt.call(rt.begin(st.f"+std::to_string(function(name))+", "+quote(name)+")";
+    for(auto&& arg: ast->getArguments())
+        code += " && rt.argument("+lowerExpression(arg.get())+")";
+    return code+")";
+}
+
+void AotCompiler::lowerBody(ASTList<ASTBase> const& body, std::string const& indent)
+{
+    for(auto&& stm: body)
+        lowerStatement(stm.get(), indent);
+}
+void AotCompiler::lowerStatement(ASTBase* ast, std::string const& indent)
+{
+    switch(ast->type)
+    {
+        default: {
+            code += indent+"rt.error("+quote("INTERPRETER: interpretPrimary(): Unable to interpret invalid AST type `"+ast->toString()+"`")+");\n";
+            break;
+        }
+        case AST_VARDEF: lowerDefinition((VariableDefinitionAST*)ast, indent); break;
+        case AST_VARASSIGN: lowerAssignment((VariableAssignmentAST*)ast, indent); break;
+        case AST_IFELSE: lowerIfElse((IfElseAST*)ast, indent); break;
+        case AST_DOFOR: lowerDoFor((DoForAST*)ast, indent); break;
+        case AST_CALL: code += indent+lowerCall((FunctionCallAST*)ast)+";\n"; break;
+    }
+}
+// The variable is checked before the value is evaluated
+void AotCompiler::lowerDefinition(VariableDefinitionAST* ast, std::string const& indent)
+{
+    std::string slot = "st.s"+std::to_string(AotCompiler::slot(ast->getName()));
+    code += indent+"if(rt.definable("+slot+"))\n";
+    code += indent+"    rt.define("+slot+", "+lowerExpression(ast->getValue())+");\n";
+}
+void AotCompiler::lowerAssignment(VariableAssignmentAST* ast, std::string const& indent)
+{
+    std::string slot = "st.s"+std::to_string(AotCompiler::slot(ast->getName()));
+    code += indent+"if(rt.assignable("+slot+"))\n";
+    code += indent+"    rt.assign<"+std::to_string(ast->getShorthandOperator())+">("+slot+", "+lowerExpression(ast->getValue())+");\n";
+}
+// Pending lazy bodies are parsed now, nullptr when one does not
+ASTList<ASTBase> const* AotCompiler::resolveBody(ASTBase* owner, LazyBody const& lazy, ASTList<ASTBase> const& body)
+{
+    if(!lazy.isPending())
+        return &body;
+
+    ArenaScope scope(owner->getArena());
+    ASTList<ASTBase> statements(Arena::getActiveResource());
+    if(!interpreter.getParser()->ParseLazyBody(lazy, statements))
+        return nullptr;
+    lazy_bodies.push_back(std::move(statements));
+    return &lazy_bodies.back();
+}
+void AotCompiler::lowerBranch(ASTBase* owner, LazyBody const& lazy, ASTList<ASTBase> const& body, char const* name, std::string const& indent)
+{
+    auto* statements = resolveBody(owner, lazy, body);
+    if(statements)
+    {
+        lowerBody(*statements, indent);
+        return;
+    }
+
+    // Logged the first time it runs, like Interpreter::parseLazyBody, then it runs as an empty body
+    std::string flag = "st.lazy"+std::to_string(lazy_failures++);
+    code += indent+"if(!"+flag+")\n";
+    code += indent+"{\n";
+    code += indent+"    "+flag+" = true;\n";
+    code += indent+"    rt.error("+quote(std::string("INTERPRETER: parseLazyBody(): Could not parse the ")+name+" body")+");\n";
+    code += indent+"}\n";
+}
+// A do-while so a taken branch can break past the others
+void AotCompiler::lowerIfElse(IfElseAST* ast, std::string const& indent)
+{
+    code += indent+"do\n";
+    code += indent+"{\n";
+    for(auto&& ifstm: ast->getIfStatements())
+    {
+        code += indent+"    if(rt.condition("+lowerExpression(ifstm->getExpression())+"))\n";
+        code += indent+"    {\n";
+        lowerBranch(ifstm.get(), ifstm->getLazyBody(), ifstm->getBody(), "if", indent+"        ");
+        code += indent+"        break;\n";
+        code += indent+"    }\n";
+    }
+    lowerBranch(ast, ast->getLazyElseBody(), ast->getElseBody(), "else", indent+"    ");
+    code += indent+"}\n";
+    code += indent+"while(false);\n";
+}
+// The sequences share one loop body, a sequence variable that fails breaks out of the whole do-for
+void AotCompiler::lowerDoFor(DoForAST* ast, std::string const& indent)
+{
+    code += indent+"{\n";
+    code += indent+"    double times;\n";
+    code += indent+"    if(rt.times("+lowerExpression(ast->getForTimes())+", times))\n";
+    code += indent+"    {\n";
+    code += indent+"        for(int i=0; i<times; ++i)\n";
+    code += indent+"        {\n";
+    for(auto&& seq: ast->getSequences())
+    {
+        if(seq->type == AST_SEQUENCE)
+        {
+            for(auto&& call: ((SequenceAST*)seq.get())->getBody())
+                code += indent+"            "+lowerCall(call.get())+";\n";
+        }
+        else if(seq->type == AST_VAR)
+        {
+            code += indent+"            if(!rt.runSequence(st.s"+std::to_string(slot(((VariableAST*)seq.get())->getName()))+"))\n";
+            code += indent+"                break;\n";
+        }
+    }
+    code += indent+"        }\n";
+    code += indent+"    }\n";
+    code += indent+"}\n";
+}
+
+// Every top-level statement is a function of its own, compilers take far longer on one huge function
+std::string AotCompiler::lower(MainAST* const main)
+{
+    auto const& statements = main->getBody();
+    std::string body;
+    for(std::size_t i=0; i<statements.size(); ++i)
+    {
+        code.clear();
+        lowerStatement(statements[i].get(), "    ");
+        body += "void statement"+std::to_string(i)+"(AotRuntime& rt, Bindings& st)\n{\n"+code+"}\n";
+    }
+
+    code = "// Generated from `"+std::string(main->getProgramName())+"` by xeouz::AotCompiler\n";
+    code += "#include <limits>\n\n#include \"aot.h\"\n\nusing namespace xeouz;\n\nnamespace\n{\n\n";
+    code += "struct Bindings\n{\n";
+    for(std::size_t i=0; i<slot_names.size(); ++i)
+        code += "    AotRuntime::Slot* s"+std::to_string(i)+";\n";
+    for(std::size_t i=0; i<function_names.size(); ++i)
+        code += "    FCIFunction* f"+std::to_string(i)+";\n";
+    for(std::uint32_t i=0; i<lazy_failures; ++i)
+        code += "    bool lazy"+std::to_string(i)+";\n";
+    code += "};\n\n";
+    code += body;
+    code += "\n}\n\n";
+
+    code += "extern \"C\" void aphel_main(AotRuntime& rt)\n{\n";
+    code += "    Bindings st = {};\n";
+    for(std::size_t i=0; i<slot_names.size(); ++i)
+        code += "    st.s"+std::to_string(i)+" = rt.addSlot("+quote(slot_names[i])+");\n";
+    for(std::size_t i=0; i<function_names.size(); ++i)
+        code += "    st.f"+std::to_string(i)+" = rt.getFunction("+quote(function_names[i])+");\n";
+    for(auto const& seq: sequences)
+        code += "    "+seq+"\n";
+    code += "    rt.resolveSlots();\n\n";
+    for(std::size_t i=0; i<statements.size(); ++i)
+        code += "    statement"+std::to_string(i)+"(rt, st);\n";
+    code += "}\n\n";
+
+    code += "#ifdef XEOUZ_AOT_EXECUTABLE\n";
+    code += "#define IMPL_LANG_SYSLIB\n#include \"langlib.h\"\n\n";
+    code += "#ifdef XEOUZ_AOT_REGISTER_LIBRARIES\nvoid XEOUZ_AOT_REGISTER_LIBRARIES(xeouz::Interpreter* interpreter);\n#endif\n\n";
+    code += "int main()\n{\n";
+    code += "    auto interpreter = Interpreter::create(\"\");\n";
+    code += "    lib::registerLibraries(interpreter);\n";
+    code += "#ifdef XEOUZ_AOT_REGISTER_LIBRARIES\n    XEOUZ_AOT_REGISTER_LIBRARIES(interpreter.get());\n#endif\n\n";
+    code += "    AotRuntime rt(*interpreter);\n";
+    code += "    aphel_main(rt);\n";
+    code += "    return 0;\n}\n";
+    code += "#endif\n";
+    return std::move(code);
+}
+
+std::string AotCompiler::generate(Interpreter& interpreter, MainAST* const main)
+{
+    AotCompiler compiler(interpreter);
+    return compiler.lower(main);
+}
+bool AotCompiler::build(std::string const& source_path, std::string const& output_path, int output, AotOptions const& options)
+{
+    std::string command = options.compiler+" "+options.flags+" -I'"+options.include_dir+"'";
+    if(output == AO_SHARED)
+        command += " -shared -fPIC '"+source_path+"'";
+    else
+    {
+        command += " -DXEOUZ_AOT_EXECUTABLE";
+        if(!options.register_libraries.empty())
+            command += " -DXEOUZ_AOT_REGISTER_LIBRARIES="+options.register_libraries;
+        command += " '"+source_path+"'";
+        for(auto const& link: options.link)
+            command += " '"+link+"'";
+        command += " -lstdc++ -lm -lpthread -ldl";
+    }
+    command += " -o '"+output_path+"'";
+
+    if(std::system(command.c_str()) != 0)
+    {
+        std::cout << "AOT: build(): Command `" << command << "` failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+///--- AOT Compiler ---///
+
+///--- AOT Module ---///
+AotModule::AotModule(void* _handle, AotEntry _entry): handle(_handle), entry(_entry)
+{
+
+}
+AotModule::~AotModule()
+{
+    runtimes.clear();
+    dlclose(handle);
+}
+
+void AotModule::run(Interpreter& interpreter)
+{
+    runtimes.push_back(std::make_unique<AotRuntime>(interpreter));
+    entry(*runtimes.back());
+}
+
+// The interpreter has to export its symbols to the module, the Makefile links it with -rdynamic
+std::unique_ptr<AotModule> AotModule::load(std::string const& path)
+{
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(!handle)
+    {
+        std::cout << "AOT: load(): Could not load `" << path << "`: " << dlerror() << std::endl;
+        return nullptr;
+    }
+
+    auto entry = (AotEntry)dlsym(handle, "aphel_main");
+    if(!entry)
+    {
+        std::cout << "AOT: load(): `" << path << "` does not define aphel_main" << std::endl;
+        dlclose(handle);
+        return nullptr;
+    }
+    return std::make_unique<AotModule>(handle, entry);
+}
+std::unique_ptr<AotModule> AotModule::compile(Interpreter& interpreter, MainAST* const main, AotOptions const& options)
+{
+    std::string source = AotCompiler::generate(interpreter, main);
+
+    std::error_code error;
+    std::filesystem::path directory = options.cache_dir;
+    if(directory.empty())
+        directory = std::filesystem::temp_directory_path(error) / "aphel-aot";
+    std::filesystem::create_directories(directory, error);
+
+    // Keyed by everything that goes into the shared object, including the headers it is built against and the
+    // interpreter it links against
+    std::uint64_t headers = hashSource(readHeaders(options.include_dir));
+    std::uint64_t hash = hashSource(source+"\n"+options.compiler+" "+options.flags+" "+options.include_dir+" "+std::to_string(headers)+" "+std::to_string(getBuildID()));
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    std::string path = (directory / name).string();
+
+    if(!std::filesystem::is_regular_file(path+".so", error))
+    {
+        {
+            std::ofstream file(path+".cc", std::ios::binary | std::ios::trunc);
+            if(!file.write(source.data(), source.size()))
+            {
+                std::cout << "AOT: compile(): Could not write `" << path << ".cc`" << std::endl;
+                return nullptr;
+            }
+        }
+
+        // Renamed over the final name once built, a concurrent run loads either one
+        std::string temp_path = path + ".tmp" + std::to_string(std::random_device()());
+        if(!AotCompiler::build(path+".cc", temp_path, AO_SHARED, options))
+        {
+            std::filesystem::remove(temp_path, error);
+            return nullptr;
+        }
+        std::filesystem::rename(temp_path, path+".so", error);
+        if(error)
+        {
+            std::cout << "AOT: compile(): Could not replace `" << path << ".so`" << std::endl;
+            std::filesystem::remove(temp_path, error);
+            return nullptr;
+        }
+    }
+    return load(path+".so");
+}
+///--- AOT Module ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "interpret.h"
+
+namespace xeouz
+{
+
+///--- AOT Runtime ---///
+// A Value the generated code passes around. It is trivially destructible so its temporaries need no
+// cleanup, which keeps the generated code quick to compile; whoever it is passed to owns `object`.
+struct AotValue
+{
+    int type; // -1 for a failed expression
+    double number;
+    VariableDataBase* object;
+};
+// Built with braces, so the left operand is evaluated before the right one
+struct AotOperands
+{
+    AotValue lhs;
+    AotValue rhs;
+};
+
+// What the generated code calls into, it is linked against the interpreter that loads it. The messages are the
+// tree walker's. Number operators and assignments are inlined into the generated code, everything else goes
+// through the interpreter.
+class AotRuntime
+{
+public:
+    struct Slot
+    {
+        std::string name;
+        Value* value; // Into the interpreter's memory, nullptr while undefined
+    };
+private:
+    struct Call
+    {
+        FCIFunction* function;
+        char const* name;
+        std::size_t base; // Of its arguments on the interpreter's call_arguments
+    };
+
+    Interpreter& interpreter;
+    std::deque<Slot> slots;
+    std::vector<Call> calls; // Being evaluated, the innermost last
+    ASTList<SequenceAST> sequences; // Rebuilt from the generated code, sequence values point into them
+
+    // Number case of Interpreter::useBinaryOperation, false for operators it has none for
+    template <int op>
+    static bool const apply(double& lhs, double rhs)
+    {
+        switch(op)
+        {
+            default: return false;
+            case T_ADD: lhs = lhs + rhs; return true;
+            case T_SUB: lhs = lhs - rhs; return true;
+            case T_MUL: lhs = lhs * rhs; return true;
+            case T_DIV: lhs = lhs / rhs; return true;
+            case T_MOD: lhs = modulo(lhs, rhs); return true;
+            case T_DEQUAL: lhs = lhs == rhs; return true;
+            case T_NOTEQ: lhs = lhs != rhs; return true;
+            case T_LARROW: lhs = lhs < rhs; return true;
+            case T_RARROW: lhs = lhs > rhs; return true;
+            case T_LESSEQ: lhs = lhs <= rhs; return true;
+            case T_MOREEQ: lhs = lhs >= rhs; return true;
+        }
+    }
+    void store(Slot* slot, AotValue value, int shorthand_operator);
+public:
+    AotRuntime(Interpreter& interpreter);
+
+    Slot* const addSlot(char const* name);
+    void resolveSlots();
+    // nullptr when it is not registered, the call logs that when it runs
+    FCIFunction* const getFunction(char const* name);
+
+    AotValue error(std::string const& message);
+    static AotValue number(double value)
+    {
+        return AotValue{VT_NUMBER, value, nullptr};
+    }
+    AotValue string(std::string value);
+    AotValue variable(Slot* slot);
+    AotValue binary(int op, AotValue lhs, AotValue rhs);
+    template <int op>
+    AotValue operate(AotOperands operands)
+    {
+        if(operands.lhs.type == VT_NUMBER && operands.rhs.type == VT_NUMBER && apply<op>(operands.lhs.number, operands.rhs.number))
+            return operands.lhs;
+        return binary(op, operands.lhs, operands.rhs);
+    }
+    // Out of line, so a constant zero divisor still raises SIGFPE where it runs instead of being undefined
+    static double modulo(double lhs, double rhs);
+    AotValue sequence(std::uint32_t index);
+
+    // Generated as `call(begin(..) && argument(..) && ..)`, the chain stops after one of them logged why. Every
+    // begin is matched by a call.
+    bool begin(FCIFunction* function, char const* name);
+    bool argument(AotValue value);
+    AotValue call(bool ready);
+
+    // Log and return false when the statement does not go ahead, its value is only evaluated after they passed
+    bool definable(Slot* slot);
+    bool assignable(Slot* slot);
+    void define(Slot* slot, AotValue value);
+    // `op` is the shorthand operator, T_EOF for a plain assignment
+    template <int op>
+    void assign(Slot* slot, AotValue value)
+    {
+        auto* current = slot->value;
+        if(value.type == VT_NUMBER && current->isNumber())
+        {
+            if(op == T_EOF)
+            {
+                *current = Value::createNumber(value.number);
+                return;
+            }
+            double lhs = current->getNumber();
+            if(apply<op>(lhs, value.number))
+            {
+                *current = Value::createNumber(lhs);
+                return;
+            }
+        }
+        store(slot, value, op);
+    }
+
+    bool condition(AotValue value);
+    bool times(AotValue value, double& times);
+    // False when the do-for it belongs to has to stop
+    bool runSequence(Slot* slot);
+
+    ASTBase* numberAST(double value);
+    ASTBase* stringAST(std::string value);
+    ASTBase* variableAST(char const* name);
+    ASTBase* binaryAST(int op, ASTBase* lhs, ASTBase* rhs);
+    FunctionCallAST* callAST(char const* name, std::vector<ASTBase*> arguments);
+    ASTBase* sequenceAST(std::vector<FunctionCallAST*> calls);
+    void addSequence(std::vector<FunctionCallAST*> calls);
+};
+
+typedef void (*AotEntry)(AotRuntime& runtime);
+///--- AOT Runtime ---///
+
+///--- AOT Compiler ---///
+enum AotOutput
+{
+    AO_SHARED, // Loaded with AotModule into the running interpreter
+    AO_EXECUTABLE, // Creates its own interpreter, see AotOptions::link
+};
+
+// Where the generated translation units find this header and the ones it includes, define XEOUZ_AOT_INCLUDE_DIR
+// when building aot.cc to set it. The Makefile passes its own directory.
+std::string const getAotIncludeDirectory();
+
+struct AotOptions
+{
+    std::string compiler = "clang"; // The one the Makefile uses
+    std::string flags = "-O2 -std=c++17";
+    std::string include_dir = getAotIncludeDirectory();
+    std::string cache_dir; // Shared objects built by EB_AOT, the system's temporary directory when empty
+
+    // Executables only: the interpreter's objects and the ones defining `register_libraries`. The sys library
+    // is always registered, `register_libraries` names a `void (xeouz::Interpreter*)` that adds the others.
+    std::vector<std::string> link;
+    std::string register_libraries;
+};
+
+// Lowers a MainAST to a C++ translation unit defining `aphel_main`. Every statement and expression becomes
+// straight-line code, variables are slots into the interpreter's memory and calls go to its FCIFunctions.
+class AotCompiler
+{
+    Interpreter& interpreter;
+    std::string code;
+    std::unordered_map<std::string, std::uint32_t> slot_ids;
+    std::unordered_map<std::string, std::uint32_t> function_ids;
+    std::vector<std::string> slot_names;
+    std::vector<std::string> function_names;
+    std::vector<std::string> sequences; // Builder expressions of sequence literals used as values
+    std::deque<ASTList<ASTBase>> lazy_bodies; // Parsed here, the generated code does not parse
+    std::uint32_t lazy_failures; // Bodies that did not parse, each logs the first time it runs
+
+    std::uint32_t const slot(std::string_view name);
+    std::uint32_t const function(std::string_view name);
+
+    std::string lowerAST(ASTBase* ast);
+    std::string lowerExpression(ASTBase* ast);
+    std::string lowerBinary(BinaryOperationAST* ast);
+    std::string lowerCall(FunctionCallAST* ast);
+    void lowerBody(ASTList<ASTBase> const& body, std::string const& indent);
+    void lowerStatement(ASTBase* ast, std::string const& indent);
+    void lowerDefinition(VariableDefinitionAST* ast, std::string const& indent);
+    void lowerAssignment(VariableAssignmentAST* ast, std::string const& indent);
+    void lowerIfElse(IfElseAST* ast, std::string const& indent);
+    void lowerDoFor(DoForAST* ast, std::string const& indent);
+    ASTList<ASTBase> const* resolveBody(ASTBase* owner, LazyBody const& lazy, ASTList<ASTBase> const& body);
+    void lowerBranch(ASTBase* owner, LazyBody const& lazy, ASTList<ASTBase> const& body, char const* name, std::string const& indent);
+public:
+    AotCompiler(Interpreter& interpreter);
+
+    std::string lower(MainAST* const main);
+
+    static std::string generate(Interpreter& interpreter, MainAST* const main);
+    // Runs the configured compiler on `source_path`, false after logging its command when it fails
+    static bool build(std::string const& source_path, std::string const& output_path, int output, AotOptions const& options);
+};
+///--- AOT Compiler ---///
+
+///--- AOT Module ---///
+// A shared object built by AotCompiler, loaded into this process. Its runtimes, and the sequence values they made,
+// stay valid until the module is destroyed.
+class AotModule
+{
+    void* handle;
+    AotEntry entry;
+    std::vector<std::unique_ptr<AotRuntime>> runtimes;
+public:
+    AotModule(void* handle, AotEntry entry);
+    ~AotModule();
+
+    void run(Interpreter& interpreter);
+
+    static std::unique_ptr<AotModule> load(std::string const& path);
+    // Generates, builds and loads `main`, reusing a shared object built before for the same code and options
+    static std::unique_ptr<AotModule> compile(Interpreter& interpreter, MainAST* const main, AotOptions const& options);
+};
+///--- AOT Module ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "arena.h"
+
+#include <new>
+
+namespace xeouz
+{
+
+namespace
+{
+thread_local Arena* active_arena = nullptr;
+}
+
+///--- Arena ---///
+Arena::Arena(std::size_t initial_block_size)
+: current(nullptr), limit(nullptr), next_block_size(initial_block_size), bytes_allocated(0)
+{
+
+}
+Arena::~Arena()
+{
+    for(char* block: blocks)
+        ::operator delete(block);
+}
+
+void Arena::addBlock(std::size_t min_size)
+{
+    std::size_t size = next_block_size;
+    while(size < min_size)
+        size *= 2;
+    if(next_block_size < MaxBlockSize)
+        next_block_size *= 2;
+
+    char* block = (char*)::operator new(size);
+    blocks.push_back(block);
+    current = block;
+    limit = block + size;
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    std::size_t padding = (alignment - (std::size_t)current % alignment) % alignment;
+    if(!current || (std::size_t)(limit - current) < padding + bytes)
+    {
+        addBlock(bytes + alignment);
+        padding = (alignment - (std::size_t)current % alignment) % alignment;
+    }
+
+    char* ptr = current + padding;
+    current = ptr + bytes;
+    bytes_allocated += bytes;
+    return ptr;
+}
+void Arena::do_deallocate(void* /*ptr*/, std::size_t /*bytes*/, std::size_t /*alignment*/)
+{
+    // Released with the whole arena
+}
+bool Arena::do_is_equal(std::pmr::memory_resource const& other) const noexcept
+{
+    return this == &other;
+}
+
+void Arena::reset()
+{
+    for(char* block: blocks)
+        ::operator delete(block);
+    blocks.clear();
+    current = nullptr;
+    limit = nullptr;
+    bytes_allocated = 0;
+}
+
+std::size_t const Arena::getBytesAllocated() const
+{
+    return bytes_allocated;
+}
+std::size_t const Arena::getBlockCount() const
+{
+    return blocks.size();
+}
+
+Arena* Arena::getActive()
+{
+    return active_arena;
+}
+std::pmr::memory_resource* Arena::getActiveResource()
+{
+    if(active_arena)
+        return active_arena;
+    return std::pmr::new_delete_resource();
+}
+
+std::unique_ptr<Arena> Arena::create(std::size_t initial_block_size)
+{
+    return std::make_unique<Arena>(initial_block_size);
+}
+///--- Arena ---///
+
+///--- Arena Scope ---///
+ArenaScope::ArenaScope(Arena* arena): previous(active_arena)
+{
+    active_arena = arena;
+}
+ArenaScope::~ArenaScope()
+{
+    active_arena = previous;
+}
+///--- Arena Scope ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace xeouz
+{
+
+///--- Arena ---///
+// Bump allocator for everything one parsed program owns. Memory is only given back all at once
+// when the arena is destroyed or reset, so objects placed in it never need their destructors run.
+class Arena: public std::pmr::memory_resource
+{
+    std::vector<char*> blocks;
+    char* current;
+    char* limit;
+    std::size_t next_block_size;
+    std::size_t bytes_allocated;
+
+    void addBlock(std::size_t min_size);
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+public:
+    static constexpr std::size_t InitialBlockSize = 64 * 1024;
+    static constexpr std::size_t MaxBlockSize = 16 * 1024 * 1024;
+
+    Arena(std::size_t initial_block_size = InitialBlockSize);
+    ~Arena();
+
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+
+    void reset();
+
+    std::size_t const getBytesAllocated() const;
+    std::size_t const getBlockCount() const;
+
+    // The arena AST nodes created on this thread go into, nullptr for the heap
+    static Arena* getActive();
+    static std::pmr::memory_resource* getActiveResource();
+
+    static std::unique_ptr<Arena> create(std::size_t initial_block_size = InitialBlockSize);
+};
+
+// Makes `arena` the active one on this thread until the scope ends
+class ArenaScope
+{
+    Arena* previous;
+public:
+    ArenaScope(Arena* arena);
+    ~ArenaScope();
+
+    ArenaScope(ArenaScope const&) = delete;
+    ArenaScope& operator=(ArenaScope const&) = delete;
+};
+///--- Arena ---///
+
+}
\ No newline at end of file
@@ -1,25 +1,54 @@
 #include "ast.h"
 
+#include <cstring>
+#include <functional>
+
 namespace xeouz
 {
 
 ///--- Base AST ---///
-ASTBase::ASTBase(int ast_type, std::unique_ptr<Token> _token): type(ast_type), token(std::move(_token))
+ASTBase::ASTBase(int ast_type, std::uint32_t _offset): type(ast_type), offset(_offset)
 {
 
 }
-ASTBase::ASTBase(int ast_type, std::string const& token_value): type(ast_type)
+
+std::uint32_t const ASTBase::getOffset() const
+{
+    return offset;
+}
+void ASTBase::setOffset(std::uint32_t new_offset)
 {
-    token = std::make_unique<Token>(T_IDENTIFIER, token_value);
+    offset = new_offset;
 }
 
-Token* const ASTBase::getToken() const
+// Every node is preceded by the arena it was placed in, nullptr when it came from the heap
+static constexpr std::size_t NodeHeaderSize = alignof(std::max_align_t);
+
+Arena* const ASTBase::getArena() const
 {
-    return token.get();
+    return *(Arena**)((char const*)this - NodeHeaderSize);
 }
-void ASTBase::setToken(std::unique_ptr<Token> new_token)
+
+void* ASTBase::operator new(std::size_t size)
 {
-    token = std::move(new_token);
+    Arena* arena = Arena::getActive();
+    char* block;
+    if(arena)
+        block = (char*)arena->allocate(NodeHeaderSize + size, alignof(std::max_align_t));
+    else
+        block = (char*)::operator new(NodeHeaderSize + size);
+
+    *(Arena**)block = arena;
+    return block + NodeHeaderSize;
+}
+void ASTBase::operator delete(void* ptr)
+{
+    if(!ptr)
+        return;
+
+    char* block = (char*)ptr - NodeHeaderSize;
+    if(!*(Arena**)block)
+        ::operator delete(block);
 }
 
 std::string const ASTBase::GetStringFromType(int ast_type)
@@ -58,30 +87,42 @@ std::string const ASTBase::toString() const
 ///--- Base AST ---///
 
 ///--- Main AST ---///
-MainAST::MainAST(std::vector<std::unique_ptr<ASTBase>> _body, std::vector<std::unique_ptr<ExternAST>> _external_functions, std::string const& _program_name)
-: body(std::move(_body)), external_functions(std::move(_external_functions)), program_name(_program_name), ASTBase(AST_MAIN, _program_name)
+MainAST::MainAST(ASTList<ASTBase> _body, ASTList<ExternAST> _external_functions, std::string_view _program_name)
+: body(std::move(_body), Arena::getActiveResource()), external_functions(std::move(_external_functions), Arena::getActiveResource()), program_name(_program_name, Arena::getActiveResource()), ASTBase(AST_MAIN)
 {
 
 }
 
-std::string const& MainAST::getProgramName() const
+std::string_view const MainAST::getProgramName() const
 {
     return program_name;
 }
-void MainAST::setProgramName(std::string const& name)
+void MainAST::setProgramName(std::string_view name)
 {
     program_name = name;
 }
 
-std::vector<std::unique_ptr<ASTBase>> const& MainAST::getBody() const
+ASTList<ASTBase> const& MainAST::getBody() const
 {
     return body;
 }
-void MainAST::setBody(std::vector<std::unique_ptr<ASTBase>> _body)
+void MainAST::setBody(ASTList<ASTBase> _body)
 {
     body = std::move(_body);
 }
 
+ASTList<ExternAST> const& MainAST::getExternalFunctions() const
+{
+    return external_functions;
+}
+ASTList<ASTBase> MainAST::releaseBody()
+{
+    return std::move(body);
+}
+ASTList<ExternAST> MainAST::releaseExternalFunctions()
+{
+    return std::move(external_functions);
+}
 void MainAST::AddExternalFunction(std::unique_ptr<ExternAST> extern_func)
 {
     external_functions.push_back(std::move(extern_func));
@@ -89,33 +130,33 @@ void MainAST::AddExternalFunction(std::unique_ptr<ExternAST> extern_func)
 ///--- Main AST ---///
 
 ///--- Variable AST ---///
-VariableAST::VariableAST(std::string const& _name): name(_name), ASTBase(AST_VAR, _name)
+VariableAST::VariableAST(std::string_view _name): name(_name, Arena::getActiveResource()), ASTBase(AST_VAR)
 {
 
 }
 
-std::string const& VariableAST::getName() const
+std::string_view const VariableAST::getName() const
 {
     return name;
 }
-void VariableAST::setName(std::string const& new_name)
+void VariableAST::setName(std::string_view new_name)
 {
     name = new_name;
 }
 ///--- Variable AST ---///
 
 ///--- Variable Definition AST ---///
-VariableDefinitionAST::VariableDefinitionAST(std::string const& _name, std::unique_ptr<ASTBase> _value)
-: name(_name), value(std::move(_value)), ASTBase(AST_VARDEF, _name)
+VariableDefinitionAST::VariableDefinitionAST(std::string_view _name, std::unique_ptr<ASTBase> _value)
+: name(_name, Arena::getActiveResource()), value(std::move(_value)), superinstruction(SI_NONE), ASTBase(AST_VARDEF)
 {
 
 }
 
-std::string const& VariableDefinitionAST::getName() const
+std::string_view const VariableDefinitionAST::getName() const
 {
     return name;
 }
-void VariableDefinitionAST::setName(std::string const& new_name)
+void VariableDefinitionAST::setName(std::string_view new_name)
 {
     name = new_name;
 }
@@ -124,20 +165,29 @@ ASTBase* const VariableDefinitionAST::getValue() const
 {
     return value.get();
 }
+
+int const VariableDefinitionAST::getSuperinstruction() const
+{
+    return superinstruction;
+}
+void VariableDefinitionAST::setSuperinstruction(int _superinstruction)
+{
+    superinstruction = _superinstruction;
+}
 ///--- Variable Definition AST ---///
 
 ///--- Variable Assignment AST ---///
-VariableAssignmentAST::VariableAssignmentAST(std::string const& _name, std::unique_ptr<ASTBase> _value, std::unique_ptr<Token> _shorthand_operator)
-: name(_name), value(std::move(_value)), ASTBase(AST_VARASSIGN, _name), is_shorthand(false)
+VariableAssignmentAST::VariableAssignmentAST(std::string_view _name, std::unique_ptr<ASTBase> _value, int _shorthand_operator)
+: name(_name, Arena::getActiveResource()), value(std::move(_value)), ASTBase(AST_VARASSIGN), is_shorthand(false), superinstruction(SI_NONE), shorthand_operator(T_EOF)
 {
-    setShorthandOperator(std::move(_shorthand_operator));
+    setShorthandOperator(_shorthand_operator);
 }
 
-std::string const& VariableAssignmentAST::getName() const
+std::string_view const VariableAssignmentAST::getName() const
 {
     return name;
 }
-void VariableAssignmentAST::setName(std::string const& new_name)
+void VariableAssignmentAST::setName(std::string_view new_name)
 {
     name = new_name;
 }
@@ -146,59 +196,59 @@ bool const VariableAssignmentAST::isShorthand() const
 {
     return is_shorthand;
 }
-std::unique_ptr<Token> VariableAssignmentAST::moveShorthandOperator()
+int const VariableAssignmentAST::getShorthandOperator() const
 {
-    return std::move(shorthand_operator);
+    return shorthand_operator;
 }
-Token* const VariableAssignmentAST::getShorthandOperator() const
+// T_EOF makes it a plain assignment
+void VariableAssignmentAST::setShorthandOperator(int _shorthand_operator)
 {
-    return shorthand_operator.get();
-}
-void VariableAssignmentAST::setShorthandOperator(std::unique_ptr<Token> _shorthand_operator)
-{
-    if(_shorthand_operator)
-    {
-        is_shorthand = true;
-        shorthand_operator = std::move(_shorthand_operator);
-    }
-    else
-    {
-        is_shorthand = false;
-    }
+    shorthand_operator = _shorthand_operator;
+    is_shorthand = shorthand_operator != T_EOF;
+    superinstruction = SI_NONE;
 }
 
 ASTBase* const VariableAssignmentAST::getValue() const
 {
     return value.get();
 }
+
+int const VariableAssignmentAST::getSuperinstruction() const
+{
+    return superinstruction;
+}
+void VariableAssignmentAST::setSuperinstruction(int _superinstruction)
+{
+    superinstruction = _superinstruction;
+}
 ///--- Variable Assignment AST ---///
 
 ///--- Function Call AST ---///
-FunctionCallAST::FunctionCallAST(std::string const& _name)
-: name(_name), ASTBase(AST_CALL, _name)
+FunctionCallAST::FunctionCallAST(std::string_view _name)
+: name(_name, Arena::getActiveResource()), arguments(Arena::getActiveResource()), ASTBase(AST_CALL)
 {
 
 }
-FunctionCallAST::FunctionCallAST(std::string const& _name, std::vector<std::unique_ptr<ASTBase>> _arguments)
-: name(_name), arguments(std::move(_arguments)), ASTBase(AST_CALL, _name)
+FunctionCallAST::FunctionCallAST(std::string_view _name, ASTList<ASTBase> _arguments)
+: name(_name, Arena::getActiveResource()), arguments(std::move(_arguments), Arena::getActiveResource()), ASTBase(AST_CALL)
 {
 
 }
 
-std::string const& FunctionCallAST::getName() const
+std::string_view const FunctionCallAST::getName() const
 {
     return name;
 }
-void FunctionCallAST::setName(std::string const& new_name)
+void FunctionCallAST::setName(std::string_view new_name)
 {
     name = new_name;
 }
 
-std::vector<std::unique_ptr<ASTBase>> const& FunctionCallAST::getArguments() const
+ASTList<ASTBase> const& FunctionCallAST::getArguments() const
 {
     return arguments;
 }
-void FunctionCallAST::setArguments(std::vector<std::unique_ptr<ASTBase>> arguments)
+void FunctionCallAST::setArguments(ASTList<ASTBase> arguments)
 {
     arguments = std::move(arguments);
 }
@@ -206,21 +256,21 @@ void FunctionCallAST::setArguments(std::vector<std::unique_ptr<ASTBase>> argumen
 
 ///--- Sequence AST ---///
 SequenceAST::SequenceAST()
-: ASTBase(AST_SEQUENCE, "")
+: body(Arena::getActiveResource()), ASTBase(AST_SEQUENCE)
 {
 
 }
-SequenceAST::SequenceAST(std::vector<std::unique_ptr<FunctionCallAST>> _body)
-: body(std::move(_body)), ASTBase(AST_SEQUENCE, "")
+SequenceAST::SequenceAST(ASTList<FunctionCallAST> _body)
+: body(std::move(_body), Arena::getActiveResource()), ASTBase(AST_SEQUENCE)
 {
 
 }
 
-std::vector<std::unique_ptr<FunctionCallAST>> const& SequenceAST::getBody() const
+ASTList<FunctionCallAST> const& SequenceAST::getBody() const
 {
     return body;
 }
-void SequenceAST::setBody(std::vector<std::unique_ptr<FunctionCallAST>> _body)
+void SequenceAST::setBody(ASTList<FunctionCallAST> _body)
 {
     body = std::move(_body);
 }
@@ -228,12 +278,12 @@ void SequenceAST::setBody(std::vector<std::unique_ptr<FunctionCallAST>> _body)
 
 ///--- Do-For AST ---///
 DoForAST::DoForAST(std::unique_ptr<ASTBase> _for_times_ast)
-: for_times_ast(std::move(_for_times_ast)), ASTBase(AST_DOFOR, "")
+: for_times_ast(std::move(_for_times_ast)), sequences(Arena::getActiveResource()), ASTBase(AST_DOFOR)
 {
 
 }
-DoForAST::DoForAST(std::unique_ptr<ASTBase> _for_times_ast, std::vector<std::unique_ptr<ASTBase>> _sequences)
-: for_times_ast(std::move(_for_times_ast)), sequences(std::move(_sequences)), ASTBase(AST_DOFOR, "")
+DoForAST::DoForAST(std::unique_ptr<ASTBase> _for_times_ast, ASTList<ASTBase> _sequences)
+: for_times_ast(std::move(_for_times_ast)), sequences(std::move(_sequences), Arena::getActiveResource()), ASTBase(AST_DOFOR)
 {
 
 }
@@ -247,11 +297,11 @@ void DoForAST::setForTimes(std::unique_ptr<ASTBase> _for_times)
     for_times_ast = std::move(_for_times);
 }
 
-std::vector<std::unique_ptr<ASTBase>> const& DoForAST::getSequences() const
+ASTList<ASTBase> const& DoForAST::getSequences() const
 {
     return sequences;
 }
-void DoForAST::setSequences(std::vector<std::unique_ptr<ASTBase>> _sequences)
+void DoForAST::setSequences(ASTList<ASTBase> _sequences)
 {
     sequences = std::move(_sequences);
 }
@@ -259,12 +309,12 @@ void DoForAST::setSequences(std::vector<std::unique_ptr<ASTBase>> _sequences)
 
 ///--- Do-Through AST ---///
 DoThroughAST::DoThroughAST(std::unique_ptr<ASTBase> _through_ast)
-: through_ast(std::move(_through_ast)), ASTBase(AST_DOTHROUGH, "")
+: through_ast(std::move(_through_ast)), sequences(Arena::getActiveResource()), ASTBase(AST_DOTHROUGH)
 {
 
 }
-DoThroughAST::DoThroughAST(std::unique_ptr<ASTBase> _through_ast, std::vector<std::unique_ptr<ASTBase>> _sequences)
-: through_ast(std::move(_through_ast)), sequences(std::move(_sequences)), ASTBase(AST_DOTHROUGH, "")
+DoThroughAST::DoThroughAST(std::unique_ptr<ASTBase> _through_ast, ASTList<ASTBase> _sequences)
+: through_ast(std::move(_through_ast)), sequences(std::move(_sequences), Arena::getActiveResource()), ASTBase(AST_DOTHROUGH)
 {
 
 }
@@ -278,18 +328,18 @@ void DoThroughAST::setThrough(std::unique_ptr<ASTBase> _through_ast)
     through_ast = std::move(_through_ast);
 }
 
-std::vector<std::unique_ptr<ASTBase>> const& DoThroughAST::getSequences() const
+ASTList<ASTBase> const& DoThroughAST::getSequences() const
 {
     return sequences;
 }
-void DoThroughAST::setSequences(std::vector<std::unique_ptr<ASTBase>> _sequences)
+void DoThroughAST::setSequences(ASTList<ASTBase> _sequences)
 {
     sequences = std::move(_sequences);
 }
 ///--- Do-Through AST ---///
 
 ///--- Number AST ---///
-NumberAST::NumberAST(double _value): value(_value), ASTBase(AST_NUMBER, "")
+NumberAST::NumberAST(double _value): value(_value), ASTBase(AST_NUMBER)
 {
 
 }
@@ -305,47 +355,68 @@ void NumberAST::setValue(double _value)
 ///--- Number AST ---///
 
 ///--- String AST ---///
-StringAST::StringAST(std::string const& _value): value(_value), ASTBase(AST_STRING, "")
+StringAST::StringAST(std::string_view _value): value(_value, Arena::getActiveResource()), ASTBase(AST_STRING)
 {
 
 }
 
-std::string const& StringAST::getValue() const
+std::string_view const StringAST::getValue() const
 {
     return value;
 }
-void StringAST::setValue(std::string const& _value)
+void StringAST::setValue(std::string_view _value)
 {
     value = _value;
 }
 ///--- String AST ---///
 
 ///--- Extern AST ---///
-ExternAST::ExternAST(std::string const& _name): name(_name), ASTBase(AST_EXTERN, "")
+ExternAST::ExternAST(std::string_view _name): name(_name, Arena::getActiveResource()), ASTBase(AST_EXTERN)
 {
 
 }
 
-std::string const& ExternAST::getName() const
+std::string_view const ExternAST::getName() const
 {
     return name;
 }
-void ExternAST::setName(std::string const& _name)
+void ExternAST::setName(std::string_view _name)
 {
     name = _name;
 }
 ///--- Extern AST ---///
 
 ///--- Binary Operation AST ---///
-BinaryOperationAST::BinaryOperationAST(std::unique_ptr<Token> _op, std::unique_ptr<ASTBase> _lhs, std::unique_ptr<ASTBase> _rhs)
-: op(std::move(_op)), lhs(std::move(_lhs)), rhs(std::move(_rhs)), ASTBase(AST_BINOP, "")
+BinaryOperationAST::BinaryOperationAST(int _op, std::unique_ptr<ASTBase> _lhs, std::unique_ptr<ASTBase> _rhs)
+: op(_op), lhs(std::move(_lhs)), rhs(std::move(_rhs)), ASTBase(AST_BINOP)
 {
 
 }
+// Generated expressions can nest operations deeper than the stack, so unlink them into a worklist
+BinaryOperationAST::~BinaryOperationAST()
+{
+    if((!lhs || lhs->type != AST_BINOP) && (!rhs || rhs->type != AST_BINOP))
+        return;
+
+    std::vector<std::unique_ptr<ASTBase>> pending;
+    pending.push_back(std::move(lhs));
+    pending.push_back(std::move(rhs));
+    while(!pending.empty())
+    {
+        std::unique_ptr<ASTBase> node = std::move(pending.back());
+        pending.pop_back();
+        if(node && node->type == AST_BINOP)
+        {
+            auto* binop = (BinaryOperationAST*)node.get();
+            pending.push_back(std::move(binop->lhs));
+            pending.push_back(std::move(binop->rhs));
+        }
+    }
+}
 
-Token* const BinaryOperationAST::getOperator() const
+int const BinaryOperationAST::getOperator() const
 {
-    return op.get();
+    return op;
 }
 ASTBase* const BinaryOperationAST::getLHS() const
 {
@@ -365,9 +436,15 @@ std::unique_ptr<ASTBase> BinaryOperationAST::moveRHS()
     return std::move(rhs);
 }
 
-void BinaryOperationAST::setOperator(std::unique_ptr<Token> new_op)
+BinaryFeedback& BinaryOperationAST::getFeedback()
 {
-    op = std::move(new_op);
+    return feedback;
+}
+
+void BinaryOperationAST::setOperator(int new_op)
+{
+    op = new_op;
+    feedback = BinaryFeedback();
 }
 void BinaryOperationAST::setLHS(std::unique_ptr<ASTBase> _lhs)
 {
@@ -380,8 +457,8 @@ void BinaryOperationAST::setRHS(std::unique_ptr<ASTBase> _rhs)
 ///--- Binary Operation AST ---///
 
 ///--- If AST ---///
-IfAST::IfAST(std::unique_ptr<ASTBase> _expression, std::vector<std::unique_ptr<ASTBase>> _statements)
-: expression(std::move(_expression)), statements(std::move(_statements)), ASTBase(AST_IF, "if")
+IfAST::IfAST(std::unique_ptr<ASTBase> _expression, ASTList<ASTBase> _statements)
+: expression(std::move(_expression)), statements(std::move(_statements), Arena::getActiveResource()), superinstruction(SI_NONE), ASTBase(AST_IF)
 {
 
 }
@@ -393,41 +470,252 @@ ASTBase* const IfAST::getExpression() const
 void IfAST::setExpression(std::unique_ptr<ASTBase> new_expression)
 {
     expression = std::move(new_expression);
+    superinstruction = SI_NONE;
+}
+
+int const IfAST::getSuperinstruction() const
+{
+    return superinstruction;
+}
+void IfAST::setSuperinstruction(int _superinstruction)
+{
+    superinstruction = _superinstruction;
 }
 
-std::vector<std::unique_ptr<ASTBase>> const& IfAST::getBody() const
+ASTList<ASTBase> const& IfAST::getBody() const
 {
     return statements;
 }
-void IfAST::setBody(std::vector<std::unique_ptr<ASTBase>> new_body)
+void IfAST::setBody(ASTList<ASTBase> new_body)
 {
     statements = std::move(new_body);
 }
+
+LazyBody const& IfAST::getLazyBody() const
+{
+    return lazy_body;
+}
+void IfAST::setLazyBody(LazyBody body)
+{
+    lazy_body = body;
+}
 ///--- If AST ---///
 
 ///--- If-Else AST ---///
-IfElseAST::IfElseAST(std::vector<std::unique_ptr<IfAST>> _if_statements, std::vector<std::unique_ptr<ASTBase>> _else_statements)
-: if_statements(std::move(_if_statements)), else_statements(std::move(_else_statements)), ASTBase(AST_IFELSE, "")
+IfElseAST::IfElseAST(ASTList<IfAST> _if_statements, ASTList<ASTBase> _else_statements)
+: if_statements(std::move(_if_statements), Arena::getActiveResource()), else_statements(std::move(_else_statements), Arena::getActiveResource()), ASTBase(AST_IFELSE)
 {
 
 }
 
-std::vector<std::unique_ptr<IfAST>> const& IfElseAST::getIfStatements() const
+ASTList<IfAST> const& IfElseAST::getIfStatements() const
 {
     return if_statements;
 }
-void IfElseAST::setIfStatements(std::vector<std::unique_ptr<IfAST>> new_if_statements)
+void IfElseAST::setIfStatements(ASTList<IfAST> new_if_statements)
 {
     if_statements = std::move(new_if_statements);
 }
 
-std::vector<std::unique_ptr<ASTBase>> const& IfElseAST::getElseBody() const
+ASTList<ASTBase> const& IfElseAST::getElseBody() const
 {
     return else_statements;
 }
-void IfElseAST::setBody(std::vector<std::unique_ptr<ASTBase>> new_body)
+void IfElseAST::setBody(ASTList<ASTBase> new_body)
 {
     else_statements = std::move(new_body);
 }
+
+LazyBody const& IfElseAST::getLazyElseBody() const
+{
+    return lazy_else_body;
+}
+void IfElseAST::setLazyElseBody(LazyBody body)
+{
+    lazy_else_body = body;
+}
 ///--- If-Else AST ---///
+
+///--- Structural Hash ---///
+namespace
+{
+
+template <typename T>
+void pushList(std::vector<ASTBase const*>& pending, std::uint64_t& hash, ASTList<T> const& list)
+{
+    hash = mixHash(hash, list.size());
+    for(auto it = list.rbegin(); it != list.rend(); ++it)
+        pending.push_back(it->get());
+}
+
+}
+
+std::uint64_t const hashStructure(ASTBase const* ast)
+{
+    std::uint64_t hash = 0;
+    std::vector<ASTBase const*> pending = {ast};
+    while(!pending.empty())
+    {
+        ASTBase const* node = pending.back();
+        pending.pop_back();
+        if(!node)
+        {
+            hash = mixHash(hash, UINT32_MAX);
+            continue;
+        }
+
+        hash = mixHash(hash, node->type);
+        switch(node->type)
+        {
+            case AST_MAIN: pushList(pending, hash, ((MainAST const*)node)->getBody()); break;
+
+            case AST_VAR: hash = mixHash(hash, std::hash<std::string_view>()(((VariableAST const*)node)->getName())); break;
+            case AST_VARDEF: {
+                auto* def = (VariableDefinitionAST const*)node;
+                hash = mixHash(hash, std::hash<std::string_view>()(def->getName()));
+                pending.push_back(def->getValue());
+                break;
+            }
+            case AST_VARASSIGN: {
+                auto* assign = (VariableAssignmentAST const*)node;
+                hash = mixHash(hash, std::hash<std::string_view>()(assign->getName()));
+                hash = mixHash(hash, assign->getShorthandOperator());
+                pending.push_back(assign->getValue());
+                break;
+            }
+
+            case AST_CALL: {
+                auto* call = (FunctionCallAST const*)node;
+                hash = mixHash(hash, std::hash<std::string_view>()(call->getName()));
+                pushList(pending, hash, call->getArguments());
+                break;
+            }
+            case AST_SEQUENCE: pushList(pending, hash, ((SequenceAST const*)node)->getBody()); break;
+            case AST_DOFOR: {
+                auto* dofor = (DoForAST const*)node;
+                pushList(pending, hash, dofor->getSequences());
+                pending.push_back(dofor->getForTimes());
+                break;
+            }
+
+            case AST_NUMBER: {
+                double value = ((NumberAST const*)node)->getValue();
+                std::uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                hash = mixHash(hash, bits);
+                break;
+            }
+            case AST_STRING: hash = mixHash(hash, std::hash<std::string_view>()(((StringAST const*)node)->getValue())); break;
+            case AST_EXTERN: hash = mixHash(hash, std::hash<std::string_view>()(((ExternAST const*)node)->getName())); break;
+
+            case AST_BINOP: {
+                auto* binop = (BinaryOperationAST const*)node;
+                hash = mixHash(hash, binop->getOperator());
+                pending.push_back(binop->getRHS());
+                pending.push_back(binop->getLHS());
+                break;
+            }
+            case AST_IF: {
+                auto* ifstm = (IfAST const*)node;
+                if(ifstm->getLazyBody().isPending())
+                    hash = mixHash(hash, (std::uintptr_t)node);
+                pushList(pending, hash, ifstm->getBody());
+                pending.push_back(ifstm->getExpression());
+                break;
+            }
+            case AST_IFELSE: {
+                auto* ifelse = (IfElseAST const*)node;
+                if(ifelse->getLazyElseBody().isPending())
+                    hash = mixHash(hash, (std::uintptr_t)node);
+                pushList(pending, hash, ifelse->getElseBody());
+                pushList(pending, hash, ifelse->getIfStatements());
+                break;
+            }
+        }
+    }
+    return hash;
+}
+///--- Structural Hash ---///
+
+///--- Superinstructions ---///
+namespace
+{
+
+bool isLiteral(ASTBase const* ast)
+{
+    return ast && (ast->type == AST_NUMBER || ast->type == AST_STRING);
+}
+
+int const matchSuperinstruction(ASTBase const* ast)
+{
+    switch(ast->type)
+    {
+        default: return SI_NONE;
+        case AST_VARASSIGN: {
+            auto* assign = (VariableAssignmentAST const*)ast;
+            if(assign->isShorthand() && assign->getValue() && assign->getValue()->type == AST_NUMBER)
+                return SI_SHORTHAND_NUMBER;
+            return SI_NONE;
+        }
+        case AST_VARDEF: {
+            auto* value = ((VariableDefinitionAST const*)ast)->getValue();
+            if(!value || value->type != AST_CALL)
+                return SI_NONE;
+            for(auto&& arg: ((FunctionCallAST const*)value)->getArguments())
+                if(!isLiteral(arg.get()))
+                    return SI_NONE;
+            return SI_DEFINE_CALL;
+        }
+        case AST_IF: {
+            auto* expression = ((IfAST const*)ast)->getExpression();
+            if(!expression || expression->type != AST_BINOP)
+                return SI_NONE;
+            auto* binop = (BinaryOperationAST const*)expression;
+            if(binop->getOperator() != T_DEQUAL || !binop->getLHS() || binop->getLHS()->type != AST_VAR || !isLiteral(binop->getRHS()))
+                return SI_NONE;
+            return SI_IF_EQUALS;
+        }
+    }
+}
+
+}
+
+std::size_t const selectSuperinstructions(ASTList<ASTBase> const& body)
+{
+    std::size_t selected = 0;
+    std::vector<ASTList<ASTBase> const*> pending = {&body};
+    while(!pending.empty())
+    {
+        auto const* statements = pending.back();
+        pending.pop_back();
+        for(auto&& stm: *statements)
+        {
+            if(!stm)
+                continue;
+            int superinstruction = matchSuperinstruction(stm.get());
+            selected += superinstruction != SI_NONE;
+            switch(stm->type)
+            {
+                case AST_VARASSIGN: ((VariableAssignmentAST*)stm.get())->setSuperinstruction(superinstruction); break;
+                case AST_VARDEF: ((VariableDefinitionAST*)stm.get())->setSuperinstruction(superinstruction); break;
+                case AST_IFELSE: {
+                    auto* ifelse = (IfElseAST*)stm.get();
+                    for(auto&& ifstm: ifelse->getIfStatements())
+                    {
+                        superinstruction = matchSuperinstruction(ifstm.get());
+                        selected += superinstruction != SI_NONE;
+                        ifstm->setSuperinstruction(superinstruction);
+                        if(!ifstm->getLazyBody().isPending())
+                            pending.push_back(&ifstm->getBody());
+                    }
+                    if(!ifelse->getLazyElseBody().isPending())
+                        pending.push_back(&ifelse->getElseBody());
+                    break;
+                }
+            }
+        }
+    }
+    return selected;
+}
+///--- Superinstructions ---///
 }
\ No newline at end of file
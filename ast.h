@@ -1,9 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "lex.h"
+#include "arena.h"
 
 namespace xeouz
 {
@@ -33,21 +38,39 @@ enum ASTType
     AST_ARRAY,
 };
 
+template <typename T>
+using ASTList = std::pmr::vector<std::unique_ptr<T>>;
+
+// Fused forms the tree walker runs in place of a statement's node-by-node walk, chosen by selectSuperinstructions
+enum Superinstruction
+{
+    SI_NONE,
+    SI_SHORTHAND_NUMBER, // `x op= <number>`, on the VariableAssignmentAST
+    SI_DEFINE_CALL, // `let x = f(<literals>)`, on the VariableDefinitionAST
+    SI_IF_EQUALS, // `if (x == <literal>)`, on the IfAST
+};
+
 ///--- Base AST ---///
+// Nodes created while an Arena is active are placed in it together with their child lists and strings.
+// Deleting such a node only runs its destructor, the memory goes back with the arena.
 class ASTBase
 {
-    std::unique_ptr<Token> token;
+    std::uint32_t offset; // Source offset of the first token, resolved to a line through the Lexer's line table
 public:
     int type;
 
-    ASTBase(int ast_type, std::unique_ptr<Token> token);
-    ASTBase(int ast_type, std::string const& token_value);
+    ASTBase(int ast_type, std::uint32_t offset=0);
 
     static std::string const GetStringFromType(int ast_type);
     std::string const toString() const;
 
-    virtual Token* const getToken() const;
-    virtual void setToken(std::unique_ptr<Token> new_token);
+    std::uint32_t const getOffset() const;
+    void setOffset(std::uint32_t new_offset);
+
+    Arena* const getArena() const;
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr);
 
     virtual ~ASTBase() { }
 };
@@ -58,18 +81,21 @@ class ExternAST;
 
 class MainAST: public ASTBase
 {
-    std::string program_name;
-    std::vector<std::unique_ptr<ASTBase>> body;
-    std::vector<std::unique_ptr<ExternAST>> external_functions;
+    std::pmr::string program_name;
+    ASTList<ASTBase> body;
+    ASTList<ExternAST> external_functions;
 public:
-    MainAST(std::vector<std::unique_ptr<ASTBase>> body, std::vector<std::unique_ptr<ExternAST>> external_functions, std::string const& program_name = "main");
+    MainAST(ASTList<ASTBase> body, ASTList<ExternAST> external_functions, std::string_view program_name = "main");
 
-    std::string const& getProgramName() const;
-    void setProgramName(std::string const& name);
+    std::string_view const getProgramName() const;
+    void setProgramName(std::string_view name);
 
-    std::vector<std::unique_ptr<ASTBase>> const& getBody() const;
-    void setBody(std::vector<std::unique_ptr<ASTBase>> body);
+    ASTList<ASTBase> const& getBody() const;
+    void setBody(ASTList<ASTBase> body);
 
+    ASTList<ExternAST> const& getExternalFunctions() const;
+    ASTList<ASTBase> releaseBody();
+    ASTList<ExternAST> releaseExternalFunctions();
     void AddExternalFunction(std::unique_ptr<ExternAST> extern_func);
 };
 ///--- Main AST ---///
@@ -77,67 +103,74 @@ public:
 ///--- Variable AST ---///
 class VariableAST: public ASTBase
 {
-    std::string name;
+    std::pmr::string name;
 public:
-    VariableAST(std::string const& name);
+    VariableAST(std::string_view name);
 
-    std::string const& getName() const;
-    void setName(std::string const& new_name);
+    std::string_view const getName() const;
+    void setName(std::string_view new_name);
 };
 ///--- Variable AST ---///
 
 ///--- Variable Definition AST ---///
 class VariableDefinitionAST: public ASTBase
 {
-    std::string name;
+    std::pmr::string name;
     std::unique_ptr<ASTBase> value;
+    std::uint8_t superinstruction;
 public:
-    VariableDefinitionAST(std::string const& name, std::unique_ptr<ASTBase> value);
+    VariableDefinitionAST(std::string_view name, std::unique_ptr<ASTBase> value);
 
-    std::string const& getName() const;
-    void setName(std::string const& new_name);
+    std::string_view const getName() const;
+    void setName(std::string_view new_name);
 
     ASTBase* const getValue() const;
+
+    int const getSuperinstruction() const;
+    void setSuperinstruction(int superinstruction);
 };
 ///--- Variable Definition AST ---///
 
 ///--- Variable Assignment AST ---///
 class VariableAssignmentAST: public ASTBase
 {
-    std::string name;
+    std::pmr::string name;
     std::unique_ptr<ASTBase> value;
 
     bool is_shorthand;
-    std::unique_ptr<Token> shorthand_operator;
+    std::uint8_t superinstruction;
+    int shorthand_operator;
 public:
-    VariableAssignmentAST(std::string const& name, std::unique_ptr<ASTBase> value, std::unique_ptr<Token> shorthand_operator=nullptr);
+    VariableAssignmentAST(std::string_view name, std::unique_ptr<ASTBase> value, int shorthand_operator=T_EOF);
 
-    std::string const& getName() const;
-    void setName(std::string const& new_name);
+    std::string_view const getName() const;
+    void setName(std::string_view new_name);
 
     bool const isShorthand() const;
-    Token* const getShorthandOperator() const;
-    std::unique_ptr<Token> moveShorthandOperator();
-    void setShorthandOperator(std::unique_ptr<Token> shorthand_operator);
+    int const getShorthandOperator() const;
+    void setShorthandOperator(int shorthand_operator); // Drops the superinstruction
 
     ASTBase* const getValue() const;
+
+    int const getSuperinstruction() const;
+    void setSuperinstruction(int superinstruction);
 };
 ///--- Variable Assignment AST ---///
 
 ///--- Function Call AST ---///
 class FunctionCallAST: public ASTBase
 {
-    std::string name;
-    std::vector<std::unique_ptr<ASTBase>> arguments;
+    std::pmr::string name;
+    ASTList<ASTBase> arguments;
 public:
-    FunctionCallAST(std::string const& name);
-    FunctionCallAST(std::string const& name, std::vector<std::unique_ptr<ASTBase>> arguments);
+    FunctionCallAST(std::string_view name);
+    FunctionCallAST(std::string_view name, ASTList<ASTBase> arguments);
 
-    std::string const& getName() const;
-    void setName(std::string const& new_name);
+    std::string_view const getName() const;
+    void setName(std::string_view new_name);
 
-    std::vector<std::unique_ptr<ASTBase>> const& getArguments() const;
-    void setArguments(std::vector<std::unique_ptr<ASTBase>> arguments);
+    ASTList<ASTBase> const& getArguments() const;
+    void setArguments(ASTList<ASTBase> arguments);
 
     FunctionCallAST* copy() const;
 };
@@ -146,47 +179,47 @@ public:
 ///--- Sequence AST ---///
 class SequenceAST: public ASTBase
 {
-    std::vector<std::unique_ptr<FunctionCallAST>> body;
+    ASTList<FunctionCallAST> body;
 public:
     SequenceAST();
-    SequenceAST(std::vector<std::unique_ptr<FunctionCallAST>> body);
+    SequenceAST(ASTList<FunctionCallAST> body);
 
-    std::vector<std::unique_ptr<FunctionCallAST>> const& getBody() const;
-    void setBody(std::vector<std::unique_ptr<FunctionCallAST>> body);
+    ASTList<FunctionCallAST> const& getBody() const;
+    void setBody(ASTList<FunctionCallAST> body);
 };
 ///--- Sequence AST ---///
 
 ///--- Do-For AST ---///
 class DoForAST: public ASTBase
 {
-    std::vector<std::unique_ptr<ASTBase>> sequences;
+    ASTList<ASTBase> sequences;
     std::unique_ptr<ASTBase> for_times_ast;
 public:
     DoForAST(std::unique_ptr<ASTBase> for_times_ast);
-    DoForAST(std::unique_ptr<ASTBase> for_times_ast, std::vector<std::unique_ptr<ASTBase>> sequences);
+    DoForAST(std::unique_ptr<ASTBase> for_times_ast, ASTList<ASTBase> sequences);
 
     ASTBase* const getForTimes() const;
     void setForTimes(std::unique_ptr<ASTBase> for_times);
 
-    std::vector<std::unique_ptr<ASTBase>> const& getSequences() const;
-    void setSequences(std::vector<std::unique_ptr<ASTBase>> sequences);
+    ASTList<ASTBase> const& getSequences() const;
+    void setSequences(ASTList<ASTBase> sequences);
 };
 ///--- Do-For AST ---///
 
 ///--- Do-Through AST ---///
 class DoThroughAST: public ASTBase
 {
-    std::vector<std::unique_ptr<ASTBase>> sequences;
+    ASTList<ASTBase> sequences;
     std::unique_ptr<ASTBase> through_ast;
 public:
     DoThroughAST(std::unique_ptr<ASTBase> through_ast);
-    DoThroughAST(std::unique_ptr<ASTBase> through_ast, std::vector<std::unique_ptr<ASTBase>> sequences);
+    DoThroughAST(std::unique_ptr<ASTBase> through_ast, ASTList<ASTBase> sequences);
 
     ASTBase* const getThrough() const;
     void setThrough(std::unique_ptr<ASTBase> through_ast);
 
-    std::vector<std::unique_ptr<ASTBase>> const& getSequences() const;
-    void setSequences(std::vector<std::unique_ptr<ASTBase>> sequences);
+    ASTList<ASTBase> const& getSequences() const;
+    void setSequences(ASTList<ASTBase> sequences);
 };
 ///--- Do-Through AST ---///
 
@@ -205,78 +238,144 @@ public:
 ///--- String AST ---///
 class StringAST: public ASTBase
 {
-    std::string value;
+    std::pmr::string value;
 public:
-    StringAST(std::string const& value);
+    StringAST(std::string_view value);
 
-    std::string const& getValue() const;
-    void setValue(std::string const& value);
+    std::string_view const getValue() const;
+    void setValue(std::string_view value);
 };
 ///--- String AST ---///
 
 ///--- Extern AST ---///
 class ExternAST: public ASTBase
 {
-    std::string name;
+    std::pmr::string name;
 public:
-    ExternAST(std::string const& name);
+    ExternAST(std::string_view name);
 
-    std::string const& getName() const;
-    void setName(std::string const& name);
+    std::string_view const getName() const;
+    void setName(std::string_view name);
 };
 ///--- Extern AST ---///
 
 ///--- Binary Operation AST ---///
+enum BinaryQuickening
+{
+    BQ_GENERIC, // Goes through Interpreter::useBinaryOperation and records the operand types
+    BQ_NUMBER, // Number and number, with `number` as the operator
+    BQ_STRING, // String + string
+    BQ_UNSTABLE, // Deoptimized too often, stays generic without recording
+};
+
+// Type feedback the tree walker keeps on a site, see Interpreter::interpretBinaryOperation
+struct BinaryFeedback
+{
+    std::uint8_t state = BQ_GENERIC;
+    std::uint8_t seen = BQ_GENERIC; // What the last `hits` executions could have been quickened to
+    std::uint8_t hits = 0;
+    std::uint8_t deopts = 0;
+    double (*number)(double lhs, double rhs) = nullptr;
+};
+
 class BinaryOperationAST: public ASTBase
 {
-    std::unique_ptr<Token> op;
+    int op;
     std::unique_ptr<ASTBase> lhs, rhs;
+    BinaryFeedback feedback;
 public:
-    BinaryOperationAST(std::unique_ptr<Token> op, std::unique_ptr<ASTBase> lhs, std::unique_ptr<ASTBase> rhs);
+    BinaryOperationAST(int op, std::unique_ptr<ASTBase> lhs, std::unique_ptr<ASTBase> rhs);
+    ~BinaryOperationAST();
 
-    Token* const getOperator() const;
+    int const getOperator() const;
     ASTBase* const getLHS() const;
     ASTBase* const getRHS() const;
 
     std::unique_ptr<ASTBase> moveLHS();
     std::unique_ptr<ASTBase> moveRHS();
 
-    void setOperator(std::unique_ptr<Token> new_op);
+    BinaryFeedback& getFeedback();
+
+    void setOperator(int new_op); // Drops the feedback
     void setLHS(std::unique_ptr<ASTBase> lhs);
     void setRHS(std::unique_ptr<ASTBase> rhs);
 };
 ///--- Binary Operation AST ---///
 
+///--- Lazy Body ---///
+// Token range of a braced body that is only parsed when it first runs, `begin` is the `{` and `end` the matching `}`
+struct LazyBody
+{
+    std::size_t begin = SIZE_MAX;
+    std::size_t end = SIZE_MAX;
+
+    bool const isPending() const
+    {
+        return begin != SIZE_MAX;
+    }
+};
+///--- Lazy Body ---///
+
 ///--- If AST ---///
 class IfAST: public ASTBase
 {
     std::unique_ptr<ASTBase> expression;
-    std::vector<std::unique_ptr<ASTBase>> statements;
+    ASTList<ASTBase> statements;
+    LazyBody lazy_body;
+    std::uint8_t superinstruction;
 public:
-    IfAST(std::unique_ptr<ASTBase> expression, std::vector<std::unique_ptr<ASTBase>> statements);
+    IfAST(std::unique_ptr<ASTBase> expression, ASTList<ASTBase> statements);
 
     ASTBase* const getExpression() const;
-    void setExpression(std::unique_ptr<ASTBase> new_expression);
+    void setExpression(std::unique_ptr<ASTBase> new_expression); // Drops the superinstruction
+
+    int const getSuperinstruction() const;
+    void setSuperinstruction(int superinstruction);
+
+    ASTList<ASTBase> const& getBody() const;
+    void setBody(ASTList<ASTBase> new_body);
 
-    std::vector<std::unique_ptr<ASTBase>> const& getBody() const;
-    void setBody(std::vector<std::unique_ptr<ASTBase>> new_body);
+    LazyBody const& getLazyBody() const;
+    void setLazyBody(LazyBody body);
 };
 ///--- If AST ---///
 
 ///--- If-Else AST ---///
 class IfElseAST: public ASTBase
 {
-    std::vector<std::unique_ptr<IfAST>> if_statements;
-    std::vector<std::unique_ptr<ASTBase>> else_statements;
+    ASTList<IfAST> if_statements;
+    ASTList<ASTBase> else_statements;
+    LazyBody lazy_else_body;
 public:
-    IfElseAST(std::vector<std::unique_ptr<IfAST>> if_statements, std::vector<std::unique_ptr<ASTBase>> else_statements);
+    IfElseAST(ASTList<IfAST> if_statements, ASTList<ASTBase> else_statements);
 
-    std::vector<std::unique_ptr<IfAST>> const& getIfStatements() const;
-    void setIfStatements(std::vector<std::unique_ptr<IfAST>> new_if_statements);
+    ASTList<IfAST> const& getIfStatements() const;
+    void setIfStatements(ASTList<IfAST> new_if_statements);
 
-    std::vector<std::unique_ptr<ASTBase>> const& getElseBody() const;
-    void setBody(std::vector<std::unique_ptr<ASTBase>> new_body);
+    ASTList<ASTBase> const& getElseBody() const;
+    void setBody(ASTList<ASTBase> new_body);
+
+    LazyBody const& getLazyElseBody() const;
+    void setLazyElseBody(LazyBody body);
 };
 ///--- If-Else AST ---///
 
+///--- Structural Hash ---///
+// Hash of a subtree's kinds, operators, names and values, source offsets are left out so moved
+// code keeps its hash. A body that is still lazy has no structure yet and never matches another.
+std::uint64_t const hashStructure(ASTBase const* ast);
+// One step of the structural hash, ASTPool::hashStructure mixes the same way
+inline std::uint64_t mixHash(std::uint64_t hash, std::uint64_t value)
+{
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash * 0xff51afd7ed558ccdull;
+}
+///--- Structural Hash ---///
+
+///--- Superinstructions ---///
+// Marks the statements in `body`, and in the if and else bodies that are parsed, that have a fused form. Returns how
+// many were marked. Bodies that are still lazy are left alone, they can be passed once they are parsed.
+std::size_t const selectSuperinstructions(ASTList<ASTBase> const& body);
+///--- Superinstructions ---///
+
 }
\ No newline at end of file
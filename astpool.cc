@@ -0,0 +1,406 @@
+#include "astpool.h"
+
+#include <cstring>
+#include <functional>
+
+namespace xeouz
+{
+
+namespace
+{
+
+char const ImageMagic[8] = {'A', 'P', 'H', 'E', 'L', 'A', 'S', 'T'};
+std::uint32_t const ImageByteOrder = 0x01020304;
+
+// Byte offset of every section of an image, each one starts 8-byte aligned after the header
+struct ImageLayout
+{
+    std::uint64_t numbers, offsets, firsts, seconds, payloads, lists, string_offsets, kinds, ops, string_bytes;
+    std::uint64_t size;
+};
+
+ImageLayout layoutImage(ASTPoolImageHeader const& header)
+{
+    std::uint64_t at = sizeof(ASTPoolImageHeader);
+    auto section = [&](std::uint64_t bytes) {
+        std::uint64_t begin = (at + 7) & ~(std::uint64_t)7;
+        at = begin + bytes;
+        return begin;
+    };
+
+    std::uint64_t nodes = header.node_count;
+    ImageLayout layout;
+    layout.numbers = section(header.number_count * sizeof(double));
+    layout.offsets = section(nodes * sizeof(std::uint32_t));
+    layout.firsts = section(nodes * sizeof(std::uint32_t));
+    layout.seconds = section(nodes * sizeof(std::uint32_t));
+    layout.payloads = section(nodes * sizeof(std::uint32_t));
+    layout.lists = section(header.list_words * sizeof(std::uint32_t));
+    layout.string_offsets = section(((std::uint64_t)header.string_count + 1) * sizeof(std::uint32_t));
+    layout.kinds = section(nodes);
+    layout.ops = section(nodes);
+    layout.string_bytes = section(header.string_bytes);
+    layout.size = at;
+    return layout;
+}
+
+}
+
+///--- AST Pool ---///
+ASTPool::ASTPool(): string_offsets(1, 0), root(None)
+{
+    bindColumns();
+}
+
+std::uint32_t const ASTPool::getRoot() const
+{
+    return root;
+}
+std::size_t const ASTPool::size() const
+{
+    return columns.node_count;
+}
+std::size_t const ASTPool::getStringCount() const
+{
+    return columns.string_count;
+}
+// Memory held by the pool, the mapping for a mapped image
+std::size_t const ASTPool::getByteSize() const
+{
+    if(image)
+        return image->getLength();
+    return kinds.capacity() + ops.capacity()
+        + (offsets.capacity() + firsts.capacity() + seconds.capacity() + payloads.capacity()) * sizeof(std::uint32_t)
+        + numbers.capacity() * sizeof(double) + string_offsets.capacity() * sizeof(std::uint32_t) + string_bytes.capacity()
+        + lists.capacity() * sizeof(std::uint32_t) + lazy_bodies.capacity() * sizeof(LazyBody);
+}
+
+// Appends a row for `ast` and queues it, its fields are filled in once it is taken off the queue
+std::uint32_t ASTPool::addNode(ASTBase const* ast)
+{
+    if(!ast)
+        return None;
+
+    std::uint32_t node = kinds.size();
+    kinds.push_back(ast->type);
+    ops.push_back(T_EOF);
+    offsets.push_back(ast->getOffset());
+    firsts.push_back(None);
+    seconds.push_back(None);
+    payloads.push_back(None);
+
+    pending.push_back({ast, node});
+    return node;
+}
+std::uint32_t ASTPool::addString(std::string_view value)
+{
+    auto it = string_ids.find(value);
+    if(it != string_ids.end())
+        return it->second;
+
+    std::uint32_t id = string_offsets.size() - 1;
+    string_bytes.insert(string_bytes.end(), value.begin(), value.end());
+    string_offsets.push_back(string_bytes.size());
+    string_ids.insert({value, id});
+    return id;
+}
+template <typename T>
+std::uint32_t ASTPool::addList(ASTList<T> const& nodes)
+{
+    std::uint32_t list = lists.size();
+    lists.push_back(nodes.size());
+    lists.resize(lists.size() + nodes.size(), None);
+    for(std::size_t i=0; i<nodes.size(); ++i)
+    {
+        std::uint32_t node = addNode(nodes[i].get());
+        lists[list + 1 + i] = node;
+    }
+    return list;
+}
+
+void ASTPool::fillNode(ASTBase const* ast, std::uint32_t node)
+{
+    std::uint32_t first = None, second = None, payload = None;
+    switch(ast->type)
+    {
+        case AST_MAIN: first = addList(((MainAST const*)ast)->getBody()); break;
+
+        case AST_VAR: payload = addString(((VariableAST const*)ast)->getName()); break;
+        case AST_VARDEF: {
+            auto* def = (VariableDefinitionAST const*)ast;
+            first = addNode(def->getValue());
+            payload = addString(def->getName());
+            break;
+        }
+        case AST_VARASSIGN: {
+            auto* assign = (VariableAssignmentAST const*)ast;
+            first = addNode(assign->getValue());
+            payload = addString(assign->getName());
+            ops[node] = assign->getShorthandOperator();
+            break;
+        }
+
+        case AST_CALL: {
+            auto* call = (FunctionCallAST const*)ast;
+            first = addList(call->getArguments());
+            payload = addString(call->getName());
+            break;
+        }
+        case AST_SEQUENCE: first = addList(((SequenceAST const*)ast)->getBody()); break;
+        case AST_DOFOR: {
+            auto* dofor = (DoForAST const*)ast;
+            first = addNode(dofor->getForTimes());
+            second = addList(dofor->getSequences());
+            break;
+        }
+
+        case AST_NUMBER: {
+            payload = numbers.size();
+            numbers.push_back(((NumberAST const*)ast)->getValue());
+            break;
+        }
+        case AST_STRING: payload = addString(((StringAST const*)ast)->getValue()); break;
+        case AST_EXTERN: payload = addString(((ExternAST const*)ast)->getName()); break;
+
+        case AST_BINOP: {
+            auto* binop = (BinaryOperationAST const*)ast;
+            first = addNode(binop->getLHS());
+            second = addNode(binop->getRHS());
+            ops[node] = binop->getOperator();
+            break;
+        }
+        case AST_IF: {
+            auto* ifstm = (IfAST const*)ast;
+            first = addNode(ifstm->getExpression());
+            second = addList(ifstm->getBody());
+            if(ifstm->getLazyBody().isPending())
+            {
+                payload = lazy_bodies.size();
+                lazy_bodies.push_back(ifstm->getLazyBody());
+            }
+            break;
+        }
+        case AST_IFELSE: {
+            auto* ifelse = (IfElseAST const*)ast;
+            first = addList(ifelse->getIfStatements());
+            second = addList(ifelse->getElseBody());
+            if(ifelse->getLazyElseBody().isPending())
+            {
+                payload = lazy_bodies.size();
+                lazy_bodies.push_back(ifelse->getLazyElseBody());
+            }
+            break;
+        }
+    }
+
+    firsts[node] = first;
+    seconds[node] = second;
+    payloads[node] = payload;
+}
+// Subtrees are lowered off an explicit queue, generated expressions can be deeper than the stack
+void ASTPool::drainPending()
+{
+    while(!pending.empty())
+    {
+        auto entry = pending.back();
+        pending.pop_back();
+        fillNode(entry.first, entry.second);
+    }
+}
+// The getters read through raw column pointers, rebound whenever the vectors may have moved
+void ASTPool::bindColumns()
+{
+    columns = {
+        kinds.data(), ops.data(), offsets.data(), firsts.data(), seconds.data(), payloads.data(),
+        numbers.data(), string_offsets.data(), string_bytes.data(), lists.data(), kinds.size(), string_offsets.size() - 1
+    };
+}
+std::uint32_t ASTPool::lower(ASTBase const* ast)
+{
+    std::uint32_t node = addNode(ast);
+    drainPending();
+    string_ids.clear(); // The interned views die with the AST
+    bindColumns();
+    return node;
+}
+
+bool const ASTPool::hasLazyBody(std::uint32_t node) const
+{
+    int kind = columns.kinds[node];
+    return (kind == AST_IF || kind == AST_IFELSE) && columns.payloads[node] != None;
+}
+LazyBody const& ASTPool::getLazyBody(std::uint32_t node) const
+{
+    return lazy_bodies[columns.payloads[node]];
+}
+void ASTPool::setBody(std::uint32_t node, ASTList<ASTBase> const& body)
+{
+    std::uint32_t list = addList(body);
+    drainPending();
+    string_ids.clear();
+
+    seconds[node] = list;
+    payloads[node] = None;
+    bindColumns();
+}
+std::uint64_t const ASTPool::hashStructure(std::uint32_t node) const
+{
+    std::uint64_t hash = 0;
+    std::vector<std::uint32_t> pending = {node};
+    auto push_list = [&](std::uint32_t list) {
+        std::uint32_t size = getListSize(list);
+        hash = mixHash(hash, size);
+        for(std::uint32_t i=size; i-- > 0;)
+            pending.push_back(getListItem(list, i));
+    };
+    while(!pending.empty())
+    {
+        std::uint32_t current = pending.back();
+        pending.pop_back();
+        if(current == None)
+        {
+            hash = mixHash(hash, UINT32_MAX);
+            continue;
+        }
+
+        int kind = getKind(current);
+        hash = mixHash(hash, kind);
+        switch(kind)
+        {
+            case AST_MAIN: case AST_SEQUENCE: push_list(getFirst(current)); break;
+
+            case AST_VAR: case AST_STRING: case AST_EXTERN: hash = mixHash(hash, std::hash<std::string_view>()(getString(current))); break;
+            case AST_VARDEF: case AST_VARASSIGN:
+                hash = mixHash(hash, std::hash<std::string_view>()(getString(current)));
+                if(kind == AST_VARASSIGN)
+                    hash = mixHash(hash, getOperator(current));
+                pending.push_back(getFirst(current));
+                break;
+
+            case AST_CALL:
+                hash = mixHash(hash, std::hash<std::string_view>()(getString(current)));
+                push_list(getFirst(current));
+                break;
+            case AST_DOFOR:
+                push_list(getSecond(current));
+                pending.push_back(getFirst(current));
+                break;
+
+            case AST_NUMBER: {
+                double value = getNumber(current);
+                std::uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                hash = mixHash(hash, bits);
+                break;
+            }
+
+            case AST_BINOP:
+                hash = mixHash(hash, getOperator(current));
+                pending.push_back(getSecond(current));
+                pending.push_back(getFirst(current));
+                break;
+            case AST_IF:
+                if(hasLazyBody(current))
+                    hash = mixHash(hash, (std::uintptr_t)&getLazyBody(current));
+                push_list(getSecond(current));
+                pending.push_back(getFirst(current));
+                break;
+            case AST_IFELSE:
+                if(hasLazyBody(current))
+                    hash = mixHash(hash, (std::uintptr_t)&getLazyBody(current));
+                push_list(getSecond(current));
+                push_list(getFirst(current));
+                break;
+        }
+    }
+    return hash;
+}
+
+bool const ASTPool::writeImage(std::string& out, std::uint64_t source_hash, std::uint64_t build_id) const
+{
+    if(image)
+        return false;
+    for(std::uint32_t node=0; node<kinds.size(); ++node)
+        if(hasLazyBody(node))
+            return false;
+
+    ASTPoolImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, ImageMagic, sizeof(ImageMagic));
+    header.version = ImageVersion;
+    header.byte_order = ImageByteOrder;
+    header.source_hash = source_hash;
+    header.build_id = build_id;
+    header.root = root;
+    header.node_count = kinds.size();
+    header.number_count = numbers.size();
+    header.string_count = string_offsets.size() - 1;
+    header.string_bytes = string_bytes.size();
+    header.list_words = lists.size();
+
+    ImageLayout layout = layoutImage(header);
+    header.image_size = layout.size;
+
+    out.assign(layout.size, '\0');
+    char* base = out.data();
+    auto put = [&](std::uint64_t at, void const* data, std::size_t bytes) {
+        if(bytes)
+            std::memcpy(base + at, data, bytes);
+    };
+    put(0, &header, sizeof(header));
+    put(layout.numbers, numbers.data(), numbers.size() * sizeof(double));
+    put(layout.offsets, offsets.data(), offsets.size() * sizeof(std::uint32_t));
+    put(layout.firsts, firsts.data(), firsts.size() * sizeof(std::uint32_t));
+    put(layout.seconds, seconds.data(), seconds.size() * sizeof(std::uint32_t));
+    put(layout.payloads, payloads.data(), payloads.size() * sizeof(std::uint32_t));
+    put(layout.lists, lists.data(), lists.size() * sizeof(std::uint32_t));
+    put(layout.string_offsets, string_offsets.data(), string_offsets.size() * sizeof(std::uint32_t));
+    put(layout.kinds, kinds.data(), kinds.size());
+    put(layout.ops, ops.data(), ops.size());
+    put(layout.string_bytes, string_bytes.data(), string_bytes.size());
+    return true;
+}
+bool const ASTPool::isMapped() const
+{
+    return image != nullptr;
+}
+
+std::unique_ptr<ASTPool> ASTPool::build(MainAST const* main)
+{
+    auto pool = std::make_unique<ASTPool>();
+    pool->root = pool->lower(main);
+    return pool;
+}
+std::unique_ptr<ASTPool> ASTPool::mapImage(std::unique_ptr<SourceBuffer> image, std::uint64_t source_hash, std::uint64_t build_id)
+{
+    std::string_view bytes = image->getText();
+    if(bytes.size() < sizeof(ASTPoolImageHeader))
+        return nullptr;
+
+    ASTPoolImageHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if(std::memcmp(header.magic, ImageMagic, sizeof(ImageMagic)) != 0 || header.version != ImageVersion || header.byte_order != ImageByteOrder)
+        return nullptr;
+    if(header.source_hash != source_hash || header.build_id != build_id)
+        return nullptr;
+
+    ImageLayout layout = layoutImage(header);
+    if(layout.size != header.image_size || bytes.size() < layout.size || header.root >= header.node_count)
+        return nullptr;
+
+    char const* base = bytes.data();
+    auto pool = std::make_unique<ASTPool>();
+    pool->columns = {
+        (std::uint8_t const*)(base + layout.kinds), (std::uint8_t const*)(base + layout.ops),
+        (std::uint32_t const*)(base + layout.offsets), (std::uint32_t const*)(base + layout.firsts),
+        (std::uint32_t const*)(base + layout.seconds), (std::uint32_t const*)(base + layout.payloads),
+        (double const*)(base + layout.numbers), (std::uint32_t const*)(base + layout.string_offsets),
+        base + layout.string_bytes, (std::uint32_t const*)(base + layout.lists), header.node_count, header.string_count
+    };
+    pool->root = header.root;
+    pool->image = std::move(image);
+    return pool;
+}
+///--- AST Pool ---///
+
+}
\ No newline at end of file
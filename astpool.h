@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "source.h"
+
+namespace xeouz
+{
+
+///--- AST Pool ---///
+// Contiguous view of a parsed program for the interpreter to walk. Every node is one row spread
+// over parallel arrays and is addressed by a 32-bit index. What `first` and `second` refer to
+// depends on the kind:
+//   MAIN       first: statement list
+//   VAR        payload: name
+//   VARDEF     first: value                payload: name
+//   VARASSIGN  first: value                payload: name       op: shorthand operator or T_EOF
+//   CALL       first: argument list        payload: name
+//   SEQUENCE   first: call list
+//   DOFOR      first: times                second: sequence list
+//   NUMBER     payload: number
+//   STRING     payload: string
+//   EXTERN     payload: name
+//   BINOP      first: lhs                  second: rhs         op: operator
+//   IF         first: condition            second: body list   payload: lazy body or None
+//   IFELSE     first: if list              second: else list   payload: lazy else body or None
+struct ASTPoolImageHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t source_hash;
+    std::uint64_t build_id;
+    std::uint64_t image_size;
+    std::uint32_t root;
+    std::uint32_t node_count;
+    std::uint32_t number_count;
+    std::uint32_t string_count;
+    std::uint32_t string_bytes;
+    std::uint32_t list_words;
+};
+
+class ASTPool
+{
+    std::vector<std::uint8_t> kinds;
+    std::vector<std::uint8_t> ops;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> firsts;
+    std::vector<std::uint32_t> seconds;
+    std::vector<std::uint32_t> payloads;
+
+    std::vector<double> numbers;
+    std::vector<std::uint32_t> string_offsets; // String i is string_bytes[string_offsets[i], string_offsets[i+1])
+    std::vector<char> string_bytes;
+    std::unordered_map<std::string_view, std::uint32_t> string_ids; // Views into the AST being lowered
+    std::vector<std::uint32_t> lists; // Each list is its length followed by its node indices
+    std::vector<LazyBody> lazy_bodies;
+    std::uint32_t root;
+
+    std::vector<std::pair<ASTBase const*, std::uint32_t>> pending;
+
+    // What the getters read, either the vectors above or a mapped image
+    struct Columns
+    {
+        std::uint8_t const* kinds;
+        std::uint8_t const* ops;
+        std::uint32_t const* offsets;
+        std::uint32_t const* firsts;
+        std::uint32_t const* seconds;
+        std::uint32_t const* payloads;
+        double const* numbers;
+        std::uint32_t const* string_offsets;
+        char const* string_bytes;
+        std::uint32_t const* lists;
+        std::size_t node_count;
+        std::size_t string_count;
+    } columns;
+    std::unique_ptr<SourceBuffer> image;
+
+    std::uint32_t addNode(ASTBase const* ast);
+    std::uint32_t addString(std::string_view value);
+    template <typename T>
+    std::uint32_t addList(ASTList<T> const& nodes);
+    void fillNode(ASTBase const* ast, std::uint32_t node);
+    void drainPending();
+    void bindColumns();
+    std::uint32_t lower(ASTBase const* ast);
+public:
+    static constexpr std::uint32_t None = UINT32_MAX;
+    static constexpr std::uint32_t ImageVersion = 1;
+
+    ASTPool();
+
+    std::uint32_t const getRoot() const;
+    std::size_t const size() const;
+    std::size_t const getByteSize() const;
+    std::size_t const getStringCount() const;
+
+    int const getKind(std::uint32_t node) const
+    {
+        return columns.kinds[node];
+    }
+    int const getOperator(std::uint32_t node) const
+    {
+        return columns.ops[node];
+    }
+    std::uint32_t const getOffset(std::uint32_t node) const
+    {
+        return columns.offsets[node];
+    }
+    std::uint32_t const getFirst(std::uint32_t node) const
+    {
+        return columns.firsts[node];
+    }
+    std::uint32_t const getSecond(std::uint32_t node) const
+    {
+        return columns.seconds[node];
+    }
+    double const getNumber(std::uint32_t node) const
+    {
+        return columns.numbers[columns.payloads[node]];
+    }
+    // Interned while the pool is built, every use of a name lowered together has the same id
+    std::uint32_t const getStringId(std::uint32_t node) const
+    {
+        return columns.payloads[node];
+    }
+    std::string_view getString(std::uint32_t node) const
+    {
+        std::uint32_t id = columns.payloads[node];
+        std::uint32_t begin = columns.string_offsets[id];
+        return std::string_view(columns.string_bytes + begin, columns.string_offsets[id + 1] - begin);
+    }
+
+    std::uint32_t const getListSize(std::uint32_t list) const
+    {
+        return columns.lists[list];
+    }
+    // By index, setBody may grow the list storage while a list is being walked
+    std::uint32_t const getListItem(std::uint32_t list, std::uint32_t index) const
+    {
+        return columns.lists[list + 1 + index];
+    }
+
+    bool const hasLazyBody(std::uint32_t node) const;
+    LazyBody const& getLazyBody(std::uint32_t node) const;
+    // Lowers a body parsed after the pool was built and makes it the IF body or IFELSE else body of `node`
+    void setBody(std::uint32_t node, ASTList<ASTBase> const& body);
+
+    // Same as hashStructure on the AST the subtree was lowered from, a pending lazy body never matches another
+    std::uint64_t const hashStructure(std::uint32_t node) const;
+
+    // Relocatable image of the pool, every reference in it is an index. Fails while a lazy body is still pending.
+    bool const writeImage(std::string& out, std::uint64_t source_hash, std::uint64_t build_id) const;
+    bool const isMapped() const;
+
+    static std::unique_ptr<ASTPool> build(MainAST const* main);
+    // Walks `image` in place. Returns nullptr if it is not an image of this version, source and build.
+    static std::unique_ptr<ASTPool> mapImage(std::unique_ptr<SourceBuffer> image, std::uint64_t source_hash, std::uint64_t build_id);
+};
+///--- AST Pool ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,749 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <algorithm>
+
+#include "lex.h"
+#include "parse.h"
+#include "ast.h"
+#include "threadpool.h"
+#include "interpret.h"
+#include "loader.h"
+#include "incremental.h"
+#include "regvm.h"
+#include "jit.h"
+#include "aot.h"
+#include "tier.h"
+
+using namespace xeouz;
+
+///--- Helpers ---///
+static volatile long long bench_sink = 0;
+
+template <typename F>
+double time_ms(F&& func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void report(std::string const& name, double ms, std::size_t ops)
+{
+    std::cout << "  " << name << ": " << ms << " ms";
+    if(ops)
+        std::cout << " (" << (ms * 1e6 / ops) << " ns/op)";
+    std::cout << std::endl;
+}
+
+// Operator-heavy program: `count` definitions of long arithmetic and comparison chains
+std::string generate_operator_source(std::size_t count)
+{
+    std::string text;
+    for(std::size_t i=0; i<count; ++i)
+    {
+        text += "let v" + std::to_string(i) + " = a + b * 2 - c / 4 % 5 + (d - e) * f <= g + h * 3 - i / j\n";
+        text += "if (v" + std::to_string(i) + " == 1 + 2 * 3 - 4) print(x + y - z * w / q)\n";
+    }
+    return text;
+}
+///--- Helpers ---///
+
+///--- Lookup Benchmarks ---///
+// The unordered_map lookups the lexer and parser used before the constexpr tables
+void bench_keyword_lookup()
+{
+    std::cout << "Keyword recognition" << std::endl;
+
+    std::unordered_map<std::string, int> map_keywords;
+    for(auto const& keyword: Keywords)
+        map_keywords.insert({std::string(keyword.word), keyword.type});
+
+    std::vector<std::string> words = {
+        "if", "value", "let", "counter", "do", "through", "print", "and", "x", "for", "extern", "total_count", "true", "else", "false", "or"
+    };
+    std::size_t const iterations = 2000000;
+
+    double map_ms = time_ms([&]() {
+        long long sum = 0;
+        for(std::size_t i=0; i<iterations; ++i)
+        {
+            std::string_view word = words[i % words.size()];
+            auto it = map_keywords.find(std::string(word));
+            sum += it == map_keywords.end() ? -1 : it->second;
+        }
+        bench_sink = sum;
+    });
+    double hash_ms = time_ms([&]() {
+        long long sum = 0;
+        for(std::size_t i=0; i<iterations; ++i)
+        {
+            std::string_view word = words[i % words.size()];
+            sum += Token::getKeywordTokenType(word);
+        }
+        bench_sink = sum;
+    });
+
+    report("unordered_map<string>", map_ms, iterations);
+    report("constexpr perfect hash", hash_ms, iterations);
+}
+
+void bench_precedence_lookup()
+{
+    std::cout << "Operator precedence" << std::endl;
+
+    std::unordered_map<std::string, int> map_precedence = {
+        {"<", 10}, {">", 10}, {"<=", 10}, {">=", 10}, {"==", 10}, {"!=", 10},
+        {"+", 20}, {"-", 20}, {"*", 40}, {"/", 40}, {"%", 40}, {"**", 60}
+    };
+
+    auto lexer = Lexer::create(generate_operator_source(2000));
+    TokenBuffer tokens;
+    lexer->tokenize(tokens);
+    std::size_t const passes = 20;
+
+    double map_ms = time_ms([&]() {
+        long long sum = 0;
+        for(std::size_t pass=0; pass<passes; ++pass)
+            for(std::size_t i=0; i<tokens.size(); ++i)
+            {
+                // Looked up twice per operator, once for the operator and once as the next operator
+                for(int lookup=0; lookup<2; ++lookup)
+                {
+                    auto it = map_precedence.find(std::string(tokens.getValue(i)));
+                    sum += it == map_precedence.end() ? -1 : it->second;
+                }
+            }
+        bench_sink = sum;
+    });
+    double table_ms = time_ms([&]() {
+        long long sum = 0;
+        for(std::size_t pass=0; pass<passes; ++pass)
+            for(std::size_t i=0; i<tokens.size(); ++i)
+                for(int lookup=0; lookup<2; ++lookup)
+                    sum += ParserPrecedenceTable[tokens.getType(i)];
+        bench_sink = sum;
+    });
+
+    report("unordered_map<string> by value", map_ms, passes * tokens.size() * 2);
+    report("token type table", table_ms, passes * tokens.size() * 2);
+}
+///--- Lookup Benchmarks ---///
+
+///--- Lexer Benchmarks ---///
+// Flat machine-generated program, the shape parallel lexing is meant for
+std::string generate_flat_source(std::size_t count)
+{
+    std::string text;
+    for(std::size_t i=0; i<count; ++i)
+    {
+        text += "let value_" + std::to_string(i) + " = add(" + std::to_string(i) + ", 2.5) * 3\n";
+        text += "print(\"row " + std::to_string(i) + "\", value_" + std::to_string(i) + ")\n";
+    }
+    return text;
+}
+
+bool same_tokens(TokenBuffer const& a, TokenBuffer const& b)
+{
+    if(a.size() != b.size())
+        return false;
+    for(std::size_t i=0; i<a.size(); ++i)
+        if(a.getType(i) != b.getType(i) || a.getOffset(i) != b.getOffset(i) || a.getLength(i) != b.getLength(i))
+            return false;
+    return true;
+}
+
+void bench_parallel_tokenize()
+{
+    std::cout << "Tokenize flat source" << std::endl;
+
+    std::string text = generate_flat_source(400000);
+    auto pool = ThreadPool::create();
+
+    TokenBuffer serial, parallel;
+    double serial_ms = time_ms([&]() {
+        Lexer::borrow(text)->tokenize(serial);
+    });
+    double parallel_ms = time_ms([&]() {
+        Lexer::borrow(text)->tokenizeParallel(parallel, *pool);
+    });
+
+    std::string size = std::to_string(text.size() / (1024 * 1024)) + " MiB";
+    report("serial, " + size, serial_ms, serial.size());
+    report("parallel, " + std::to_string(pool->getThreadCount()) + " threads", parallel_ms, parallel.size());
+    std::cout << "  identical: " << (same_tokens(serial, parallel) ? "yes" : "no") << std::endl;
+}
+///--- Lexer Benchmarks ---///
+
+///--- Parser Benchmarks ---///
+void bench_parse_operators()
+{
+    std::cout << "Parse operator-heavy source" << std::endl;
+
+    std::string text = generate_operator_source(20000);
+    std::size_t token_count = 0;
+
+    double ms = time_ms([&]() {
+        auto parser = Parser::create(Lexer::borrow(text));
+        auto ast = parser->ParseMain();
+        token_count = parser->getTokens().size();
+        bench_sink = ast ? ast->getBody().size() : 0;
+    });
+
+    report(std::to_string(text.size() / 1024) + " KiB, " + std::to_string(token_count) + " tokens", ms, token_count);
+}
+
+void bench_parse_long_expressions()
+{
+    std::cout << "Parse generated expressions" << std::endl;
+
+    std::size_t const terms = 1000000;
+    std::string chain = "let v = x", logical = "let v = x", nested = "let v = ";
+    for(std::size_t i=0; i<terms; ++i)
+    {
+        chain += i % 2 ? " * 2" : " + 1";
+        logical += " and x";
+        nested += "(";
+    }
+    nested += "1" + std::string(terms, ')');
+
+    std::vector<std::pair<std::string, std::string*>> cases = {
+        {"operator chain", &chain}, {"and chain", &logical}, {"nested parentheses", &nested}
+    };
+    for(auto const& entry: cases)
+    {
+        bool parsed = false;
+        double ms = time_ms([&]() {
+            auto parser = Parser::create(Lexer::borrow(*entry.second));
+            parsed = parser->ParseMain() != nullptr;
+        });
+        report(entry.first + ", " + std::to_string(terms) + " terms" + (parsed ? "" : " (failed)"), ms, terms);
+    }
+}
+
+// Rule script where every branch body is braced and almost none of them run
+std::string generate_rule_source(std::size_t count)
+{
+    std::string text;
+    for(std::size_t i=0; i<count; ++i)
+    {
+        std::string n = std::to_string(i);
+        text += "if (state == " + n + ") { print(\"rule " + n + "\", add(" + n + ", 2) * 3 - weight / 4 + (bias - " + n + ") * 2) }";
+        text += " else { print(\"skip " + n + "\", total + " + n + " * 2 - 1) }\n";
+    }
+    return text;
+}
+
+void bench_parse_lazy_bodies()
+{
+    std::cout << "Parse rule script" << std::endl;
+
+    std::string text = generate_rule_source(100000);
+    for(bool lazy: {false, true})
+    {
+        double ms = time_ms([&]() {
+            auto parser = Parser::create(Lexer::borrow(text));
+            parser->setLazyBodies(lazy);
+            auto ast = parser->ParseMain();
+            bench_sink = ast ? ast->getBody().size() : 0;
+        });
+        report(std::string(lazy ? "lazy" : "eager") + " bodies, " + std::to_string(text.size() / 1024) + " KiB", ms, 0);
+    }
+}
+
+void bench_parse_and_free()
+{
+    std::cout << "Parse and free, heap nodes vs arena" << std::endl;
+
+    std::string text = generate_flat_source(200000);
+    std::size_t const passes = 3;
+
+    double heap_parse = 0, heap_free = 0, arena_parse = 0, arena_free = 0;
+    for(std::size_t pass=0; pass<passes; ++pass)
+    {
+        auto heap_parser = Parser::create(Lexer::borrow(text));
+        std::unique_ptr<MainAST> heap_ast;
+        heap_parse += time_ms([&]() { heap_ast = heap_parser->ParseMain(); });
+        heap_free += time_ms([&]() { heap_ast.reset(); });
+
+        auto arena_parser = Parser::create(Lexer::borrow(text));
+        std::unique_ptr<Program> program;
+        arena_parse += time_ms([&]() { program = arena_parser->ParseProgram(); });
+        arena_free += time_ms([&]() { program.reset(); });
+    }
+
+    std::string size = std::to_string(text.size() / (1024 * 1024)) + " MiB";
+    report("unique_ptr nodes, parse " + size, heap_parse / passes, 0);
+    report("unique_ptr nodes, free", heap_free / passes, 0);
+    report("arena, parse " + size, arena_parse / passes, 0);
+    report("arena, free", arena_free / passes, 0);
+}
+
+void bench_load_units()
+{
+    std::cout << "Load a multi-file rule set" << std::endl;
+
+    std::vector<std::string> sources;
+    for(std::size_t i=0; i<200; ++i)
+        sources.push_back(generate_rule_source(500));
+
+    std::size_t const threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    for(std::size_t thread_count: {std::size_t(1), threads})
+    {
+        auto workers = ThreadPool::create(thread_count);
+        std::size_t statement_count = 0;
+        double ms = time_ms([&]() {
+            auto loader = ProgramLoader::create(workers.get());
+            for(std::size_t i=0; i<sources.size(); ++i)
+                loader->addSource("rules_" + std::to_string(i) + ".lang", sources[i]);
+            auto program = loader->load();
+            statement_count = program ? program->getMain()->getBody().size() : 0;
+        });
+        report(std::to_string(sources.size()) + " units, " + std::to_string(thread_count) + " threads, " + std::to_string(statement_count) + " statements", ms, 0);
+    }
+}
+
+void bench_incremental_session()
+{
+    std::cout << "Grow and edit a REPL session" << std::endl;
+
+    std::string text = generate_flat_source(20000);
+    std::vector<std::string> inputs;
+    for(std::size_t begin=0; begin<text.size();)
+    {
+        std::size_t end = text.find('\n', begin) + 1;
+        inputs.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    auto session = IncrementalParser::create();
+    double append_ms = time_ms([&]() {
+        for(auto const& input: inputs)
+            session->append(input);
+    });
+
+    // What each input cost before: a new Parser over everything entered so far
+    std::size_t const rebuilds = 50;
+    double rebuild_ms = time_ms([&]() {
+        for(std::size_t i=0; i<rebuilds; ++i)
+        {
+            auto parser = Parser::create(Lexer::borrow(session->getText()));
+            bench_sink = parser->ParseMain() != nullptr;
+        }
+    });
+
+    std::size_t const edits = 2000;
+    std::size_t reparsed = 0;
+    double edit_ms = time_ms([&]() {
+        for(std::size_t i=0; i<edits; ++i)
+        {
+            std::size_t offset = session->getStatementOffset((i * 7919) % session->getStatementCount());
+            session->edit(offset, 0, i % 2 ? "let edited = 1\n" : "print(1)\n");
+            reparsed += session->getReparsedCount();
+        }
+    });
+
+    report("append, " + std::to_string(inputs.size()) + " inputs", append_ms, inputs.size());
+    report("reparse everything, at " + std::to_string(inputs.size()) + " inputs", rebuild_ms, rebuilds);
+    report("edit, " + std::to_string(reparsed / edits) + " statements reparsed per edit", edit_ms, edits);
+}
+///--- Parser Benchmarks ---///
+
+///--- Interpreter Benchmarks ---///
+class BenchLib: public FCIFunctionLibraryBase
+{
+public:
+    BenchLib(): FCIFunctionLibraryBase("bench")
+    {
+        useFunction("add", &BenchLib::add, {.args = {{"a", VT_NUMBER}, {"b", VT_NUMBER}}, .ret_type = VT_NUMBER});
+    }
+
+    static FCIType add(FCIArguments args)
+    {
+        return VariableNumberData::create(args["a"]->getAsNumber()->getValue() + args["b"]->getAsNumber()->getValue());
+    }
+};
+
+// BenchLib on the Value interface
+class BenchValueLib: public FCIFunctionLibraryBase
+{
+public:
+    BenchValueLib(): FCIFunctionLibraryBase("bench")
+    {
+        useValueFunction("add", &BenchValueLib::add, {.args = {{"a", VT_NUMBER}, {"b", VT_NUMBER}}, .ret_type = VT_NUMBER});
+    }
+
+    static Value add(Value const* args)
+    {
+        return Value::createNumber(args[0].getNumber() + args[1].getNumber());
+    }
+};
+
+// Straight-line arithmetic with branches and do-for loops, nothing is printed
+std::string generate_compute_source(std::size_t count)
+{
+    std::string text = "let a = 1\nlet b = 2\nlet c = 3\nlet total = 0\nlet step = <add(a, b), add(b, c)>\n";
+    for(std::size_t i=0; i<count; ++i)
+    {
+        std::string n = std::to_string(i);
+        text += "let v" + n + " = a + b * 2 - c / 4 + (a - " + n + ") * 3\n";
+        text += "total += v" + n + " % 7 + add(a, b) * 2\n";
+        text += "if (total > " + n + ") { a += 1 } else { b += 1 }\n";
+        text += "do step for 4\n";
+    }
+    return text;
+}
+
+void bench_interpret_backends()
+{
+    std::cout << "Interpret compute source" << std::endl;
+
+    std::string text = generate_compute_source(20000);
+    std::string const names[] = {"AST tree", "AST pool", "bytecode", std::string("register, ") + (RegisterVM::usesComputedGoto() ? "computed goto" : "switch"), "closures"};
+    for(int backend: {EB_TREE, EB_POOL, EB_BYTECODE, EB_REGISTER, EB_CLOSURE})
+    {
+        auto interpreter = Interpreter::borrow(text, backend);
+        interpreter->registerFunctionLibrary<BenchLib>();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretMain();
+        });
+        report(names[backend] + ", parse and run", ms, 0);
+    }
+
+    // Without the parse, a loop-heavy script where dispatch dominates
+    std::string loop_text = "let a = 1\nlet b = 2\nlet total = 0\nlet step = <add(a, b), add(total, 1)>\n";
+    for(std::size_t i=0; i<2000; ++i)
+    {
+        loop_text += "total += a * 3 - b / 2 + (a - " + std::to_string(i) + ") * 2\n";
+        loop_text += "if (total > " + std::to_string(i) + ") { a += 1 } else { b += 1 }\n";
+        loop_text += "do step for 20\n";
+    }
+    // Every backend has to end on the variables the tree walker ends on
+    std::vector<double> expected;
+    for(int backend: {EB_TREE, EB_BYTECODE, EB_REGISTER, EB_CLOSURE})
+    {
+        auto interpreter = Interpreter::borrow(loop_text, backend);
+        interpreter->registerFunctionLibrary<BenchLib>();
+        auto program = interpreter->getParser()->ParseProgram();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretProgram(program.get());
+        });
+        report(names[backend] + ", run only", ms, 0);
+
+        std::vector<double> values;
+        for(auto name: {"a", "b", "total"})
+            values.push_back(interpreter->getVariableValue(name).getNumber());
+        if(backend == EB_TREE)
+            expected = values;
+        else if(values != expected)
+            std::cout << "  " << names[backend] << " differs from the AST tree" << std::endl;
+    }
+}
+
+void bench_jit()
+{
+    std::cout << "Interpret numeric loops on closures, with and without the JIT" << (JitModule::isSupported() ? "" : " (not supported here)") << std::endl;
+
+    std::string text = "let a = 1.5\nlet b = 2\nlet total = 0\n";
+    for(std::size_t i=0; i<500; ++i)
+    {
+        std::string n = std::to_string(i);
+        text += "total += a * b - (a - " + n + ") / 3 + total % 7\n";
+        text += "if (total > " + n + ") { a += 1 } else { b += 1 }\n";
+        text += "do <add(a * 2, b - 1), add(add(a, b), " + n + ")> for 200\n";
+    }
+    double expected = 0;
+    for(bool jit: {false, true})
+    {
+        auto interpreter = Interpreter::borrow(text, EB_CLOSURE);
+        interpreter->setJitEnabled(jit);
+        interpreter->registerFunctionLibrary<BenchLib>();
+        auto program = interpreter->getParser()->ParseProgram();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretProgram(program.get());
+        });
+        report(jit ? "JIT" : "closures", ms, 500 * 200 * 3);
+
+        double total = interpreter->getVariableValue("total").getNumber();
+        if(!jit)
+            expected = total;
+        else if(total != expected)
+            std::cout << "  JIT differs from the closures" << std::endl;
+    }
+}
+
+void bench_aot()
+{
+    std::cout << "Interpret numeric statements on closures and ahead-of-time compiled" << std::endl;
+
+    std::string text = "let a = 1.5\nlet b = 2\nlet total = 0\n";
+    for(std::size_t i=0; i<500; ++i)
+    {
+        std::string n = std::to_string(i);
+        text += "total += a * b - (a - " + n + ") / 3 + total % 7\n";
+        text += "if (total > " + n + ") { a += 1 } else { b += add(a, " + n + ") }\n";
+    }
+    std::string directory = (std::filesystem::temp_directory_path() / "aphel-bench-aot").string();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    auto options = std::make_shared<AotOptions>();
+    options->cache_dir = directory;
+
+    double expected = 0;
+    for(int run=0; run<3; ++run)
+    {
+        auto interpreter = Interpreter::borrow(text, run == 0 ? EB_CLOSURE : EB_AOT);
+        interpreter->setAotOptions(options);
+        interpreter->registerFunctionLibrary<BenchLib>();
+        auto program = interpreter->getParser()->ParseProgram();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretProgram(program.get());
+        });
+        // Without a compiler the program ran on the tree walker, its time says nothing about AOT
+        if(run > 0 && interpreter->getAotModuleCount() == 0)
+        {
+            std::cout << "  " << (run == 1 ? "aot, build and run" : "aot, cached, load and run") << ": failed, `" << options->compiler << "` did not build the module" << std::endl;
+            continue;
+        }
+        report(run == 0 ? "closures" : run == 1 ? "aot, build and run" : "aot, cached, load and run", ms, 0);
+
+        if(!interpreter->isVariableDefined("total"))
+            continue;
+        double total = interpreter->getVariableValue("total").getNumber();
+        if(run == 0)
+            expected = total;
+        else if(total != expected)
+            std::cout << "  AOT differs from the closures" << std::endl;
+    }
+    std::filesystem::remove_all(directory, error);
+}
+
+void bench_quickening()
+{
+    std::cout << "Interpret binary operations on the tree walker, with and without quickening" << std::endl;
+
+    std::string text = "let a = 1.5\nlet b = 2\n";
+    text += "let s = <add(a * b - (a - b) / 3, b % 7 + a * a), add(a < b, (a + b) * (a - b)), add(b, 1)>\n";
+    text += "let t = <add(a, b), add(a + b, b + a)>\n";
+    for(std::size_t i=0; i<20; ++i)
+        text += "do s for 5000\ndo t for 2000\n";
+    for(bool quickening: {false, true})
+    {
+        auto interpreter = Interpreter::borrow(text, EB_TREE);
+        interpreter->setQuickeningEnabled(quickening);
+        interpreter->registerFunctionLibrary<BenchLib>();
+        auto program = interpreter->getParser()->ParseProgram();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretProgram(program.get());
+        });
+        report(quickening ? "quickened" : "generic", ms, 20 * (5000 * 9 + 2000 * 2));
+    }
+}
+
+void bench_superinstructions()
+{
+    std::cout << "Interpret common statement shapes on the tree walker, with and without superinstructions" << std::endl;
+
+    std::string text = "let x = 0\n";
+    for(std::size_t i=0; i<3000; ++i)
+    {
+        text += "x += 1\n";
+        text += "let v" + std::to_string(i) + " = add(1, 2)\n";
+        text += "if (x == 3) { x -= 1 }\n";
+    }
+    for(bool superinstructions: {false, true})
+    {
+        auto interpreter = Interpreter::borrow(text, EB_TREE);
+        interpreter->setSuperinstructionsEnabled(superinstructions);
+        interpreter->registerFunctionLibrary<BenchLib>();
+        auto program = interpreter->getParser()->ParseProgram();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretProgram(program.get());
+        });
+        std::string name = superinstructions ? "fused, " + std::to_string(interpreter->getSuperinstructionCount()) + " sites" : "generic";
+        report(name, ms, 3000 * 3);
+    }
+}
+
+void bench_value_functions()
+{
+    std::cout << "Interpret calls on the tree walker, to a VariableDataBase library and a Value one" << std::endl;
+
+    std::string text = "let a = 1.5\nlet b = 2\nlet s = <add(a, b), add(add(a, 1), b * 2), add(a * b, 3)>\n";
+    for(std::size_t i=0; i<20; ++i)
+        text += "do s for 5000\n";
+    for(bool values: {false, true})
+    {
+        auto interpreter = Interpreter::borrow(text, EB_TREE);
+        if(values)
+            interpreter->registerFunctionLibrary<BenchValueLib>();
+        else
+            interpreter->registerFunctionLibrary<BenchLib>();
+        auto program = interpreter->getParser()->ParseProgram();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretProgram(program.get());
+        });
+        report(values ? "Value" : "VariableDataBase", ms, 20 * 5000 * 4);
+    }
+}
+
+void bench_tiering()
+{
+    std::cout << "Interpret do-for loops on the tree walker, with and without tiering" << std::endl;
+
+    std::string text = "let a = 1.5\nlet b = 2\nlet s = <add(a * 2, b - 1), add(add(a, b), a / b)>\n";
+    for(std::size_t i=0; i<20; ++i)
+    {
+        text += "do s for 5000\n";
+        text += "do <add(a, " + std::to_string(i) + "), add(b * a, b)> for 5000\n";
+    }
+    for(bool tiering: {false, true})
+    {
+        auto interpreter = Interpreter::borrow(text, EB_TREE);
+        interpreter->setTieringEnabled(tiering);
+        interpreter->registerFunctionLibrary<BenchLib>();
+        auto program = interpreter->getParser()->ParseProgram();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretProgram(program.get());
+        });
+        if(!tiering)
+        {
+            report("tree walker", ms, 40 * 5000 * 2);
+            continue;
+        }
+        TierStats stats = interpreter->getTierManager()->getStats();
+        report("tiered, " + std::to_string(stats.promoted) + " sequences promoted, " + std::to_string(stats.switched) + " loops switched", ms, 40 * 5000 * 2);
+    }
+}
+
+void bench_program_cache()
+{
+    std::cout << "Interpret compute source on the AST pool through the program cache" << std::endl;
+
+    std::string text = generate_compute_source(20000);
+    std::string directory = (std::filesystem::temp_directory_path() / "aphel-bench-cache").string();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    auto cache = ProgramCache::create(directory);
+    for(bool hit: {false, true})
+    {
+        auto interpreter = Interpreter::borrow(text, EB_POOL);
+        interpreter->setProgramCache(cache.get());
+        interpreter->registerFunctionLibrary<BenchLib>();
+
+        double ms = time_ms([&]() {
+            interpreter->interpretMain();
+        });
+        report(std::string(hit ? "hit, map" : "miss, parse and store") + " and run", ms, 0);
+    }
+    std::filesystem::remove_all(directory, error);
+}
+
+// Library-free script, `variant` changes the constants so every variant hashes differently
+std::string generate_request_source(std::size_t variant, std::size_t count)
+{
+    std::string text = "let a = " + std::to_string(variant) + "\nlet b = 2\nlet total = 0\n";
+    for(std::size_t i=0; i<count; ++i)
+    {
+        std::string n = std::to_string(i + variant);
+        text += "let v" + n + " = a * 3 - b / 2 + (a - " + n + ") * 2\n";
+        text += "if (v" + n + " > " + n + ") { total += v" + n + " % 5 } else { b += 1 }\n";
+    }
+    return text;
+}
+
+void bench_program_memory_cache()
+{
+    std::cout << "Interpret recurring requests on the AST pool through the memory cache" << std::endl;
+
+    std::vector<std::string> scripts;
+    for(std::size_t variant=0; variant<8; ++variant)
+        scripts.push_back(generate_request_source(variant, 2000));
+
+    std::size_t const requests = 256;
+    auto workers = ThreadPool::create();
+    auto cache = ProgramMemoryCache::create();
+    for(bool cached: {false, true})
+    {
+        double ms = time_ms([&]() {
+            for(std::size_t i=0; i<requests; ++i)
+                workers->submit([&, i]() {
+                    auto interpreter = Interpreter::create(scripts[i % scripts.size()], EB_POOL);
+                    if(cached)
+                        interpreter->setProgramMemoryCache(cache.get());
+                    interpreter->interpretMain();
+                });
+            workers->wait();
+        });
+        report(std::string(cached ? "memory cache" : "no cache") + ", " + std::to_string(requests) + " requests on " + std::to_string(workers->getThreadCount()) + " threads", ms, 0);
+    }
+
+    auto stats = cache->getStats();
+    std::cout << "  hits " << stats.hits << ", misses " << stats.misses << ", evictions " << stats.evictions << ", " << (stats.bytes / 1024) << " KiB cached" << std::endl;
+}
+
+void bench_hot_reload()
+{
+    std::cout << "Reload compute source after a one-line edit" << std::endl;
+
+    std::string text = generate_compute_source(20000);
+    std::string edited = text;
+    edited.replace(edited.find("let c = 3"), 9, "let c = 5");
+
+    double restart_ms = time_ms([&]() {
+        auto interpreter = Interpreter::borrow(edited);
+        interpreter->registerFunctionLibrary<BenchLib>();
+        interpreter->interpretMain();
+    });
+
+    auto interpreter = Interpreter::borrow(text);
+    interpreter->registerFunctionLibrary<BenchLib>();
+    interpreter->interpretMain();
+    double reload_ms = time_ms([&]() {
+        bench_sink = interpreter->reload(edited);
+    });
+
+    auto stats = interpreter->getReloadStats();
+    report("restart, parse and run everything", restart_ms, 0);
+    report("reload, " + std::to_string(stats.run) + " of " + std::to_string(stats.kept + stats.run) + " statements run", reload_ms, 0);
+}
+///--- Interpreter Benchmarks ---///
+
+int main()
+{
+    bench_keyword_lookup();
+    bench_precedence_lookup();
+    bench_parallel_tokenize();
+    bench_parse_operators();
+    bench_parse_long_expressions();
+    bench_parse_lazy_bodies();
+    bench_parse_and_free();
+    bench_load_units();
+    bench_incremental_session();
+    bench_interpret_backends();
+    bench_jit();
+    bench_aot();
+    bench_quickening();
+    bench_superinstructions();
+    bench_value_functions();
+    bench_tiering();
+    bench_program_cache();
+    bench_program_memory_cache();
+    bench_hot_reload();
+
+    return 0;
+}
\ No newline at end of file
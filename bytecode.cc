@@ -0,0 +1,614 @@
+#include "bytecode.h"
+#include "interpret.h"
+
+#include <climits>
+
+namespace xeouz
+{
+
+///--- Bytecode ---///
+BytecodeProgram::BytecodeProgram()
+{
+
+}
+
+std::uint32_t const BytecodeProgram::addNumber(double value)
+{
+    auto it = number_ids.find(value);
+    if(it != number_ids.end())
+        return it->second;
+    numbers.push_back(value);
+    number_ids.emplace(value, numbers.size() - 1);
+    return numbers.size() - 1;
+}
+std::uint32_t const BytecodeProgram::addString(std::string value)
+{
+    strings.push_back(std::move(value));
+    return strings.size() - 1;
+}
+std::uint32_t const BytecodeProgram::addVariable(std::string_view name)
+{
+    auto it = variable_ids.find(name);
+    if(it != variable_ids.end())
+        return it->second;
+    variables.emplace_back(name);
+    variable_ids.emplace(name, variables.size() - 1);
+    return variables.size() - 1;
+}
+std::uint32_t const BytecodeProgram::addFunction(std::string_view name)
+{
+    auto it = function_ids.find(name);
+    if(it != function_ids.end())
+        return it->second;
+    functions.emplace_back(name);
+    function_ids.emplace(name, functions.size() - 1);
+    return functions.size() - 1;
+}
+std::uint32_t const BytecodeProgram::addTree(ASTBase* ast)
+{
+    trees.push_back(ast);
+    return trees.size() - 1;
+}
+
+// Each returns the index of its first operand word, for patching a jump target later
+std::uint32_t const BytecodeProgram::emit(std::uint32_t op)
+{
+    code.push_back(op);
+    return code.size();
+}
+std::uint32_t const BytecodeProgram::emit(std::uint32_t op, std::uint32_t a)
+{
+    code.push_back(op);
+    code.push_back(a);
+    return code.size() - 1;
+}
+std::uint32_t const BytecodeProgram::emit(std::uint32_t op, std::uint32_t a, std::uint32_t b)
+{
+    code.push_back(op);
+    code.push_back(a);
+    code.push_back(b);
+    return code.size() - 2;
+}
+void BytecodeProgram::patch(std::uint32_t at, std::uint32_t target)
+{
+    code[at] = target;
+}
+
+void BytecodeProgram::compileStatement(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        default: {
+            emit(OP_TREE, addTree(ast));
+            break;
+        }
+        case AST_VARDEF: {
+            auto* def = (VariableDefinitionAST*)ast;
+            std::uint32_t slot = addVariable(def->getName());
+            std::uint32_t end = emit(OP_DEFINE_TEST, slot, 0) + 1;
+            compileExpression(def->getValue());
+            emit(OP_DEFINE, slot);
+            patch(end, code.size());
+            break;
+        }
+        case AST_VARASSIGN: {
+            auto* assign = (VariableAssignmentAST*)ast;
+            std::uint32_t slot = addVariable(assign->getName());
+            std::uint32_t end = emit(OP_ASSIGN_TEST, slot, 0) + 1;
+            compileExpression(assign->getValue());
+            emit(OP_ASSIGN, slot, assign->getShorthandOperator());
+            patch(end, code.size());
+            break;
+        }
+        case AST_IFELSE: compileIfElse((IfElseAST*)ast); break;
+        case AST_DOFOR: compileDoFor((DoForAST*)ast); break;
+        case AST_CALL: {
+            compileCall((FunctionCallAST*)ast);
+            emit(OP_POP);
+            break;
+        }
+    }
+}
+void BytecodeProgram::compileExpression(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        default: {
+            emit(OP_ERROR, addString("INTERPRETER: interpretExpression(): Unable to interpret invalid AST type `"+ast->toString()+"`"));
+            break;
+        }
+        case AST_NUMBER: emit(OP_NUMBER, addNumber(((NumberAST*)ast)->getValue())); break;
+        case AST_STRING: emit(OP_STRING, addString(std::string(((StringAST*)ast)->getValue()))); break;
+        case AST_CALL: compileCall((FunctionCallAST*)ast); break;
+        case AST_VAR: emit(OP_LOAD, addVariable(((VariableAST*)ast)->getName())); break;
+        case AST_SEQUENCE: {
+            emit(OP_SEQUENCE, addTree(ast));
+            compileSequenceCalls((SequenceAST*)ast);
+            break;
+        }
+        case AST_BINOP: {
+            auto* binop = (BinaryOperationAST*)ast;
+            compileExpression(binop->getLHS());
+            compileExpression(binop->getRHS());
+            emit(OP_BINARY, binop->getOperator());
+            break;
+        }
+    }
+}
+// Same order as the tree walker: the function is looked up first, then each argument is checked as it is evaluated
+void BytecodeProgram::compileCall(FunctionCallAST* ast)
+{
+    std::uint32_t function = addFunction(ast->getName());
+    std::vector<std::uint32_t> ends;
+    ends.push_back(emit(OP_CALL_TEST, function, 0) + 1);
+
+    std::uint32_t index = 0;
+    for(auto&& arg: ast->getArguments())
+    {
+        compileExpression(arg.get());
+        code.push_back(OP_ARGUMENT);
+        code.push_back(function);
+        code.push_back(index++);
+        code.push_back(0);
+        ends.push_back(code.size() - 1);
+    }
+
+    emit(OP_CALL, function, index);
+    for(auto end: ends)
+        patch(end, code.size());
+}
+void BytecodeProgram::compileIfElse(IfElseAST* ast)
+{
+    // Pending lazy bodies are parsed by the tree walker the first time they run
+    bool lazy = ast->getLazyElseBody().isPending();
+    for(auto&& ifstm: ast->getIfStatements())
+        lazy = lazy || ifstm->getLazyBody().isPending();
+    if(lazy)
+    {
+        emit(OP_TREE, addTree(ast));
+        return;
+    }
+
+    std::vector<std::uint32_t> ends;
+    for(auto&& ifstm: ast->getIfStatements())
+    {
+        compileExpression(ifstm->getExpression());
+        std::uint32_t next = emit(OP_IF_TEST, 0);
+        for(auto&& stm: ifstm->getBody())
+            compileStatement(stm.get());
+        ends.push_back(emit(OP_JUMP, 0));
+        patch(next, code.size());
+    }
+    for(auto&& stm: ast->getElseBody())
+        compileStatement(stm.get());
+
+    for(auto end: ends)
+        patch(end, code.size());
+}
+void BytecodeProgram::compileDoFor(DoForAST* ast)
+{
+    compileExpression(ast->getForTimes());
+    std::uint32_t end = emit(OP_LOOP_BEGIN, 0);
+    std::uint32_t body = code.size();
+
+    std::vector<std::uint32_t> aborts;
+    for(auto&& seq: ast->getSequences())
+    {
+        if(seq->type == AST_SEQUENCE)
+        {
+            for(auto&& call: ((SequenceAST*)seq.get())->getBody())
+            {
+                compileCall(call.get());
+                emit(OP_POP);
+            }
+        }
+        else if(seq->type == AST_VAR)
+        {
+            aborts.push_back(emit(OP_RUN_SEQUENCE, addVariable(((VariableAST*)seq.get())->getName()), 0) + 1);
+        }
+    }
+
+    emit(OP_LOOP_NEXT, body);
+    patch(end, code.size());
+    for(auto abort: aborts)
+        patch(abort, code.size());
+}
+// Calls of a sequence literal may run later from a variable, each is compiled after the main code as its own entry
+void BytecodeProgram::compileSequenceCalls(SequenceAST* ast)
+{
+    for(auto&& call: ast->getBody())
+        if(sequence_calls.emplace(call.get(), UINT32_MAX).second)
+            pending_calls.push_back(call.get());
+}
+
+std::vector<std::uint32_t> const& BytecodeProgram::getCode() const
+{
+    return code;
+}
+std::uint32_t const BytecodeProgram::getMainEntry() const
+{
+    return 0;
+}
+double const BytecodeProgram::getNumber(std::uint32_t index) const
+{
+    return numbers[index];
+}
+std::string const& BytecodeProgram::getString(std::uint32_t index) const
+{
+    return strings[index];
+}
+std::vector<std::string> const& BytecodeProgram::getVariables() const
+{
+    return variables;
+}
+std::vector<std::string> const& BytecodeProgram::getFunctions() const
+{
+    return functions;
+}
+ASTBase* const BytecodeProgram::getTree(std::uint32_t index) const
+{
+    return trees[index];
+}
+std::uint32_t const BytecodeProgram::getSequenceCallEntry(FunctionCallAST const* call) const
+{
+    auto it = sequence_calls.find(call);
+    if(it == sequence_calls.end())
+        return UINT32_MAX;
+    return it->second;
+}
+std::size_t const BytecodeProgram::getTreeFallbackCount() const
+{
+    std::size_t count = 0;
+    for(auto* tree: trees)
+        count += tree->type != AST_SEQUENCE;
+    return count;
+}
+
+std::unique_ptr<BytecodeProgram> BytecodeProgram::compile(MainAST* const main)
+{
+    auto program = std::make_unique<BytecodeProgram>();
+    for(auto&& stm: main->getBody())
+        program->compileStatement(stm.get());
+    program->emit(OP_RETURN);
+
+    // Arguments can hold further sequence literals, which queue more calls
+    for(std::size_t i=0; i<program->pending_calls.size(); ++i)
+    {
+        auto* call = program->pending_calls[i];
+        program->sequence_calls[call] = program->code.size();
+        program->compileCall(call);
+        program->emit(OP_POP);
+        program->emit(OP_RETURN);
+    }
+    program->pending_calls.clear();
+
+    program->number_ids.clear();
+    program->variable_ids.clear();
+    program->function_ids.clear();
+    return program;
+}
+///--- Bytecode ---///
+
+///--- Stack VM ---///
+StackVM::StackVM(Interpreter& _interpreter, BytecodeProgram const& _program): interpreter(_interpreter), program(_program)
+{
+
+}
+
+// Memory is a node-based map, the pointers stay valid until a variable is erased
+void StackVM::resolveSlots()
+{
+    auto const& variables = program.getVariables();
+    slots.resize(variables.size());
+    for(std::size_t i=0; i<variables.size(); ++i)
+    {
+        auto it = interpreter.memory.find(variables[i]);
+        slots[i] = it == interpreter.memory.end() ? nullptr : &it->second;
+    }
+}
+void StackVM::push(std::unique_ptr<VariableDataBase> value)
+{
+    if(!value)
+    {
+        pushInvalid();
+        return;
+    }
+    if(value->getType() == VT_NUMBER)
+    {
+        pushNumber(value->getAsNumber()->getValue());
+        return;
+    }
+    int type = value->getType();
+    stack.push_back({type, 0, std::move(value)});
+}
+void StackVM::pushNumber(double value)
+{
+    stack.push_back({VT_NUMBER, value, nullptr});
+}
+void StackVM::pushInvalid()
+{
+    stack.push_back({-1, 0, nullptr});
+}
+std::unique_ptr<VariableDataBase> StackVM::pop()
+{
+    StackValue value = std::move(stack.back());
+    stack.pop_back();
+    if(value.type == VT_NUMBER)
+        return std::make_unique<VariableNumberData>(value.number);
+    return std::move(value.object);
+}
+
+void StackVM::execute(std::uint32_t pc)
+{
+    std::uint32_t const* code = program.getCode().data();
+    for(;;)
+    {
+        switch(code[pc])
+        {
+            case OP_NUMBER: {
+                pushNumber(program.getNumber(code[pc+1]));
+                pc += 2;
+                break;
+            }
+            case OP_STRING: {
+                stack.push_back({VT_STRING, 0, std::make_unique<VariableStringData>(program.getString(code[pc+1]))});
+                pc += 2;
+                break;
+            }
+            case OP_SEQUENCE: {
+                stack.push_back({VT_SEQUENCE, 0, interpreter.interpretSequence((SequenceAST*)program.getTree(code[pc+1]))});
+                pc += 2;
+                break;
+            }
+            case OP_LOAD: {
+                auto* slot = slots[code[pc+1]];
+                if(!slot)
+                {
+                    interpreter.LogError(std::string("INTERPRETER: interpretVariable(): Variable `")+program.getVariables()[code[pc+1]]+"` is not defined");
+                    pushInvalid();
+                }
+                else if(slot->isNumber())
+                    pushNumber(slot->getNumber());
+                else
+                    push(slot->borrow().takeData());
+                pc += 2;
+                break;
+            }
+            case OP_BINARY: {
+                StackValue& lhs = stack[stack.size()-2];
+                StackValue& rhs = stack.back();
+                int op = code[pc+1];
+                pc += 2;
+                if(lhs.type == VT_NUMBER && rhs.type == VT_NUMBER)
+                {
+                    double l = lhs.number;
+                    if(applyNumberOperator(op, l, rhs.number))
+                    {
+                        stack.pop_back();
+                        stack.back().number = l;
+                        break;
+                    }
+                }
+
+                auto r = pop();
+                auto l = pop();
+                if(!l || !r)
+                {
+                    interpreter.LogError("INTERPRETER: interpretBinaryOperation(): Binary operation has invalid LHS or RHS");
+                    pushInvalid();
+                    break;
+                }
+                push(interpreter.useBinaryOperation(op, l.get(), r.get()));
+                break;
+            }
+            case OP_POP: {
+                stack.pop_back();
+                pc += 1;
+                break;
+            }
+            case OP_DEFINE_TEST: {
+                std::uint32_t slot = code[pc+1];
+                if(slots[slot])
+                {
+                    interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)")+program.getVariables()[slot]+"` is already defined");
+                    pc = code[pc+2];
+                    break;
+                }
+                pc += 3;
+                break;
+            }
+            case OP_DEFINE: {
+                std::uint32_t slot = code[pc+1];
+                auto const& name = program.getVariables()[slot];
+                auto value = pop();
+                pc += 2;
+                if(!value)
+                {
+                    interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `")+name+"`");
+                    break;
+                }
+                slots[slot] = &interpreter.memory.emplace(name, Value::createOwned(std::move(value))).first->second;
+                break;
+            }
+            case OP_ASSIGN_TEST: {
+                std::uint32_t slot = code[pc+1];
+                if(!slots[slot])
+                {
+                    interpreter.LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+program.getVariables()[slot]+"` is not defined");
+                    pc = code[pc+2];
+                    break;
+                }
+                pc += 3;
+                break;
+            }
+            case OP_ASSIGN: {
+                std::uint32_t index = code[pc+1];
+                auto* slot = slots[index];
+                int op = code[pc+2];
+                StackValue& value = stack.back();
+                pc += 3;
+                if(value.type == VT_NUMBER && slot->isNumber())
+                {
+                    double l = value.number;
+                    bool known = true;
+                    if(op != T_EOF)
+                    {
+                        l = slot->getNumber();
+                        known = applyNumberOperator(op, l, value.number);
+                    }
+                    if(known)
+                    {
+                        *slot = Value::createNumber(l);
+                        stack.pop_back();
+                        break;
+                    }
+                }
+                interpreter.assignVariable(program.getVariables()[index], pop(), op);
+                break;
+            }
+            case OP_CALL_TEST: {
+                std::uint32_t function = code[pc+1];
+                if(!functions[function])
+                {
+                    interpreter.LogError(std::string("INTERPRETER: interpretFunctionCall(): Function `")+program.getFunctions()[function]+"` was not found");
+                    pushInvalid();
+                    pc = code[pc+2];
+                    break;
+                }
+                pc += 3;
+                break;
+            }
+            case OP_ARGUMENT: {
+                std::uint32_t index = code[pc+2];
+                if(stack.back().type == -1)
+                {
+                    interpreter.LogError(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+program.getFunctions()[code[pc+1]]+"`, argument at index "+std::to_string(index)+" is invalid");
+                    stack.resize(stack.size() - index - 1);
+                    pushInvalid();
+                    pc = code[pc+3];
+                    break;
+                }
+                pc += 4;
+                break;
+            }
+            case OP_CALL: {
+                std::uint32_t argc = code[pc+2];
+                std::vector<FCIType> args(argc);
+                for(std::uint32_t i=argc; i-- > 0;)
+                    args[i] = pop();
+                push(functions[code[pc+1]]->call(std::make_unique<FCICallFunctionArguments>(std::move(args))));
+                pc += 3;
+                break;
+            }
+            case OP_IF_TEST: {
+                StackValue condition = std::move(stack.back());
+                stack.pop_back();
+                if(condition.type != VT_NUMBER)
+                {
+                    interpreter.LogError("INTERPRETER: interpretIf(): Expression in if conditional is not of type number");
+                    pc = code[pc+1];
+                    break;
+                }
+                pc = condition.number > 0 ? pc + 2 : code[pc+1];
+                break;
+            }
+            case OP_JUMP: {
+                pc = code[pc+1];
+                break;
+            }
+            case OP_LOOP_BEGIN: {
+                StackValue times = std::move(stack.back());
+                stack.pop_back();
+                if(times.type == -1)
+                {
+                    interpreter.LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of valid");
+                    pc = code[pc+1];
+                    break;
+                }
+                if(times.type != VT_NUMBER)
+                {
+                    interpreter.LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of type number");
+                    pc = code[pc+1];
+                    break;
+                }
+                if(!(0 < times.number))
+                {
+                    pc = code[pc+1];
+                    break;
+                }
+                loops.push_back({times.number, 0});
+                pc += 2;
+                break;
+            }
+            case OP_LOOP_NEXT: {
+                Loop& loop = loops.back();
+                if(++loop.i < loop.times)
+                {
+                    pc = code[pc+1];
+                    break;
+                }
+                loops.pop_back();
+                pc += 2;
+                break;
+            }
+            case OP_RUN_SEQUENCE: {
+                std::uint32_t slot = code[pc+1];
+                Value* seq = slots[slot];
+                if(!seq)
+                    interpreter.LogError(std::string("INTERPRETER: interpretVariable(): Variable `")+program.getVariables()[slot]+"` is not defined");
+                if(!seq || seq->getType() != VT_SEQUENCE)
+                {
+                    interpreter.LogError(!seq ? "INTERPRETER: interpretDoFor(): Sequence variable given is invalid" : "INTERPRETER: interpretDoFor(): Sequence variable given is not of type <sequence>");
+                    loops.pop_back();
+                    pc = code[pc+2];
+                    break;
+                }
+
+                for(auto* call: seq->getSequence()->getValue())
+                {
+                    std::uint32_t entry = program.getSequenceCallEntry(call);
+                    if(entry == UINT32_MAX)
+                        interpreter.interpretFunctionCall(call);
+                    else
+                        execute(entry);
+                }
+                for(auto call: seq->getSequence()->getPoolCalls())
+                    interpreter.interpretPoolFunctionCall(call);
+                pc += 3;
+                break;
+            }
+            case OP_TREE: {
+                interpreter.interpretPrimary(program.getTree(code[pc+1]));
+                resolveSlots();
+                pc += 2;
+                break;
+            }
+            case OP_ERROR: {
+                interpreter.LogError(program.getString(code[pc+1]));
+                pushInvalid();
+                pc += 2;
+                break;
+            }
+            case OP_RETURN: {
+                return;
+            }
+        }
+    }
+}
+
+void StackVM::run()
+{
+    resolveSlots();
+
+    auto const& names = program.getFunctions();
+    functions.resize(names.size());
+    for(std::size_t i=0; i<names.size(); ++i)
+        functions[i] = interpreter.isFunctionDefined(names[i]) ? interpreter.getFunction(names[i]) : nullptr;
+
+    execute(program.getMainEntry());
+    stack.clear();
+    loops.clear();
+}
+///--- Stack VM ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+
+namespace xeouz
+{
+
+class Interpreter;
+class FCIFunction;
+class VariableDataBase;
+class Value;
+
+///--- Bytecode ---///
+// Every instruction is its opcode word followed by its operand words. Jump targets are word indices into the code.
+//   NUMBER      n                    push numbers[n]
+//   STRING      s                    push a copy of strings[s]
+//   SEQUENCE    t                    push the calls of trees[t], a SequenceAST
+//   LOAD        v                    push a copy of variable slot v
+//   BINARY      op                   pop rhs and lhs, push lhs op rhs
+//   POP                              drop the top value
+//   DEFINE_TEST v end                jump to end if slot v is already defined
+//   DEFINE      v                    pop into the new variable slot v
+//   ASSIGN_TEST v end                jump to end if slot v is not defined
+//   ASSIGN      v op                 pop into slot v, op is the shorthand operator or T_EOF
+//   CALL_TEST   f end                push an invalid value and jump to end if function f is not registered
+//   ARGUMENT    f i end              check argument i of a call to f, on an invalid one leave an invalid result and jump to end
+//   CALL        f argc               pop the arguments, call function f and push its result
+//   IF_TEST     next                 pop the condition, jump to next unless it is a number above zero
+//   JUMP        to
+//   LOOP_BEGIN  end                  pop the do-for count and open a loop, jump to end if it runs no iteration
+//   LOOP_NEXT   body                 jump back to body while the innermost loop has iterations left, else close it
+//   RUN_SEQUENCE v end               run the calls of sequence slot v, on an invalid one close the loop and jump to end
+//   TREE        t                    run trees[t] on the tree walker, for statements not lowered to bytecode
+//   ERROR       s                    log strings[s] and push an invalid value
+//   RETURN                           end of the main code or of a sequence call
+enum Opcode: std::uint32_t
+{
+    OP_NUMBER,
+    OP_STRING,
+    OP_SEQUENCE,
+    OP_LOAD,
+    OP_BINARY,
+    OP_POP,
+    OP_DEFINE_TEST,
+    OP_DEFINE,
+    OP_ASSIGN_TEST,
+    OP_ASSIGN,
+    OP_CALL_TEST,
+    OP_ARGUMENT,
+    OP_CALL,
+    OP_IF_TEST,
+    OP_JUMP,
+    OP_LOOP_BEGIN,
+    OP_LOOP_NEXT,
+    OP_RUN_SEQUENCE,
+    OP_TREE,
+    OP_ERROR,
+    OP_RETURN,
+};
+
+class BytecodeProgram
+{
+    std::vector<std::uint32_t> code;
+    std::vector<double> numbers;
+    std::vector<std::string> strings;
+    std::vector<std::string> variables;
+    std::vector<std::string> functions;
+    std::vector<ASTBase*> trees;
+    std::unordered_map<FunctionCallAST const*, std::uint32_t> sequence_calls; // Where each call of a sequence literal starts
+
+    std::unordered_map<double, std::uint32_t> number_ids;
+    std::unordered_map<std::string_view, std::uint32_t> variable_ids;
+    std::unordered_map<std::string_view, std::uint32_t> function_ids;
+    std::vector<FunctionCallAST*> pending_calls;
+
+    std::uint32_t const addNumber(double value);
+    std::uint32_t const addString(std::string value);
+    std::uint32_t const addVariable(std::string_view name);
+    std::uint32_t const addFunction(std::string_view name);
+    std::uint32_t const addTree(ASTBase* ast);
+
+    std::uint32_t const emit(std::uint32_t op);
+    std::uint32_t const emit(std::uint32_t op, std::uint32_t a);
+    std::uint32_t const emit(std::uint32_t op, std::uint32_t a, std::uint32_t b);
+    void patch(std::uint32_t at, std::uint32_t target);
+
+    void compileStatement(ASTBase* ast);
+    void compileExpression(ASTBase* ast);
+    void compileCall(FunctionCallAST* ast);
+    void compileIfElse(IfElseAST* ast);
+    void compileDoFor(DoForAST* ast);
+    void compileSequenceCalls(SequenceAST* ast);
+public:
+    BytecodeProgram();
+
+    std::vector<std::uint32_t> const& getCode() const;
+    std::uint32_t const getMainEntry() const;
+    double const getNumber(std::uint32_t index) const;
+    std::string const& getString(std::uint32_t index) const;
+    std::vector<std::string> const& getVariables() const;
+    std::vector<std::string> const& getFunctions() const;
+    ASTBase* const getTree(std::uint32_t index) const;
+    // Entry of the compiled code for `call` if it belongs to a sequence literal of this program, else UINT32_MAX
+    std::uint32_t const getSequenceCallEntry(FunctionCallAST const* call) const;
+
+    std::size_t const getTreeFallbackCount() const;
+
+    // The program's ASTs have to outlive it, sequences and tree fallbacks point into them
+    static std::unique_ptr<BytecodeProgram> compile(MainAST* const main);
+};
+///--- Bytecode ---///
+
+///--- Stack VM ---///
+// The number cases of Interpreter::useBinaryOperation, false for an operator they do not cover
+inline bool const applyNumberOperator(int op, double& lhs, double rhs)
+{
+    switch(op)
+    {
+        default: return false;
+        case T_ADD: lhs = lhs + rhs; break;
+        case T_SUB: lhs = lhs - rhs; break;
+        case T_MUL: lhs = lhs * rhs; break;
+        case T_DIV: lhs = lhs / rhs; break;
+        case T_MOD: lhs = (long)lhs % (long)rhs; break;
+        case T_DEQUAL: lhs = lhs == rhs; break;
+        case T_NOTEQ: lhs = lhs != rhs; break;
+        case T_LARROW: lhs = lhs < rhs; break;
+        case T_RARROW: lhs = lhs > rhs; break;
+        case T_LESSEQ: lhs = lhs <= rhs; break;
+        case T_MOREEQ: lhs = lhs >= rhs; break;
+    }
+    return true;
+}
+
+// A number on the stack is unboxed, any other value is owned through `object`. Neither means the
+// expression failed, what the tree walker passes around as nullptr.
+struct StackValue
+{
+    int type;
+    double number;
+    std::unique_ptr<VariableDataBase> object;
+};
+
+class StackVM
+{
+    Interpreter& interpreter;
+    BytecodeProgram const& program;
+
+    std::vector<StackValue> stack;
+    std::vector<Value*> slots; // Into the interpreter's memory, nullptr while undefined
+    std::vector<FCIFunction*> functions;
+
+    struct Loop
+    {
+        double times;
+        int i;
+    };
+    std::vector<Loop> loops;
+
+    void resolveSlots();
+    void push(std::unique_ptr<VariableDataBase> value);
+    void pushNumber(double value);
+    void pushInvalid();
+    std::unique_ptr<VariableDataBase> pop();
+    void execute(std::uint32_t pc);
+public:
+    StackVM(Interpreter& interpreter, BytecodeProgram const& program);
+
+    void run();
+};
+///--- Stack VM ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,495 @@
+#include "closure.h"
+#include "interpret.h"
+#include "jit.h"
+
+namespace xeouz
+{
+
+namespace
+{
+
+// Hands `make` the number case of Interpreter::useBinaryOperation for `op` as its own callable, so the closure
+// it builds is specialized for one operator. The callable returns false where the interpreter has to decide.
+template <typename Result, typename Make>
+Result withOperator(int op, Make make)
+{
+    switch(op)
+    {
+        default: return make([](double&, double) { return false; });
+        case T_ADD: return make([](double& lhs, double rhs) { lhs = lhs + rhs; return true; });
+        case T_SUB: return make([](double& lhs, double rhs) { lhs = lhs - rhs; return true; });
+        case T_MUL: return make([](double& lhs, double rhs) { lhs = lhs * rhs; return true; });
+        case T_DIV: return make([](double& lhs, double rhs) { lhs = lhs / rhs; return true; });
+        case T_MOD: return make([](double& lhs, double rhs) { lhs = (long)lhs % (long)rhs; return true; });
+        case T_DEQUAL: return make([](double& lhs, double rhs) { lhs = lhs == rhs; return true; });
+        case T_NOTEQ: return make([](double& lhs, double rhs) { lhs = lhs != rhs; return true; });
+        case T_LARROW: return make([](double& lhs, double rhs) { lhs = lhs < rhs; return true; });
+        case T_RARROW: return make([](double& lhs, double rhs) { lhs = lhs > rhs; return true; });
+        case T_LESSEQ: return make([](double& lhs, double rhs) { lhs = lhs <= rhs; return true; });
+        case T_MOREEQ: return make([](double& lhs, double rhs) { lhs = lhs >= rhs; return true; });
+    }
+}
+
+}
+
+///--- Closure Compiler ---///
+ClosureProgram::ClosureProgram(Interpreter& _interpreter): interpreter(_interpreter), generation(0), tree_fallbacks(0)
+{
+
+}
+ClosureProgram::~ClosureProgram()
+{
+
+}
+
+ClosureProgram::Slot* const ClosureProgram::addSlot(std::string_view name)
+{
+    auto it = slot_ids.find(name);
+    if(it != slot_ids.end())
+        return it->second;
+    slots.push_back(Slot{std::string(name), nullptr});
+    Slot* slot = &slots.back();
+    slot_ids.emplace(slot->name, slot);
+    return slot;
+}
+void ClosureProgram::resolveSlots()
+{
+    for(auto& slot: slots)
+    {
+        auto it = interpreter.memory.find(slot.name);
+        slot.value = it == interpreter.memory.end() ? nullptr : &it->second;
+    }
+    generation = interpreter.memory_generation;
+}
+// A null slot is looked up again, a statement run by the tree walker may have defined it since
+Value* const ClosureProgram::lookup(Slot* const slot)
+{
+    if(!slot->value)
+    {
+        auto it = interpreter.memory.find(slot->name);
+        if(it != interpreter.memory.end())
+            slot->value = &it->second;
+    }
+    return slot->value;
+}
+
+// Everything but number operators, through the interpreter
+Value ClosureProgram::binary(int op, Value lhs, Value rhs)
+{
+    if(!lhs || !rhs)
+        return interpreter.LogErrorV("INTERPRETER: interpretBinaryOperation(): Binary operation has invalid LHS or RHS");
+    return interpreter.useBinaryOperation(op, lhs, rhs);
+}
+void ClosureProgram::runSequence(VariableSequenceData* seq)
+{
+    for(auto* call: seq->getValue())
+    {
+        auto it = sequence_calls.find(call);
+        if(it == sequence_calls.end())
+            interpreter.interpretFunctionCall(call);
+        else
+            it->second();
+    }
+    for(auto call: seq->getPoolCalls())
+        interpreter.interpretPoolFunctionCall(call);
+}
+
+ClosureExpression ClosureProgram::compileExpression(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        default: {
+            std::string message = "INTERPRETER: interpretExpression(): Unable to interpret invalid AST type `"+ast->toString()+"`";
+            return [this, message]() {
+                return interpreter.LogErrorV(message);
+            };
+        }
+        case AST_NUMBER: {
+            double value = ((NumberAST*)ast)->getValue();
+            return [value]() {
+                return Value::createNumber(value);
+            };
+        }
+        case AST_STRING: {
+            std::string value(((StringAST*)ast)->getValue());
+            return [value]() {
+                return Value::createOwned(std::make_unique<VariableStringData>(value));
+            };
+        }
+        case AST_VAR: {
+            Slot* slot = addSlot(((VariableAST*)ast)->getName());
+            return [this, slot]() {
+                if(!lookup(slot))
+                    return interpreter.LogErrorV(std::string("INTERPRETER: interpretVariable(): Variable `")+slot->name+"` is not defined");
+                return slot->value->borrow();
+            };
+        }
+        case AST_CALL: return compileCall((FunctionCallAST*)ast);
+        case AST_SEQUENCE: return compileSequence((SequenceAST*)ast);
+        case AST_BINOP: return compileBinary((BinaryOperationAST*)ast);
+    }
+}
+ClosureExpression ClosureProgram::compileBinary(BinaryOperationAST* ast)
+{
+    int op = ast->getOperator();
+    auto lhs = compileExpression(ast->getLHS());
+
+    // A number literal on the right is bound as a constant instead of a closure of its own
+    if(ast->getRHS()->type == AST_NUMBER)
+    {
+        double rhs = ((NumberAST*)ast->getRHS())->getValue();
+        return withOperator<ClosureExpression>(op, [&](auto apply) -> ClosureExpression {
+            return [this, op, lhs = std::move(lhs), rhs, apply]() {
+                Value l = lhs();
+                if(l.isNumber())
+                {
+                    double number = l.getNumber();
+                    if(apply(number, rhs))
+                        return Value::createNumber(number);
+                }
+                return binary(op, std::move(l), Value::createNumber(rhs));
+            };
+        });
+    }
+
+    auto rhs = compileExpression(ast->getRHS());
+    return withOperator<ClosureExpression>(op, [&](auto apply) -> ClosureExpression {
+        return [this, op, lhs = std::move(lhs), rhs = std::move(rhs), apply]() {
+            Value l = lhs();
+            Value r = rhs();
+            if(l.isNumber() && r.isNumber())
+            {
+                double number = l.getNumber();
+                if(apply(number, r.getNumber()))
+                    return Value::createNumber(number);
+            }
+            return binary(op, std::move(l), std::move(r));
+        };
+    });
+}
+ClosureExpression ClosureProgram::compileCall(FunctionCallAST* ast)
+{
+    std::string name(ast->getName());
+    if(!interpreter.isFunctionDefined(name))
+    {
+        return [this, name]() {
+            return interpreter.LogErrorV(std::string("INTERPRETER: interpretFunctionCall(): Function `")+name+"` was not found");
+        };
+    }
+
+    FCIFunction* function = interpreter.getFunction(name);
+    std::vector<ClosureExpression> arguments;
+    for(auto&& arg: ast->getArguments())
+        arguments.push_back(compileExpression(arg.get()));
+
+    // The arguments go on the interpreter's `call_arguments`, like the tree walker's
+    return [this, name, function, arguments = std::move(arguments)]() {
+        auto& stack = interpreter.call_arguments;
+        std::size_t base = stack.size();
+        for(std::size_t i=0; i<arguments.size(); ++i)
+        {
+            auto value = arguments[i]();
+            if(!value)
+            {
+                stack.erase(stack.begin() + base, stack.end());
+                return interpreter.LogErrorV(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+name+"`, argument at index "+std::to_string(i)+" is invalid");
+            }
+            stack.push_back(std::move(value));
+        }
+        auto result = function->callValues(stack.data() + base, stack.size() - base);
+        stack.erase(stack.begin() + base, stack.end());
+        return result;
+    };
+}
+// The value still holds the calls' ASTs, a do-for over it finds their closures in `sequence_calls`
+ClosureExpression ClosureProgram::compileSequence(SequenceAST* ast)
+{
+    for(auto&& call: ast->getBody())
+        if(!sequence_calls.count(call.get()))
+        {
+            auto closure = compileCall(call.get());
+            sequence_calls.emplace(call.get(), std::move(closure));
+        }
+
+    return [this, ast]() {
+        return Value::createOwned(interpreter.interpretSequence(ast));
+    };
+}
+
+// A native region runs in place of its statements, their closures only run when its guard fails
+std::vector<ClosureStatement> ClosureProgram::compileBody(ASTList<ASTBase> const& body)
+{
+    std::vector<ClosureStatement> statements;
+    for(std::size_t i=0; i<body.size();)
+    {
+        std::size_t end = i;
+        JitRegion* region = jit ? jit->compile(body, i, end) : nullptr;
+        if(!region)
+        {
+            statements.push_back(compileStatement(body[i++].get()));
+            continue;
+        }
+        region->bindVariables([this](std::string const& name) {
+            return &addSlot(name)->value;
+        });
+
+        std::vector<ClosureStatement> fallback;
+        for(; i<end; ++i)
+            fallback.push_back(compileStatement(body[i].get()));
+        statements.push_back([this, region, fallback = std::move(fallback)]() {
+            if(!region->run())
+            {
+                for(auto& stm: fallback)
+                    stm();
+            }
+        });
+    }
+    return statements;
+}
+ClosureStatement ClosureProgram::compileStatement(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        default: return compileTree(ast);
+        case AST_VARDEF: return compileDefinition((VariableDefinitionAST*)ast);
+        case AST_VARASSIGN: return compileAssignment((VariableAssignmentAST*)ast);
+        case AST_IFELSE: return compileIfElse((IfElseAST*)ast);
+        case AST_DOFOR: return compileDoFor((DoForAST*)ast);
+        case AST_CALL: {
+            auto call = compileCall((FunctionCallAST*)ast);
+            return [call = std::move(call)]() {
+                call();
+            };
+        }
+    }
+}
+ClosureStatement ClosureProgram::compileDefinition(VariableDefinitionAST* ast)
+{
+    Slot* slot = addSlot(ast->getName());
+    auto value = compileExpression(ast->getValue());
+
+    return [this, slot, value = std::move(value)]() {
+        if(lookup(slot))
+        {
+            interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)")+slot->name+"` is already defined");
+            return;
+        }
+
+        Value val = value();
+        if(!val)
+        {
+            interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `")+slot->name+"`");
+            return;
+        }
+        slot->value = &interpreter.memory.emplace(slot->name, val.take()).first->second;
+    };
+}
+ClosureStatement ClosureProgram::compileAssignment(VariableAssignmentAST* ast)
+{
+    Slot* slot = addSlot(ast->getName());
+    auto value = compileExpression(ast->getValue());
+    int op = ast->getShorthandOperator();
+
+    // Number into number is stored in place, anything else goes through Interpreter::assignVariable
+    if(op == T_EOF)
+    {
+        return [this, slot, value = std::move(value)]() {
+            if(!lookup(slot))
+            {
+                interpreter.LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+slot->name+"` is not defined");
+                return;
+            }
+
+            Value val = value();
+            auto& current = *slot->value;
+            if(val.isNumber() && current.isNumber())
+            {
+                current = std::move(val);
+                return;
+            }
+            interpreter.assignVariable(slot->name, std::move(val), T_EOF);
+        };
+    }
+
+    return withOperator<ClosureStatement>(op, [&](auto apply) -> ClosureStatement {
+        return [this, slot, value = std::move(value), op, apply]() {
+            if(!lookup(slot))
+            {
+                interpreter.LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+slot->name+"` is not defined");
+                return;
+            }
+
+            Value val = value();
+            auto& current = *slot->value;
+            if(val.isNumber() && current.isNumber())
+            {
+                double l = current.getNumber();
+                if(apply(l, val.getNumber()))
+                {
+                    current = Value::createNumber(l);
+                    return;
+                }
+            }
+            interpreter.assignVariable(slot->name, std::move(val), op);
+        };
+    });
+}
+ClosureStatement ClosureProgram::compileIfElse(IfElseAST* ast)
+{
+    // Pending lazy bodies are parsed by the tree walker the first time they run
+    bool lazy = ast->getLazyElseBody().isPending();
+    for(auto&& ifstm: ast->getIfStatements())
+        lazy = lazy || ifstm->getLazyBody().isPending();
+    if(lazy)
+        return compileTree(ast);
+
+    std::vector<ClosureExpression> conditions;
+    std::vector<std::vector<ClosureStatement>> bodies;
+    for(auto&& ifstm: ast->getIfStatements())
+    {
+        conditions.push_back(compileExpression(ifstm->getExpression()));
+        bodies.push_back(compileBody(ifstm->getBody()));
+    }
+    auto else_body = compileBody(ast->getElseBody());
+
+    return [this, conditions = std::move(conditions), bodies = std::move(bodies), else_body = std::move(else_body)]() {
+        for(std::size_t i=0; i<conditions.size(); ++i)
+        {
+            Value condition = conditions[i]();
+            if(!condition.isNumber())
+            {
+                interpreter.LogError("INTERPRETER: interpretIf(): Expression in if conditional is not of type number");
+                continue;
+            }
+            if(condition.getNumber() > 0)
+            {
+                for(auto& stm: bodies[i])
+                {
+                    stm();
+                    if(!interpreter.success)
+                        return;
+                }
+                return;
+            }
+        }
+        for(auto& stm: else_body)
+        {
+            stm();
+            if(!interpreter.success)
+                return;
+        }
+    };
+}
+ClosureStatement ClosureProgram::compileDoFor(DoForAST* ast)
+{
+    auto times = compileExpression(ast->getForTimes());
+
+    std::vector<ClosureSequence> sequences;
+    for(auto&& seq: ast->getSequences())
+    {
+        if(seq->type == AST_SEQUENCE)
+        {
+            std::vector<ClosureExpression> calls;
+            for(auto&& call: ((SequenceAST*)seq.get())->getBody())
+                calls.push_back(compileCall(call.get()));
+            sequences.push_back([calls = std::move(calls)]() {
+                for(auto& call: calls)
+                    call();
+                return true;
+            });
+        }
+        else if(seq->type == AST_VAR)
+        {
+            Slot* slot = addSlot(((VariableAST*)seq.get())->getName());
+            sequences.push_back([this, slot]() {
+                if(!lookup(slot))
+                {
+                    interpreter.LogError(std::string("INTERPRETER: interpretVariable(): Variable `")+slot->name+"` is not defined");
+                    interpreter.LogError("INTERPRETER: interpretDoFor(): Sequence variable given is invalid");
+                    return false;
+                }
+                if(slot->value->getType() != VT_SEQUENCE)
+                {
+                    interpreter.LogError("INTERPRETER: interpretDoFor(): Sequence variable given is not of type <sequence>");
+                    return false;
+                }
+                runSequence(slot->value->getSequence());
+                return true;
+            });
+        }
+    }
+
+    return [this, times = std::move(times), sequences = std::move(sequences)]() {
+        Value count = times();
+        if(!count)
+        {
+            interpreter.LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of valid");
+            return;
+        }
+        if(!count.isNumber())
+        {
+            interpreter.LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of type number");
+            return;
+        }
+
+        double number = count.getNumber();
+        for(int i=0; i<number; ++i)
+            for(auto& seq: sequences)
+                if(!seq())
+                    return;
+    };
+}
+// For statements not compiled to closures. Variables they define are picked up by lookup() when a slot is used.
+ClosureStatement ClosureProgram::compileTree(ASTBase* ast)
+{
+    ++tree_fallbacks;
+    return [this, ast]() {
+        interpreter.interpretPrimary(ast);
+    };
+}
+
+// Stops like the tree walker once a statement failed the program, only native regions do
+void ClosureProgram::run()
+{
+    if(generation != interpreter.memory_generation)
+        resolveSlots();
+    for(auto& stm: statements)
+    {
+        stm();
+        if(!interpreter.success)
+        {
+            interpreter.LogError("INTERPRETER: interpretMain(): Stopping program execution");
+            return;
+        }
+    }
+}
+
+std::size_t const ClosureProgram::getTreeFallbackCount() const
+{
+    return tree_fallbacks;
+}
+
+std::unique_ptr<ClosureProgram> ClosureProgram::compile(Interpreter& interpreter, MainAST* const main)
+{
+    auto program = std::make_unique<ClosureProgram>(interpreter);
+    if(interpreter.isJitEnabled() && JitModule::isSupported())
+        program->jit = std::make_unique<JitModule>(interpreter);
+
+    program->statements = program->compileBody(main->getBody());
+    program->slot_ids.clear();
+    program->resolveSlots();
+    if(program->jit)
+        program->jit->finalize();
+    return program;
+}
+std::unique_ptr<ClosureProgram> ClosureProgram::compileCalls(Interpreter& interpreter, std::vector<FunctionCallAST*> const& calls)
+{
+    auto program = std::make_unique<ClosureProgram>(interpreter);
+    for(auto* call: calls)
+        program->statements.push_back(program->compileStatement(call));
+    program->slot_ids.clear();
+    return program;
+}
+///--- Closure Compiler ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "value.h"
+
+namespace xeouz
+{
+
+class Interpreter;
+class FCIFunction;
+class VariableDataBase;
+class VariableSequenceData;
+class JitModule;
+
+///--- Closure Compiler ---///
+typedef std::function<Value()> ClosureExpression;
+typedef std::function<void()> ClosureStatement;
+typedef std::function<bool()> ClosureSequence; // False aborts the do-for it belongs to
+
+// Every node is turned into a closure once, with its children, operator, FCIFunction and variable slot bound.
+// Running the program only calls closures, it does not switch on AST types or look up names.
+class ClosureProgram
+{
+    struct Slot
+    {
+        std::string name;
+        Value* value; // Into the interpreter's memory, nullptr while undefined
+    };
+
+    Interpreter& interpreter;
+    std::vector<ClosureStatement> statements;
+    std::deque<Slot> slots;
+    std::unordered_map<std::string_view, Slot*> slot_ids;
+    std::unordered_map<FunctionCallAST const*, ClosureExpression> sequence_calls; // Calls of this program's sequence literals
+    std::uint64_t generation; // Of the interpreter's memory when the slots were resolved
+    std::size_t tree_fallbacks;
+    std::unique_ptr<JitModule> jit; // While enabled, runs of number-only statements are compiled to native regions
+
+    Slot* const addSlot(std::string_view name);
+    void resolveSlots();
+    Value* const lookup(Slot* const slot);
+
+    Value binary(int op, Value lhs, Value rhs);
+    void runSequence(VariableSequenceData* seq);
+
+    ClosureExpression compileExpression(ASTBase* ast);
+    ClosureExpression compileBinary(BinaryOperationAST* ast);
+    ClosureExpression compileCall(FunctionCallAST* ast);
+    ClosureExpression compileSequence(SequenceAST* ast);
+    std::vector<ClosureStatement> compileBody(ASTList<ASTBase> const& body);
+    ClosureStatement compileStatement(ASTBase* ast);
+    ClosureStatement compileDefinition(VariableDefinitionAST* ast);
+    ClosureStatement compileAssignment(VariableAssignmentAST* ast);
+    ClosureStatement compileIfElse(IfElseAST* ast);
+    ClosureStatement compileDoFor(DoForAST* ast);
+    ClosureStatement compileTree(ASTBase* ast);
+public:
+    ClosureProgram(Interpreter& interpreter);
+    ~ClosureProgram();
+
+    // The slots are only resolved again after the interpreter removed variables
+    void run();
+
+    std::size_t const getTreeFallbackCount() const;
+
+    // Functions are resolved here, libraries have to be registered before. The program's ASTs have to outlive it.
+    static std::unique_ptr<ClosureProgram> compile(Interpreter& interpreter, MainAST* const main);
+    // The calls of a sequence as its statements, for the tiered tree walker. Only the interpreter's functions are
+    // read, so it can be compiled on another thread while the interpreter runs.
+    static std::unique_ptr<ClosureProgram> compileCalls(Interpreter& interpreter, std::vector<FunctionCallAST*> const& calls);
+};
+///--- Closure Compiler ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "incremental.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace xeouz
+{
+
+///--- Incremental Parser ---///
+IncrementalParser::IncrementalParser(): reparsed_count(0)
+{
+
+}
+
+std::string const& IncrementalParser::getText() const
+{
+    return text;
+}
+std::size_t const IncrementalParser::getStatementCount() const
+{
+    return statements.size();
+}
+ASTBase* const IncrementalParser::getStatement(std::size_t index) const
+{
+    return statements[index].ast.get();
+}
+bool const IncrementalParser::isStatementParsed(std::size_t index) const
+{
+    return statements[index].parsed;
+}
+std::uint32_t const IncrementalParser::getStatementOffset(std::size_t index) const
+{
+    return statements[index].begin;
+}
+std::size_t const IncrementalParser::getReparsedCount() const
+{
+    return reparsed_count;
+}
+
+// Token offsets of terminated strings are those of their contents, a parse has to restart at the quote
+std::size_t const IncrementalParser::getTokenStart(Parser const& parser, std::size_t from) const
+{
+    std::size_t offset = from + parser.getCurrentTokenOffset();
+    if(parser.getCurrentTokenType() == T_STRING && offset + parser.getCurrentTokenValue().length() < text.length())
+        return offset - 1;
+    return offset;
+}
+
+// Parses from offset `from` and replaces statements [first, n) with the result, where n is the first
+// statement from `keep` on that the parse reaches the start of. Statements from `keep` on start in
+// unchanged text that moved by `delta`. Tokens are only read as far as the parse gets.
+std::size_t IncrementalParser::reparse(std::size_t first, std::size_t keep, std::size_t from, std::ptrdiff_t delta)
+{
+    for(std::size_t i=keep; i<statements.size(); ++i)
+        statements[i].begin += delta;
+
+    ArenaScope heap(nullptr); // Statements are replaced one at a time, an arena would never be released
+    auto lexer = std::make_unique<Lexer>(SourceStream::fromText(std::string_view(text).substr(from)), 4096);
+    auto parser = Parser::create(std::move(lexer));
+
+    ASTList<ASTBase> parsed_statements(Arena::getActiveResource());
+    ASTList<ExternAST> parsed_externs(Arena::getActiveResource());
+    std::vector<Statement> parsed;
+    std::size_t resync = keep;
+
+    parser->startParsing();
+    while(true)
+    {
+        std::size_t at = getTokenStart(*parser, from);
+        while(resync < statements.size() && statements[resync].begin < at)
+            resync++;
+        if(resync < statements.size() && statements[resync].begin == at)
+            break;
+
+        parser->resetParseSuccess();
+        if(!parser->ParseTopLevel(parsed_statements, parsed_externs))
+        {
+            resync = statements.size();
+            break;
+        }
+
+        Statement statement = {(std::uint32_t)at, parser->getParseSuccess(), nullptr};
+        if(!parsed_statements.empty())
+            statement.ast = std::move(parsed_statements.back());
+        else if(!parsed_externs.empty())
+            statement.ast = std::move(parsed_externs.back());
+        parsed_statements.clear();
+        parsed_externs.clear();
+        parser->releaseTokens();
+
+        parsed.push_back(std::move(statement));
+    }
+
+    statements.erase(statements.begin() + first, statements.begin() + resync);
+    statements.insert(statements.begin() + first, std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+    reparsed_count = parsed.size();
+    return first;
+}
+
+std::size_t IncrementalParser::append(std::string_view input)
+{
+    // The input can continue the last statement even when it parsed, like `let a = 1` and `2`
+    std::size_t first = statements.size();
+    std::size_t from = text.length();
+    if(!statements.empty())
+    {
+        first--;
+        from = statements.back().begin;
+    }
+
+    text.append(input);
+    return reparse(first, statements.size(), from, 0);
+}
+std::size_t IncrementalParser::edit(std::size_t offset, std::size_t length, std::string_view replacement)
+{
+    offset = std::min(offset, text.length());
+    length = std::min(length, text.length() - offset);
+    text.replace(offset, length, replacement);
+
+    auto by_begin = [](std::size_t value, Statement const& statement) { return value < statement.begin; };
+
+    // The statement holding the edit, and the one before it since where it ends depends on the token after it
+    std::size_t first = std::upper_bound(statements.begin(), statements.end(), offset, by_begin) - statements.begin();
+    first = first >= 2 ? first - 2 : 0;
+    // Statements starting past the replaced text are unchanged, one starting right at its end may merge with the replacement
+    std::size_t keep = std::upper_bound(statements.begin(), statements.end(), offset + length, by_begin) - statements.begin();
+
+    std::size_t from = first > 0 ? statements[first].begin : 0;
+    return reparse(first, std::max(first, keep), from, (std::ptrdiff_t)replacement.length() - (std::ptrdiff_t)length);
+}
+
+std::unique_ptr<IncrementalParser> IncrementalParser::create()
+{
+    return std::make_unique<IncrementalParser>();
+}
+///--- Incremental Parser ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lex.h"
+#include "parse.h"
+#include "ast.h"
+
+namespace xeouz
+{
+
+///--- Incremental Parser ---///
+// Source text of a REPL or editor session kept together with its parsed top-level statements.
+// A change is re-lexed and re-parsed from the statement before it, only until the parse lines
+// up with the start of a statement whose text did not change; everything after that is kept.
+// Statements are heap allocated and freed one by one as they are replaced, an Interpreter
+// must not run sequences defined by a statement that has since been replaced.
+class IncrementalParser
+{
+    struct Statement
+    {
+        std::uint32_t begin; // Where its first token starts
+        bool parsed;
+        std::unique_ptr<ASTBase> ast; // An ExternAST for externs
+    };
+
+    std::string text;
+    std::vector<Statement> statements;
+    std::size_t reparsed_count;
+
+    std::size_t const getTokenStart(Parser const& parser, std::size_t from) const;
+    std::size_t reparse(std::size_t first, std::size_t keep, std::size_t from, std::ptrdiff_t delta);
+public:
+    IncrementalParser();
+
+    std::string const& getText() const;
+    std::size_t const getStatementCount() const;
+    ASTBase* const getStatement(std::size_t index) const;
+    bool const isStatementParsed(std::size_t index) const;
+    std::uint32_t const getStatementOffset(std::size_t index) const;
+    // Statements parsed by the last append or edit, they start at the index it returned
+    std::size_t const getReparsedCount() const;
+
+    // Input for a REPL, statements before the last one are left alone.
+    // Returns the index of the first re-parsed statement.
+    std::size_t append(std::string_view input);
+    // Replaces `length` bytes at `offset`, returns the index of the first re-parsed statement
+    std::size_t edit(std::size_t offset, std::size_t length, std::string_view replacement);
+
+    static std::unique_ptr<IncrementalParser> create();
+};
+///--- Incremental Parser ---///
+
+}
\ No newline at end of file
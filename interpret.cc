@@ -1,4 +1,9 @@
 #include "interpret.h"
+#include "bytecode.h"
+#include "regvm.h"
+#include "closure.h"
+#include "aot.h"
+#include "tier.h"
 
 #include <iostream>
 #include <type_traits>
@@ -92,15 +97,41 @@ std::vector<FunctionCallAST*> const& VariableSequenceData::getValue() const
 void VariableSequenceData::setValue(std::vector<FunctionCallAST*> _calls)
 {
     calls = std::move(_calls);
+    tier.reset();
+}
+std::vector<std::uint32_t> const& VariableSequenceData::getPoolCalls() const
+{
+    return pool_calls;
+}
+void VariableSequenceData::setPoolCalls(std::vector<std::uint32_t> _pool_calls)
+{
+    pool_calls = std::move(_pool_calls);
+}
+std::shared_ptr<TierSequence> const& VariableSequenceData::getTier() const
+{
+    return tier;
+}
+void VariableSequenceData::setTier(std::shared_ptr<TierSequence> _tier)
+{
+    tier = std::move(_tier);
 }
 VariableDataBase* VariableSequenceData::copy() const
 {
-    return new VariableSequenceData(calls);
+    auto* data = new VariableSequenceData(calls);
+    data->setPoolCalls(pool_calls);
+    data->setTier(tier);
+    return data;
 }
 std::unique_ptr<VariableSequenceData> VariableSequenceData::create(std::vector<FunctionCallAST*> value)
 {
     return std::make_unique<VariableSequenceData>(value);
 }
+std::unique_ptr<VariableSequenceData> VariableSequenceData::createFromPool(std::vector<std::uint32_t> pool_calls)
+{
+    auto data = std::make_unique<VariableSequenceData>(std::vector<FunctionCallAST*>());
+    data->setPoolCalls(std::move(pool_calls));
+    return data;
+}
 ///--- Variable Data ---///
 
 ///--- Function Call Interface ---///
@@ -131,18 +162,41 @@ std::string FCICallFunctionArguments::generateSignature() const
     return sig;
 }
 
-FCIFunction::FCIFunction(int _return_type, FCIFunctionPtr ptr, std::vector<std::pair<std::string, int>> _call_signature): return_type(_return_type)
+FCIFunction::FCIFunction(int _return_type, FCIFunctionPtr ptr, std::vector<std::pair<std::string, int>> _call_signature): return_type(_return_type), arguments_used(false)
 {
     setCallSignature(_call_signature);
     setFunctionCallPtr(ptr);
 }
+FCIFunction::FCIFunction(int _return_type, FCIValueFunctionPtr ptr, std::vector<std::pair<std::string, int>> _call_signature): return_type(_return_type), arguments_used(false)
+{
+    setCallSignature(_call_signature);
+    setValueFunctionPtr(ptr);
+}
 void FCIFunction::setFunctionCallPtr(FCIFunctionPtr ptr)
 {
     call_function = ptr;
 }
+void FCIFunction::setValueFunctionPtr(FCIValueFunctionPtr ptr)
+{
+    value_function = ptr;
+}
 void FCIFunction::setCallSignature(std::vector<std::pair<std::string, int>> const& call_sig)
 {
     call_signature = call_sig;
+
+    number_boxes.assign(call_signature.size(), VariableNumberData(0));
+    argument_map.clear();
+    argument_entries.clear();
+    for(auto const& arg_sig: call_signature)
+        argument_entries.push_back(&argument_map.insert(std::make_pair(arg_sig.first, nullptr)).first->second);
+}
+int const FCIFunction::getReturnType() const
+{
+    return return_type;
+}
+std::vector<std::pair<std::string, int>> const& FCIFunction::getCallSignature() const
+{
+    return call_signature;
 }
 std::unique_ptr<VariableDataBase> FCIFunction::call(std::unique_ptr<FCICallFunctionArguments> arguments)
 {
@@ -168,7 +222,67 @@ std::unique_ptr<VariableDataBase> FCIFunction::call(std::unique_ptr<FCICallFunct
         argument_list.insert(std::make_pair(arg_sig.first, arg));
     }
 
-    return call_function(std::move(argument_list));
+    return invoke(std::move(argument_list));
+}
+std::unique_ptr<VariableDataBase> FCIFunction::callUnchecked(FCIArguments const& arguments)
+{
+    return invoke(arguments);
+}
+std::unique_ptr<VariableDataBase> FCIFunction::invoke(FCIArguments const& arguments)
+{
+    if(call_function)
+        return call_function(arguments);
+
+    std::vector<Value> values;
+    for(auto const& arg_sig: call_signature)
+        values.push_back(Value::createBorrowed(arguments.at(arg_sig.first)));
+    return value_function(values.data()).takeData();
+}
+Value FCIFunction::callValues(Value const* arguments, std::size_t count)
+{
+    if(call_signature.size() != count)
+    {
+        std::cout << "FCIFunctionBase: call(): Argument list does match call signature" << std::endl;
+        return Value();
+    }
+
+    for(std::size_t i=0; i<call_signature.size(); ++i)
+    {
+        if(arguments[i].getType() != call_signature[i].second && call_signature[i].second != VT_ANY)
+        {
+            std::cout << "FCIFunctionBase: call(): Argument at " << i << " does not match call signature type" << std::endl;
+            return Value();
+        }
+    }
+
+    if(!call_function)
+        return value_function(arguments);
+
+    if(arguments_used)
+    {
+        FCIFunction nested(return_type, call_function, call_signature);
+        return nested.callValues(arguments, count);
+    }
+
+    for(std::size_t i=0; i<count; ++i)
+    {
+        VariableDataBase* arg = arguments[i].getData();
+        if(arguments[i].isNumber())
+        {
+            number_boxes[i].setValue(arguments[i].getNumber());
+            arg = &number_boxes[i];
+        }
+        else if(arguments[i].isVoid())
+        {
+            arg = &void_box;
+        }
+        *argument_entries[i] = arg;
+    }
+
+    arguments_used = true;
+    auto result = call_function(argument_map);
+    arguments_used = false;
+    return Value::createOwned(std::move(result));
 }
 
 FCIFunctionLibraryBase::FCIFunctionLibraryBase(std::string const& lib_name): name(lib_name)
@@ -188,6 +302,11 @@ void FCIFunctionLibraryBase::useFunction(std::string const& name, FCIFunctionPtr
     auto func = std::make_unique<FCIFunction>(args.ret_type, ptr, args.args);
     lib.insert(std::make_pair(name, std::move(func)));
 }
+void FCIFunctionLibraryBase::useValueFunction(std::string const& name, FCIValueFunctionPtr ptr, FCIImplementableFunctionArguments const& args)
+{
+    auto func = std::make_unique<FCIFunction>(args.ret_type, ptr, args.args);
+    lib.insert(std::make_pair(name, std::move(func)));
+}
 std::unordered_map<std::string, std::unique_ptr<FCIFunction>> FCIFunctionLibraryBase::moveLibrary()
 {
     return std::move(lib);
@@ -195,9 +314,98 @@ std::unordered_map<std::string, std::unique_ptr<FCIFunction>> FCIFunctionLibrary
 ///--- Function Call Interface ---///
 
 ///--- Interpreter ---///
-Interpreter::Interpreter(std::unique_ptr<Parser> _parser): parser(std::move(_parser))
+Interpreter::Interpreter(std::unique_ptr<Parser> _parser, int _backend): parser(std::move(_parser)), backend(_backend), jit_enabled(true), quickening_enabled(true), superinstructions_enabled(true), superinstruction_count(0), program_cache(nullptr), memory_cache(nullptr), memory_generation(0), pool_slots_generation(0), reload_stats({0, 0, 0})
+{
+
+}
+Interpreter::~Interpreter()
+{
+
+}
+
+Parser* const Interpreter::getParser() const
 {
+    return parser.get();
+}
 
+int const Interpreter::getBackend() const
+{
+    return backend;
+}
+void Interpreter::setBackend(int new_backend)
+{
+    backend = new_backend;
+}
+bool const Interpreter::isJitEnabled() const
+{
+    return jit_enabled;
+}
+void Interpreter::setJitEnabled(bool enabled)
+{
+    jit_enabled = enabled;
+}
+bool const Interpreter::isQuickeningEnabled() const
+{
+    return quickening_enabled;
+}
+void Interpreter::setQuickeningEnabled(bool enabled)
+{
+    quickening_enabled = enabled;
+}
+bool const Interpreter::isSuperinstructionsEnabled() const
+{
+    return superinstructions_enabled;
+}
+void Interpreter::setSuperinstructionsEnabled(bool enabled)
+{
+    superinstructions_enabled = enabled;
+}
+std::size_t const Interpreter::getSuperinstructionCount() const
+{
+    return superinstruction_count;
+}
+bool const Interpreter::isTieringEnabled() const
+{
+    return tiers != nullptr;
+}
+void Interpreter::setTieringEnabled(bool enabled)
+{
+    if(!enabled)
+        tiers.reset();
+    else if(!tiers)
+        tiers = TierManager::create(*this);
+}
+TierManager* const Interpreter::getTierManager() const
+{
+    return tiers.get();
+}
+std::shared_ptr<AotOptions> const& Interpreter::getAotOptions() const
+{
+    return aot_options;
+}
+void Interpreter::setAotOptions(std::shared_ptr<AotOptions> options)
+{
+    aot_options = std::move(options);
+}
+std::size_t const Interpreter::getAotModuleCount() const
+{
+    return aot_modules.size();
+}
+ProgramCache* const Interpreter::getProgramCache() const
+{
+    return program_cache;
+}
+void Interpreter::setProgramCache(ProgramCache* cache)
+{
+    program_cache = cache;
+}
+ProgramMemoryCache* const Interpreter::getProgramMemoryCache() const
+{
+    return memory_cache;
+}
+void Interpreter::setProgramMemoryCache(ProgramMemoryCache* cache)
+{
+    memory_cache = cache;
 }
 
 VariableDataBase* Interpreter::LogError(std::string const& str)
@@ -210,32 +418,35 @@ std::unique_ptr<VariableDataBase> Interpreter::LogErrorU(std::string const& str)
     std::cout << str << std::endl;
     return nullptr;
 }
+Value Interpreter::LogErrorV(std::string const& str)
+{
+    std::cout << str << std::endl;
+    return Value();
+}
 
 void Interpreter::defineVariable(std::string const& name, std::unique_ptr<VariableDataBase> data)
 {
-    if(data == nullptr)
-        data = std::make_unique<VariableVoidData>();
-    memory.insert(std::make_pair(name, std::move(data)));
+    memory.emplace(name, data ? Value::createOwned(std::move(data)) : Value::createVoid());
 }
 bool Interpreter::isVariableDefined(std::string const& name)
 {
     return memory.count(name);
 }
-VariableDataBase* const Interpreter::getVariableValue(std::string const& name)
+Value const& Interpreter::getVariableValue(std::string const& name)
 {
-    return memory.at(name).get();
+    return memory.at(name);
 }
 void Interpreter::replaceVariableValue(std::string const& name, std::unique_ptr<VariableDataBase> new_value)
 {
-    memory[name] = std::move(new_value);
+    memory[name] = Value::createOwned(std::move(new_value));
 }
 void Interpreter::changeVariableNumberValue(std::string const& name, double new_value)
 {
-    ((VariableNumberData*)memory.at(name).get())->setValue(new_value);
+    memory.at(name) = Value::createNumber(new_value);
 }
 void Interpreter::changeVariableStringValue(std::string const& name, std::string const& new_value)
 {
-    ((VariableStringData*)memory.at(name).get())->setValue(new_value);
+    memory.at(name).getString()->setValue(new_value);
 }
 
 bool Interpreter::isFunctionDefined(std::string const& name)
@@ -272,12 +483,13 @@ VariableDataBase* const Interpreter::interpretPrimary(ASTBase* const ast)
         // case AST_DOTHROUGH: return interpretDoThrough((DoThroughAST* const)ast);
     }
 }
-std::unique_ptr<VariableDataBase> Interpreter::interpretExpression(ASTBase* const ast)
+// Numbers come back unboxed and variables borrowed, only new strings and sequences are allocated
+Value Interpreter::interpretExpression(ASTBase* const ast)
 {
     switch(ast->type)
     {
         default: {
-            return LogErrorU("INTERPRETER: interpretExpression(): Unable to interpret invalid AST type `"+ast->toString()+"`");
+            return LogErrorV("INTERPRETER: interpretExpression(): Unable to interpret invalid AST type `"+ast->toString()+"`");
         }
 
         case AST_NUMBER: return interpretNumber((NumberAST* const)ast);
@@ -286,92 +498,105 @@ std::unique_ptr<VariableDataBase> Interpreter::interpretExpression(ASTBase* cons
         case AST_CALL: return interpretFunctionCall((FunctionCallAST* const)ast);
 
         case AST_VAR: {
-            auto* val = interpretVariable((VariableAST* const)ast);
-            return std::unique_ptr<VariableDataBase>(VariableDataBase::copyByType(val));
+            auto* var = interpretVariable((VariableAST* const)ast);
+            return var ? var->borrow() : Value();
         }
 
-        case AST_SEQUENCE: return interpretSequence((SequenceAST* const)ast);
+        case AST_SEQUENCE: return Value::createOwned(interpretSequence((SequenceAST* const)ast));
         
         case AST_BINOP: return interpretBinaryOperation((BinaryOperationAST* const)ast);
     }
 }
 
-VariableDataBase* const Interpreter::interpretVariable(VariableAST* const ast)
+Value* const Interpreter::interpretVariable(VariableAST* const ast)
 {
-    if(!isVariableDefined(ast->getName()))
+    std::string name(ast->getName());
+    auto it = memory.find(name);
+    if(it == memory.end())
     {
-        return LogError(std::string("INTERPRETER: interpretVariable(): Variable `"+ast->getName()+"` is not defined"));
+        LogError(std::string("INTERPRETER: interpretVariable(): Variable `")+name+"` is not defined");
+        return nullptr;
     }
 
-    return getVariableValue(ast->getName());
+    return &it->second;
 }
 VariableDataBase* const Interpreter::interpretVariableDefinition(VariableDefinitionAST* const ast)
 {
-    if(isVariableDefined(ast->getName()))
+    if(ast->getSuperinstruction() == SI_DEFINE_CALL)
+        return interpretDefineCall(ast);
+
+    std::string name(ast->getName());
+    if(isVariableDefined(name))
     {
-        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)"+ast->getName()+"` is already defined"));
+        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)")+name+"` is already defined");
     }
 
     auto val = interpretExpression(ast->getValue());
-    if(val == nullptr)
+    if(!val)
     {
-        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `"+ast->getName()+"`"));
+        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `")+name+"`");
     }
 
-    defineVariable(ast->getName(), std::move(val));
+    memory.emplace(std::move(name), val.take());
 
     return nullptr;
 }
 VariableDataBase* const Interpreter::interpretVariableAssignment(VariableAssignmentAST* const ast)
 {
-    if(!isVariableDefined(ast->getName()))
-    {
-        return LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)"+ast->getName()+"` is not defined"));
-    }
+    if(ast->getSuperinstruction() == SI_SHORTHAND_NUMBER)
+        return interpretShorthandNumber(ast);
 
-    auto val = interpretExpression(ast->getValue());
-    if(val == nullptr)
+    std::string name(ast->getName());
+    if(!isVariableDefined(name))
     {
-        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable assignment of `"+ast->getName()+"`"));
+        return LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+name+"` is not defined");
     }
 
-    int var_type = getVariableValue(ast->getName())->getType();
-    if(ast->isShorthand())
+    return assignVariable(name, interpretExpression(ast->getValue()), ast->getShorthandOperator());
+}
+// Stores the evaluated value of an assignment to a defined variable, `shorthand_operator` is T_EOF for a plain one.
+// A number or string into a variable of its type is stored in place.
+VariableDataBase* const Interpreter::assignVariable(std::string const& name, Value val, int shorthand_operator)
+{
+    return assignVariable(memory.at(name), name, std::move(val), shorthand_operator);
+}
+// `name` is only used for messages, `variable` is already looked up
+VariableDataBase* const Interpreter::assignVariable(Value& variable, std::string_view name, Value val, int shorthand_operator)
+{
+    if(!val)
     {
-        auto* op = ast->getShorthandOperator();
-        auto op_val = useBinaryOperation(op, getVariableValue(ast->getName()), val.get());
-        val = std::move(op_val);
+        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable assignment of `")+std::string(name)+"`");
     }
 
-    if(val == nullptr)
+    if(shorthand_operator != T_EOF)
     {
-        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable assignment of `"+ast->getName()+"`"));
+        val = useBinaryOperation(shorthand_operator, variable, val);
     }
-    
-    if(val->getType() == var_type)
+
+    if(!val)
     {
-        switch(val->getType())
-        {
-            case VT_NUMBER: changeVariableNumberValue(ast->getName(), ((VariableNumberData*)val.get())->getValue()); break;
-            case VT_STRING: changeVariableStringValue(ast->getName(), ((VariableStringData*)val.get())->getValue()); break;
-            default: replaceVariableValue(ast->getName(), std::move(val));
-        }
+        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable assignment of `")+std::string(name)+"`");
     }
+
+    if(val.getType() == VT_STRING && variable.getType() == VT_STRING && !val.isOwned())
+        variable.getString()->setValue(val.getString()->getValue());
     else
-    {
-        replaceVariableValue(ast->getName(), std::move(val));
-    }
+        variable = val.take();
 
     return nullptr;
 }
+VariableDataBase* const Interpreter::assignVariable(std::string const& name, std::unique_ptr<VariableDataBase> val, int shorthand_operator)
+{
+    return assignVariable(name, Value::createOwned(std::move(val)), shorthand_operator);
+}
 
-std::unique_ptr<VariableNumberData> Interpreter::interpretNumber(NumberAST* const ast)
+Value Interpreter::interpretNumber(NumberAST* const ast)
 {
-    return std::make_unique<VariableNumberData>(ast->getValue());
+    return Value::createNumber(ast->getValue());
 }
-std::unique_ptr<VariableStringData> Interpreter::interpretString(StringAST* const ast)
+Value Interpreter::interpretString(StringAST* const ast)
 {
-    return std::make_unique<VariableStringData>(ast->getValue());
+    return Value::createOwned(std::make_unique<VariableStringData>(std::string(ast->getValue())));
 }
 
 std::unique_ptr<VariableSequenceData> Interpreter::interpretSequence(SequenceAST* const ast)
@@ -388,20 +613,22 @@ std::unique_ptr<VariableSequenceData> Interpreter::interpretSequence(SequenceAST
 }
 VariableDataBase* const Interpreter::interpretDoFor(DoForAST* const ast)
 {
-    auto for_times_base = interpretExpression(ast->getForTimes());
-    if(!for_times_base)
+    auto for_times = interpretExpression(ast->getForTimes());
+    if(!for_times)
     {
         return LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of valid");
     }
 
-    if(for_times_base->getType() != VT_NUMBER)
+    if(!for_times.isNumber())
     {
         return LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of type number");
     }
 
-    auto* for_times = (VariableNumberData* const)for_times_base.get();
+    if(tiers)
+        return tiers->runDoFor(ast, for_times.getNumber());
+
     auto const& sequences = ast->getSequences();
-    for(int i=0; i<for_times->getValue(); ++i)
+    for(int i=0; i<for_times.getNumber(); ++i)
     {
         for(auto&& ast: sequences)
         {
@@ -420,7 +647,7 @@ VariableDataBase* const Interpreter::interpretDoFor(DoForAST* const ast)
                 else if(var->getType() != VT_SEQUENCE)
                     return LogError("INTERPRETER: interpretDoFor(): Sequence variable given is not of type <sequence>");
                 
-                seq = (VariableSequenceData*)var;
+                seq = var->getSequence();
             }
             if(!seq)
             {
@@ -431,88 +658,98 @@ VariableDataBase* const Interpreter::interpretDoFor(DoForAST* const ast)
             {
                 interpretFunctionCall(stm);
             }
+            for(auto call: seq->getPoolCalls())
+            {
+                interpretPoolFunctionCall(call);
+            }
         }
     }
 
     return nullptr;
 }
 
-std::unique_ptr<VariableDataBase> Interpreter::interpretFunctionCall(FunctionCallAST* const ast)
+// The arguments go on `call_arguments` above those of the calls enclosing this one
+Value Interpreter::interpretFunctionCall(FunctionCallAST* const ast)
 {
-    if(!isFunctionDefined(ast->getName()))
+    std::string name(ast->getName());
+    auto function = functions.find(name);
+    if(function == functions.end())
     {
-        return LogErrorU(std::string("INTERPRETER: interpretFunctionCall(): Function `")+ast->getName()+"` was not found");
+        return LogErrorV(std::string("INTERPRETER: interpretFunctionCall(): Function `")+name+"` was not found");
     }
 
+    std::size_t base = call_arguments.size();
     int indx = 0;
-    std::vector<FCIType> args;
     for(auto&& arg_ast: ast->getArguments())
     {
         auto val = interpretExpression(arg_ast.get());
         if(!val)
         {
-            return LogErrorU(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+ast->getName()+"`, argument at index "+std::to_string(indx)+" is invalid"); 
+            call_arguments.erase(call_arguments.begin() + base, call_arguments.end());
+            return LogErrorV(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+name+"`, argument at index "+std::to_string(indx)+" is invalid"); 
         }
-        args.push_back(std::move(val));
+        call_arguments.push_back(std::move(val));
         indx++;
     }
 
-    auto fci_args = std::make_unique<FCICallFunctionArguments>(std::move(args));
-
-    return callFunction(ast->getName(), std::move(fci_args));
+    auto result = function->second->callValues(call_arguments.data() + base, call_arguments.size() - base);
+    call_arguments.erase(call_arguments.begin() + base, call_arguments.end());
+    return result;
 }
 
-std::unique_ptr<VariableDataBase> Interpreter::useBinaryOperation(Token* op, VariableDataBase* lhs, VariableDataBase* rhs)
+Value Interpreter::useBinaryOperation(int op, Value const& lhs, Value const& rhs)
 {
-    if(!(lhs->getType() == VT_STRING || lhs->getType() == VT_NUMBER))
-        return LogErrorU("INTERPRETER: useBinaryOperation(): LHS is neither a string nor a number");
-    if(!(rhs->getType() == VT_STRING || rhs->getType() == VT_NUMBER))
-        return LogErrorU("INTERPRETER: useBinaryOperation(): RHS is neither a string nor a number");
+    int lhs_type = lhs.getType();
+    int rhs_type = rhs.getType();
+    if(!(lhs_type == VT_STRING || lhs_type == VT_NUMBER))
+        return LogErrorV("INTERPRETER: useBinaryOperation(): LHS is neither a string nor a number");
+    if(!(rhs_type == VT_STRING || rhs_type == VT_NUMBER))
+        return LogErrorV("INTERPRETER: useBinaryOperation(): RHS is neither a string nor a number");
 
-    if(lhs->getType() == rhs->getType() && lhs->getType() == VT_NUMBER) // If both are numbers
+    if(lhs_type == rhs_type && lhs_type == VT_NUMBER) // If both are numbers
     {
-        auto* nlhs = (VariableNumberData*)lhs;
-        auto* nrhs = (VariableNumberData*)rhs;
-        switch (op->getTokenType())
+        double nlhs = lhs.getNumber();
+        double nrhs = rhs.getNumber();
+        switch(op)
         {
             default: {
-                return LogErrorU("INTERPRETER: useBinaryOperation(): Given token is unknown");
+                return LogErrorV("INTERPRETER: useBinaryOperation(): Given token is unknown");
             }
-            case T_ADD: return std::make_unique<VariableNumberData>(nlhs->getValue() + nrhs->getValue());
-            case T_SUB: return std::make_unique<VariableNumberData>(nlhs->getValue() - nrhs->getValue());
-            case T_MUL: return std::make_unique<VariableNumberData>(nlhs->getValue() * nrhs->getValue());
-            case T_DIV: return std::make_unique<VariableNumberData>(nlhs->getValue() / nrhs->getValue());
-            case T_MOD: return std::make_unique<VariableNumberData>((long)nlhs->getValue() % (long)nrhs->getValue());
-            case T_DEQUAL: return std::make_unique<VariableNumberData>(nlhs->getValue() == nrhs->getValue());
-            case T_NOTEQ: return std::make_unique<VariableNumberData>(nlhs->getValue() != nrhs->getValue());
-            case T_LARROW: return std::make_unique<VariableNumberData>(nlhs->getValue() < nrhs->getValue());
-            case T_RARROW: return std::make_unique<VariableNumberData>(nlhs->getValue() > nrhs->getValue());
-            case T_LESSEQ: return std::make_unique<VariableNumberData>(nlhs->getValue() <= nrhs->getValue());
-            case T_MOREEQ: return std::make_unique<VariableNumberData>(nlhs->getValue() >= nrhs->getValue());
+            case T_ADD: return Value::createNumber(nlhs + nrhs);
+            case T_SUB: return Value::createNumber(nlhs - nrhs);
+            case T_MUL: return Value::createNumber(nlhs * nrhs);
+            case T_DIV: return Value::createNumber(nlhs / nrhs);
+            case T_MOD: return Value::createNumber((long)nlhs % (long)nrhs);
+            case T_DEQUAL: return Value::createNumber(nlhs == nrhs);
+            case T_NOTEQ: return Value::createNumber(nlhs != nrhs);
+            case T_LARROW: return Value::createNumber(nlhs < nrhs);
+            case T_RARROW: return Value::createNumber(nlhs > nrhs);
+            case T_LESSEQ: return Value::createNumber(nlhs <= nrhs);
+            case T_MOREEQ: return Value::createNumber(nlhs >= nrhs);
         }
     }
-    else if(lhs->getType() == rhs->getType() && lhs->getType() == VT_STRING) // If both are strings
+    else if(lhs_type == rhs_type && lhs_type == VT_STRING) // If both are strings
     {
-        auto* slhs = (VariableStringData*)lhs;
-        auto* srhs = (VariableStringData*)rhs;
+        auto* slhs = lhs.getString();
+        auto* srhs = rhs.getString();
 
-        switch (op->getTokenType())
+        switch(op)
         {
             default: {
-                return LogErrorU(std::string("INTERPRETER: useBinaryOperation(): Cannot use token ")+op->toString()+" on a string");
+                return LogErrorV(std::string("INTERPRETER: useBinaryOperation(): Cannot use token ")+Token::GetStringFromType(op)+" on a string");
             }
-            case T_ADD: return std::make_unique<VariableStringData>(slhs->getValue() + srhs->getValue());
-            case T_DEQUAL: return std::make_unique<VariableNumberData>(slhs->getValue() == srhs->getValue());
-            case T_NOTEQ: return std::make_unique<VariableNumberData>(slhs->getValue() != srhs->getValue());
+            case T_ADD: return Value::createOwned(std::make_unique<VariableStringData>(slhs->getValue() + srhs->getValue()));
+            case T_DEQUAL: return Value::createNumber(slhs->getValue() == srhs->getValue());
+            case T_NOTEQ: return Value::createNumber(slhs->getValue() != srhs->getValue());
         }
     }
-    else if(lhs->getType() != rhs->getType() && (lhs->getType() == VT_STRING || rhs->getType() == VT_STRING)) // If one of them is a string
+    else if(lhs_type != rhs_type && (lhs_type == VT_STRING || rhs_type == VT_STRING)) // If one of them is a string
     {
-        auto* str = (lhs->getType()==VT_STRING)?(VariableStringData*)lhs : (VariableStringData*)rhs;
-        auto* num = (lhs->getType()==VT_NUMBER)?(VariableNumberData*)lhs : (VariableNumberData*)rhs;
-        int lhs_str = (lhs->getType()==VT_STRING);
+        auto* str = (lhs_type==VT_STRING)?lhs.getString() : rhs.getString();
+        double num = (lhs_type==VT_NUMBER)?lhs.getNumber() : rhs.getNumber();
+        int lhs_str = (lhs_type==VT_STRING);
 
-        auto numstr = std::to_string(num->getValue());
+        auto numstr = std::to_string(num);
         numstr.erase ( numstr.find_last_not_of('0') + 1, std::string::npos );
         numstr.erase ( numstr.find_last_not_of('.') + 1, std::string::npos );
 
@@ -522,46 +759,248 @@ std::unique_ptr<VariableDataBase> Interpreter::useBinaryOperation(Token* op, Var
         else
             string_data = numstr + str->getValue();
 
-        switch(op->getTokenType())
+        switch(op)
         {
             default: {
-                return LogErrorU(std::string("INTERPRETER: useBinaryOperation(): Cannot use token ")+op->toString()+" between a string and number");
+                return LogErrorV(std::string("INTERPRETER: useBinaryOperation(): Cannot use token ")+Token::GetStringFromType(op)+" between a string and number");
             }
 
-            case T_ADD: return std::make_unique<VariableStringData>(string_data);
+            case T_ADD: return Value::createOwned(std::make_unique<VariableStringData>(string_data));
         }
     }
     else
     {
-        return LogErrorU("INTERPRETER: useBinaryOperation(): Binary operation is being used on invalid types");
+        return LogErrorV("INTERPRETER: useBinaryOperation(): Binary operation is being used on invalid types");
     }
 }
-std::unique_ptr<VariableDataBase> Interpreter::interpretBinaryOperation(BinaryOperationAST* const ast)
+std::unique_ptr<VariableDataBase> Interpreter::useBinaryOperation(int op, VariableDataBase* lhs, VariableDataBase* rhs)
+{
+    return useBinaryOperation(op, Value::createBorrowed(lhs), Value::createBorrowed(rhs)).takeData();
+}
+namespace
+{
+
+// A site is quickened after this many executions in a row could have been, and left generic after this many deopts
+constexpr std::uint8_t quicken_after = 8;
+constexpr std::uint8_t deopts_allowed = 4;
+
+double numberAdd(double lhs, double rhs) { return lhs + rhs; }
+double numberSub(double lhs, double rhs) { return lhs - rhs; }
+double numberMul(double lhs, double rhs) { return lhs * rhs; }
+double numberDiv(double lhs, double rhs) { return lhs / rhs; }
+double numberMod(double lhs, double rhs) { return (long)lhs % (long)rhs; }
+double numberEqual(double lhs, double rhs) { return lhs == rhs; }
+double numberNotEqual(double lhs, double rhs) { return lhs != rhs; }
+double numberLess(double lhs, double rhs) { return lhs < rhs; }
+double numberMore(double lhs, double rhs) { return lhs > rhs; }
+double numberLessEqual(double lhs, double rhs) { return lhs <= rhs; }
+double numberMoreEqual(double lhs, double rhs) { return lhs >= rhs; }
+
+// The number case of useBinaryOperation for `op`, nullptr where it logs an error
+double (*numberOperation(int op))(double, double)
+{
+    switch(op)
+    {
+        default: return nullptr;
+        case T_ADD: return numberAdd;
+        case T_SUB: return numberSub;
+        case T_MUL: return numberMul;
+        case T_DIV: return numberDiv;
+        case T_MOD: return numberMod;
+        case T_DEQUAL: return numberEqual;
+        case T_NOTEQ: return numberNotEqual;
+        case T_LARROW: return numberLess;
+        case T_RARROW: return numberMore;
+        case T_LESSEQ: return numberLessEqual;
+        case T_MOREEQ: return numberMoreEqual;
+    }
+}
+
+}
+
+// Counts the executions in a row one specialization could have taken, and quickens the site to it once there are enough
+void Interpreter::recordBinaryOperation(BinaryOperationAST* const ast, int lhs_type, int rhs_type)
+{
+    auto& feedback = ast->getFeedback();
+    std::uint8_t seen = BQ_GENERIC;
+    if(lhs_type == VT_NUMBER && rhs_type == VT_NUMBER && numberOperation(ast->getOperator()))
+        seen = BQ_NUMBER;
+    else if(lhs_type == VT_STRING && rhs_type == VT_STRING && ast->getOperator() == T_ADD)
+        seen = BQ_STRING;
+
+    if(seen != feedback.seen)
+    {
+        feedback.seen = seen;
+        feedback.hits = 0;
+    }
+    if(seen == BQ_GENERIC || ++feedback.hits < quicken_after)
+        return;
+
+    feedback.state = seen;
+    feedback.number = numberOperation(ast->getOperator());
+}
+// A quickened site computes behind a check of both types, a string one appends to an LHS it owns. When the check
+// fails the site is deoptimized and the operation goes through useBinaryOperation.
+Value Interpreter::interpretBinaryOperation(BinaryOperationAST* const ast)
 {
     auto lhs = interpretExpression(ast->getLHS());
     auto rhs = interpretExpression(ast->getRHS());
 
     if(!lhs || !rhs)
     {
-        return LogErrorU("INTERPRETER: interpretBinaryOperation(): Binary operation has invalid LHS or RHS");
+        return LogErrorV("INTERPRETER: interpretBinaryOperation(): Binary operation has invalid LHS or RHS");
     }
 
-    return useBinaryOperation(ast->getOperator(), lhs.get(), rhs.get());
+    auto& feedback = ast->getFeedback();
+    switch(quickening_enabled ? feedback.state : (std::uint8_t)BQ_UNSTABLE)
+    {
+        case BQ_NUMBER: {
+            if(!lhs.isNumber() || !rhs.isNumber())
+                break;
+            return Value::createNumber(feedback.number(lhs.getNumber(), rhs.getNumber()));
+        }
+        case BQ_STRING: {
+            if(lhs.getType() != VT_STRING || rhs.getType() != VT_STRING)
+                break;
+            if(!lhs.isOwned())
+                return Value::createOwned(std::make_unique<VariableStringData>(lhs.getString()->getValue() + rhs.getString()->getValue()));
+            auto* string = lhs.getString();
+            string->setValue(string->getValue() + rhs.getString()->getValue());
+            return lhs;
+        }
+        case BQ_GENERIC: {
+            recordBinaryOperation(ast, lhs.getType(), rhs.getType());
+            return useBinaryOperation(ast->getOperator(), lhs, rhs);
+        }
+        case BQ_UNSTABLE: return useBinaryOperation(ast->getOperator(), lhs, rhs);
+    }
+
+    // The guard failed
+    feedback.state = ++feedback.deopts < deopts_allowed ? BQ_GENERIC : BQ_UNSTABLE;
+    feedback.seen = BQ_GENERIC;
+    feedback.hits = 0;
+    return useBinaryOperation(ast->getOperator(), lhs, rhs);
 }
 
-bool Interpreter::interpretIf(IfAST* const ast)
+///--- Superinstructions ---///
+void Interpreter::fuseStatements(ASTList<ASTBase> const& body)
 {
-    auto expression = interpretExpression(ast->getExpression());
-    if(expression->getType() != VT_NUMBER)
+    if(superinstructions_enabled)
+        superinstruction_count += selectSuperinstructions(body);
+}
+// `x op= <number>` looks the variable up once and updates a number in place
+VariableDataBase* const Interpreter::interpretShorthandNumber(VariableAssignmentAST* const ast)
+{
+    std::string name(ast->getName());
+    auto it = memory.find(name);
+    if(it == memory.end())
     {
-        LogError("INTERPRETER: interpretIf(): Expression in if conditional is not of type number");
+        return LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+name+"` is not defined");
+    }
+
+    double value = ((NumberAST*)ast->getValue())->getValue();
+    auto* operation = numberOperation(ast->getShorthandOperator());
+    if(operation && it->second.isNumber())
+    {
+        it->second = Value::createNumber(operation(it->second.getNumber(), value));
+        return nullptr;
+    }
+    return assignVariable(name, Value::createNumber(value), ast->getShorthandOperator());
+}
+// `let x = f(<literals>)` builds the arguments straight from the literals and calls the function it found once
+VariableDataBase* const Interpreter::interpretDefineCall(VariableDefinitionAST* const ast)
+{
+    std::string name(ast->getName());
+    if(memory.count(name))
+    {
+        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)")+name+"` is already defined");
+    }
+
+    auto* call = (FunctionCallAST*)ast->getValue();
+    Value val;
+    auto function = functions.find(std::string(call->getName()));
+    if(function == functions.end())
+    {
+        LogErrorV(std::string("INTERPRETER: interpretFunctionCall(): Function `")+std::string(call->getName())+"` was not found");
+    }
+    else
+    {
+        std::size_t base = call_arguments.size();
+        for(auto&& arg: call->getArguments())
+        {
+            if(arg->type == AST_NUMBER)
+                call_arguments.push_back(interpretNumber((NumberAST*)arg.get()));
+            else
+                call_arguments.push_back(interpretString((StringAST*)arg.get()));
+        }
+        val = function->second->callValues(call_arguments.data() + base, call_arguments.size() - base);
+        call_arguments.erase(call_arguments.begin() + base, call_arguments.end());
+    }
+
+    if(!val)
+    {
+        return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `")+name+"`");
+    }
+    memory.emplace(std::move(name), val.take());
+    return nullptr;
+}
+// `if (x == <literal>)` compares against the variable in place. False when the variable is missing or not of the
+// literal's type, the generic walk then runs and logs as usual.
+bool const Interpreter::interpretIfEquals(IfAST* const ast, bool& condition)
+{
+    auto* binop = (BinaryOperationAST*)ast->getExpression();
+    auto it = memory.find(std::string(((VariableAST*)binop->getLHS())->getName()));
+    if(it == memory.end())
+        return false;
+
+    auto* literal = binop->getRHS();
+    auto const& value = it->second;
+    if(literal->type == AST_NUMBER && value.isNumber())
+        condition = value.getNumber() == ((NumberAST*)literal)->getValue();
+    else if(literal->type == AST_STRING && value.getType() == VT_STRING)
+        condition = value.getString()->getValue() == ((StringAST*)literal)->getValue();
+    else
         return false;
+    return true;
+}
+///--- Superinstructions ---///
+
+// A body that fails to parse logs once and then runs as an empty body. Its nodes go in `arena`, or the heap for nullptr.
+ASTList<ASTBase> Interpreter::parseLazyBody(Arena* const arena, LazyBody const& body, std::string const& name)
+{
+    ArenaScope scope(arena);
+    ASTList<ASTBase> statements(Arena::getActiveResource());
+    if(!parser->ParseLazyBody(body, statements))
+    {
+        LogError("INTERPRETER: parseLazyBody(): Could not parse the "+name+" body");
+        statements.clear();
     }
-    
-    auto* num = ((VariableNumberData*)expression.get());
+    return statements;
+}
+bool Interpreter::interpretIf(IfAST* const ast)
+{
+    bool condition;
+    if(ast->getSuperinstruction() != SI_IF_EQUALS || !interpretIfEquals(ast, condition))
+    {
+        auto expression = interpretExpression(ast->getExpression());
+        if(!expression.isNumber())
+        {
+            LogError("INTERPRETER: interpretIf(): Expression in if conditional is not of type number");
+            return false;
+        }
 
-    if(num->getValue() > 0)
+        condition = expression.getNumber() > 0;
+    }
+
+    if(condition)
     {
+        if(ast->getLazyBody().isPending())
+        {
+            ast->setBody(parseLazyBody(ast->getArena(), ast->getLazyBody(), "if"));
+            fuseStatements(ast->getBody());
+            ast->setLazyBody(LazyBody());
+        }
+
         for(auto&& stm: ast->getBody())
         {
             interpretPrimary(stm.get());
@@ -583,6 +1022,13 @@ VariableDataBase* Interpreter::interpretIfElse(IfElseAST* const ast)
 
     if(!did_run) // Run else body
     {
+        if(ast->getLazyElseBody().isPending())
+        {
+            ast->setBody(parseLazyBody(ast->getArena(), ast->getLazyElseBody(), "else"));
+            fuseStatements(ast->getElseBody());
+            ast->setLazyElseBody(LazyBody());
+        }
+
         for(auto&& stm: ast->getElseBody())
         {
             interpretPrimary(stm.get());
@@ -592,17 +1038,418 @@ VariableDataBase* Interpreter::interpretIfElse(IfElseAST* const ast)
     return nullptr;
 }
 
+///--- AST Pool Walker ---///
+// Same semantics and messages as the pointer walker above, over the rows of `pool`
+// Variables are cached by the string id of their name, a name is only hashed the first time it is used
+Value* const Interpreter::lookupPoolVariable(std::uint32_t node)
+{
+    if(pool_slots_generation != memory_generation)
+    {
+        pool_slots.assign(pool_slots.size(), nullptr);
+        pool_slots_generation = memory_generation;
+    }
+
+    std::uint32_t id = pool->getStringId(node);
+    if(id >= pool_slots.size())
+        pool_slots.resize(pool->getStringCount(), nullptr); // Bodies lowered since add strings
+    Value*& slot = pool_slots[id];
+    if(!slot)
+    {
+        auto it = memory.find(std::string(pool->getString(node)));
+        if(it != memory.end())
+            slot = &it->second;
+    }
+    return slot;
+}
+
+VariableDataBase* const Interpreter::interpretPoolPrimary(std::uint32_t node)
+{
+    switch(pool->getKind(node))
+    {
+        default: {
+            return LogError("INTERPRETER: interpretPrimary(): Unable to interpret invalid AST type `"+ASTBase::GetStringFromType(pool->getKind(node))+"`");
+        }
+        case AST_VARASSIGN: {
+            Value* var = lookupPoolVariable(node);
+            if(!var)
+            {
+                return LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+std::string(pool->getString(node))+"` is not defined");
+            }
+            return assignVariable(*var, pool->getString(node), interpretPoolExpression(pool->getFirst(node)), pool->getOperator(node));
+        }
+        case AST_VARDEF: {
+            if(lookupPoolVariable(node))
+            {
+                return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)")+std::string(pool->getString(node))+"` is already defined");
+            }
+
+            auto val = interpretPoolExpression(pool->getFirst(node));
+            if(!val)
+            {
+                return LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `")+std::string(pool->getString(node))+"`");
+            }
+
+            pool_slots[pool->getStringId(node)] = &memory.emplace(std::string(pool->getString(node)), val.take()).first->second;
+            return nullptr;
+        }
+
+        case AST_IFELSE: return interpretPoolIfElse(node);
+
+        case AST_DOFOR: return interpretPoolDoFor(node);
+        case AST_CALL: {
+            interpretPoolFunctionCall(node);
+            return nullptr;
+        }
+    }
+}
+Value Interpreter::interpretPoolExpression(std::uint32_t node)
+{
+    switch(pool->getKind(node))
+    {
+        default: {
+            return LogErrorV("INTERPRETER: interpretExpression(): Unable to interpret invalid AST type `"+ASTBase::GetStringFromType(pool->getKind(node))+"`");
+        }
+
+        case AST_NUMBER: return Value::createNumber(pool->getNumber(node));
+        case AST_STRING: return Value::createOwned(std::make_unique<VariableStringData>(std::string(pool->getString(node))));
+
+        case AST_CALL: return interpretPoolFunctionCall(node);
+
+        case AST_VAR: {
+            Value* var = lookupPoolVariable(node);
+            if(!var)
+                return LogErrorV(std::string("INTERPRETER: interpretVariable(): Variable `")+std::string(pool->getString(node))+"` is not defined");
+            return var->borrow();
+        }
+
+        case AST_SEQUENCE: return Value::createOwned(interpretPoolSequence(node));
+
+        case AST_BINOP: {
+            auto lhs = interpretPoolExpression(pool->getFirst(node));
+            auto rhs = interpretPoolExpression(pool->getSecond(node));
+
+            if(!lhs || !rhs)
+            {
+                return LogErrorV("INTERPRETER: interpretBinaryOperation(): Binary operation has invalid LHS or RHS");
+            }
+
+            return useBinaryOperation(pool->getOperator(node), lhs, rhs);
+        }
+    }
+}
+
+std::unique_ptr<VariableSequenceData> Interpreter::interpretPoolSequence(std::uint32_t node)
+{
+    std::uint32_t list = pool->getFirst(node);
+
+    std::vector<std::uint32_t> calls;
+    for(std::uint32_t i=0; i<pool->getListSize(list); ++i)
+    {
+        calls.push_back(pool->getListItem(list, i));
+    }
+
+    return VariableSequenceData::createFromPool(calls);
+}
+VariableDataBase* const Interpreter::interpretPoolDoFor(std::uint32_t node)
+{
+    auto for_times_base = interpretPoolExpression(pool->getFirst(node));
+    if(!for_times_base)
+    {
+        return LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of valid");
+    }
+
+    if(!for_times_base.isNumber())
+    {
+        return LogError("INTERPRETER: interpretDoFor(): Value specified in do-for is not of type number");
+    }
+
+    double for_times = for_times_base.getNumber();
+    std::uint32_t sequences = pool->getSecond(node);
+    for(int i=0; i<for_times; ++i)
+    {
+        for(std::uint32_t j=0; j<pool->getListSize(sequences); ++j)
+        {
+            std::uint32_t sequence = pool->getListItem(sequences, j);
+
+            VariableSequenceData* seq = nullptr;
+            std::unique_ptr<VariableSequenceData> sequp;
+            if(pool->getKind(sequence) == AST_SEQUENCE)
+            {
+                sequp = interpretPoolSequence(sequence);
+                seq = sequp.get();
+            }
+            else if(pool->getKind(sequence) == AST_VAR)
+            {
+                Value* var = lookupPoolVariable(sequence);
+                if(!var)
+                {
+                    LogError(std::string("INTERPRETER: interpretVariable(): Variable `")+std::string(pool->getString(sequence))+"` is not defined");
+                    return LogError("INTERPRETER: interpretDoFor(): Sequence variable given is invalid");
+                }
+                else if(var->getType() != VT_SEQUENCE)
+                    return LogError("INTERPRETER: interpretDoFor(): Sequence variable given is not of type <sequence>");
+                
+                seq = var->getSequence();
+            }
+            if(!seq)
+            {
+                return LogError("INTERPRETER: interpretDoFor(): Sequence given is invalid");
+            }
+
+            for(auto* stm: seq->getValue())
+            {
+                interpretFunctionCall(stm);
+            }
+            for(auto call: seq->getPoolCalls())
+            {
+                interpretPoolFunctionCall(call);
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+// The arguments go on `call_arguments`, like interpretFunctionCall
+Value Interpreter::interpretPoolFunctionCall(std::uint32_t node)
+{
+    std::string name(pool->getString(node));
+    auto function = functions.find(name);
+    if(function == functions.end())
+    {
+        return LogErrorV(std::string("INTERPRETER: interpretFunctionCall(): Function `")+name+"` was not found");
+    }
+
+    std::uint32_t list = pool->getFirst(node);
+    std::size_t base = call_arguments.size();
+    for(std::uint32_t indx=0; indx<pool->getListSize(list); ++indx)
+    {
+        auto val = interpretPoolExpression(pool->getListItem(list, indx));
+        if(!val)
+        {
+            call_arguments.erase(call_arguments.begin() + base, call_arguments.end());
+            return LogErrorV(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+name+"`, argument at index "+std::to_string(indx)+" is invalid"); 
+        }
+        call_arguments.push_back(std::move(val));
+    }
+
+    auto result = function->second->callValues(call_arguments.data() + base, call_arguments.size() - base);
+    call_arguments.erase(call_arguments.begin() + base, call_arguments.end());
+    return result;
+}
+
+bool Interpreter::interpretPoolIf(std::uint32_t node)
+{
+    auto expression = interpretPoolExpression(pool->getFirst(node));
+    if(!expression.isNumber())
+    {
+        LogError("INTERPRETER: interpretIf(): Expression in if conditional is not of type number");
+        return false;
+    }
+
+    if(expression.getNumber() > 0)
+    {
+        if(pool->hasLazyBody(node))
+            pool->setBody(node, parseLazyBody(nullptr, pool->getLazyBody(node), "if"));
+
+        std::uint32_t body = pool->getSecond(node);
+        for(std::uint32_t i=0; i<pool->getListSize(body); ++i)
+        {
+            interpretPoolPrimary(pool->getListItem(body, i));
+        }
+        return true;
+    }
+
+    return false;
+}
+VariableDataBase* Interpreter::interpretPoolIfElse(std::uint32_t node)
+{
+    bool did_run = false;
+    std::uint32_t ifs = pool->getFirst(node);
+    for(std::uint32_t i=0; i<pool->getListSize(ifs); ++i) // Run ifs
+    {
+        did_run = interpretPoolIf(pool->getListItem(ifs, i));
+        if(did_run)
+            break;
+    }
+
+    if(!did_run) // Run else body
+    {
+        if(pool->hasLazyBody(node))
+            pool->setBody(node, parseLazyBody(nullptr, pool->getLazyBody(node), "else"));
+
+        std::uint32_t body = pool->getSecond(node);
+        for(std::uint32_t i=0; i<pool->getListSize(body); ++i)
+        {
+            interpretPoolPrimary(pool->getListItem(body, i));
+        }
+    }
+
+    return nullptr;
+}
+///--- AST Pool Walker ---///
+
+
+// Runs each top-level statement as soon as it is parsed instead of waiting for the whole input.
+// A parse error stops the program at that statement, the ones before it have already run.
+void Interpreter::interpretStream()
+{
+    ASTList<ASTBase> kept(Arena::getActiveResource()); // Sequence variables point into the calls of these
+    ASTList<ASTBase> statements(Arena::getActiveResource());
+    ASTList<ExternAST> externs(Arena::getActiveResource());
+
+    parser->startParsing();
+    std::size_t sequence_count = parser->getSequenceCount();
+    while(parser->ParseTopLevel(statements, externs))
+    {
+        bool has_sequence = parser->getSequenceCount() != sequence_count;
+        sequence_count = parser->getSequenceCount();
+
+        if(!parser->getParseSuccess())
+        {
+            parser->LogError("PARSER: ParseMain(): Could not parse input code successfully\n", true, false);
+            LogError("INTERPRETER: interpretMain(): Stopping program execution");
+            return;
+        }
+        parser->releaseTokens();
+        externs.clear();
+        if(statements.empty())
+            continue;
+
+        fuseStatements(statements);
+        auto stm = std::move(statements.back());
+        statements.clear();
+        if(!stm)
+            continue;
+        interpretPrimary(stm.get());
+        if(!success)
+        {
+            LogError("INTERPRETER: interpretMain(): Stopping program execution");
+            return;
+        }
+
+        // The statement does not outlive the stream, reload matches on its hash and defined name
+        std::string definition = stm->type == AST_VARDEF ? std::string(((VariableDefinitionAST*)stm.get())->getName()) : "";
+        loaded_statements.push_back({nullptr, nullptr, hashStructure(stm.get()), true, nullptr, 0, std::move(definition)});
+        if(has_sequence)
+            kept.push_back(std::move(stm));
+    }
+}
+void Interpreter::interpretPoolMain()
+{
+    pool_slots.assign(pool->getStringCount(), nullptr);
+    pool_slots_generation = memory_generation;
+
+    std::uint32_t body = pool->getFirst(pool->getRoot());
+    for(std::uint32_t i=0; i<pool->getListSize(body); ++i)
+    {
+        interpretPoolPrimary(pool->getListItem(body, i));
+        if(!success)
+        {
+            LogError("INTERPRETER: interpretMain(): Stopping program execution");
+            break;
+        }
+    }
+}
+// A hit runs the cached pool without lexing or parsing. A miss parses eagerly, cached pools cannot hold lazy bodies.
+void Interpreter::interpretCached()
+{
+    std::uint64_t source_hash = hashSource(parser->getSource());
+    pool = memory_cache ? memory_cache->find(source_hash) : nullptr;
+    bool in_memory = pool != nullptr;
+    if(!pool && program_cache)
+        pool = program_cache->load(source_hash);
+    if(!pool)
+    {
+        bool lazy = parser->getLazyBodies();
+        parser->setLazyBodies(false);
+        std::shared_ptr<Program> program = parser->ParseProgram();
+        parser->setLazyBodies(lazy);
+        if(!program)
+        {
+            LogError("INTERPRETER: interpretMain(): Stopping program execution");
+            return;
+        }
+
+        pool = ASTPool::build(program->getMain());
+        loadStatements(program);
+        if(program_cache)
+            program_cache->store(source_hash, *pool);
+    }
+    else
+        loadPoolStatements();
+    if(memory_cache && !in_memory)
+        memory_cache->insert(source_hash, pool);
+    interpretPoolMain();
+}
 void Interpreter::interpretMain()
 {
     success = true;
-    auto ast = parser->ParseMain();
-    if(!ast)
+    if(parser->isStreaming())
+    {
+        interpretStream();
+        return;
+    }
+    // Caches hold ASTPools, only EB_POOL runs them
+    if((program_cache || memory_cache) && backend == EB_POOL)
+    {
+        interpretCached();
+        return;
+    }
+    if(program_cache || memory_cache)
+        LogError("INTERPRETER: interpretMain(): Program caches only run on EB_POOL, the program is not cached");
+
+    std::shared_ptr<Program> program = parser->ParseProgram();
+    if(!program)
     {
         LogError("INTERPRETER: interpretMain(): Stopping program execution");
         return;
     }
+    loadStatements(program);
+    interpretProgram(program.get());
+}
+// Runs a program parsed elsewhere, such as one linked by a ProgramLoader
+void Interpreter::interpretProgram(Program* const program)
+{
+    success = true;
+    if(backend == EB_POOL)
+    {
+        pool = ASTPool::build(program->getMain());
+        interpretPoolMain();
+        return;
+    }
+    if(backend == EB_BYTECODE)
+    {
+        auto bytecode = BytecodeProgram::compile(program->getMain());
+        StackVM(*this, *bytecode).run();
+        return;
+    }
+    if(backend == EB_REGISTER)
+    {
+        auto code = RegisterProgram::compile(program->getMain());
+        RegisterVM(*this, *code).run();
+        return;
+    }
+    if(backend == EB_CLOSURE)
+    {
+        ClosureProgram::compile(*this, program->getMain())->run();
+        return;
+    }
+    if(backend == EB_AOT)
+    {
+        std::shared_ptr<AotModule> module = AotModule::compile(*this, program->getMain(), aot_options ? *aot_options : AotOptions());
+        if(module)
+        {
+            aot_modules.push_back(module);
+            module->run(*this);
+            return;
+        }
+        // Nothing has run yet, the program still runs without a working compiler
+        LogError("INTERPRETER: interpretProgram(): Could not compile the program ahead of time, running it on the tree walker");
+    }
 
-    auto const& body = ast->getBody();
+    auto const& body = program->getMain()->getBody();
+    fuseStatements(body);
     for(auto&& stm: body)
     {
         interpretPrimary(stm.get());
@@ -614,15 +1461,171 @@ void Interpreter::interpretMain()
     }
 }
 
-std::unique_ptr<Interpreter> Interpreter::create(std::unique_ptr<Parser> parser)
+///--- Reload ---///
+// Hashes are taken on the first reload, by then lazy bodies that ran have been filled in.
+// A program run with interpretProgram and never loaded here has nothing to match, reload runs all of the new one.
+void Interpreter::loadStatements(std::shared_ptr<Program> program)
+{
+    for(auto& stm: program->getMain()->getBody())
+        loaded_statements.push_back({stm.get(), program, 0, false, nullptr, 0, ""});
+}
+// A cache hit has no AST, the statements are hashed on the pool they ran from
+void Interpreter::loadPoolStatements()
+{
+    std::uint32_t body = pool->getFirst(pool->getRoot());
+    for(std::uint32_t i=0; i<pool->getListSize(body); ++i)
+        loaded_statements.push_back({nullptr, nullptr, 0, false, pool, pool->getListItem(body, i), ""});
+}
+void Interpreter::pinReplacedPrograms(std::vector<LoadedStatement> const& replaced)
+{
+    std::unordered_set<Arena*> sequence_arenas;
+    for(auto const& entry: memory)
+    {
+        if(entry.second.getType() != VT_SEQUENCE)
+            continue;
+        for(auto* call: entry.second.getSequence()->getValue())
+            sequence_arenas.insert(call->getArena());
+    }
+
+    std::unordered_set<Program*> live;
+    for(auto const& statement: loaded_statements)
+        live.insert(statement.program.get());
+
+    std::vector<std::shared_ptr<Program>> pinned;
+    auto pin = [&](std::shared_ptr<Program> const& program) {
+        if(!program || live.count(program.get()) || !sequence_arenas.count(program->getArena()))
+            return;
+        live.insert(program.get());
+        pinned.push_back(program);
+    };
+    for(auto const& statement: replaced)
+        pin(statement.program);
+    for(auto const& program: pinned_programs)
+        pin(program);
+    pinned_programs = std::move(pinned);
+}
+
+bool Interpreter::reload(std::string_view source)
+{
+    std::shared_ptr<Program> program = Parser::create(Lexer::borrow(source))->ParseProgram();
+    if(!program)
+    {
+        LogError("INTERPRETER: reload(): Could not parse the new source, the loaded program is kept");
+        return false;
+    }
+
+    // Loaded statements by hash, the earliest one at the back
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> loaded_by_hash;
+    for(std::size_t i=loaded_statements.size(); i-- > 0;)
+    {
+        auto& statement = loaded_statements[i];
+        if(!statement.hashed)
+        {
+            statement.hash = statement.ast ? hashStructure(statement.ast) : statement.pool->hashStructure(statement.node);
+            statement.hashed = true;
+        }
+        loaded_by_hash[statement.hash].push_back(i);
+    }
+
+    std::vector<bool> kept(loaded_statements.size(), false);
+    std::vector<LoadedStatement> next;
+    std::vector<ASTBase*> changed;
+    for(auto& stm: program->getMain()->getBody())
+    {
+        std::uint64_t hash = hashStructure(stm.get());
+        auto it = loaded_by_hash.find(hash);
+        if(it != loaded_by_hash.end() && !it->second.empty())
+        {
+            std::size_t index = it->second.back();
+            it->second.pop_back();
+            kept[index] = true;
+            next.push_back(loaded_statements[index]);
+            continue;
+        }
+
+        next.push_back({stm.get(), program, hash, true, nullptr, 0, ""});
+        changed.push_back(stm.get());
+    }
+
+    // Whatever a removed definition put in memory goes, so a changed one can define it again
+    std::vector<LoadedStatement> replaced;
+    for(std::size_t i=0; i<loaded_statements.size(); ++i)
+    {
+        if(kept[i])
+            continue;
+        auto const& statement = loaded_statements[i];
+        if(statement.ast && statement.ast->type == AST_VARDEF)
+            memory.erase(std::string(((VariableDefinitionAST*)statement.ast)->getName()));
+        else if(statement.pool && statement.pool->getKind(statement.node) == AST_VARDEF)
+            memory.erase(std::string(statement.pool->getString(statement.node)));
+        else if(!statement.definition.empty())
+            memory.erase(statement.definition);
+        replaced.push_back(std::move(loaded_statements[i]));
+    }
+
+    if(!replaced.empty())
+        ++memory_generation;
+    reload_stats = {next.size() - changed.size(), changed.size(), replaced.size()};
+    loaded_statements = std::move(next);
+    pinReplacedPrograms(replaced);
+    replaced.clear();
+
+    // Always on the tree walker, the current pool stays valid for sequences built from it
+    fuseStatements(program->getMain()->getBody());
+    success = true;
+    for(auto* stm: changed)
+    {
+        interpretPrimary(stm);
+        if(!success)
+        {
+            LogError("INTERPRETER: reload(): Stopping program execution");
+            break;
+        }
+    }
+    return true;
+}
+bool Interpreter::reloadFromFile(std::string const& path)
+{
+    auto source = SourceBuffer::map(path);
+    if(!source)
+        return false;
+    return reload(source->getText());
+}
+ReloadStats const& Interpreter::getReloadStats() const
+{
+    return reload_stats;
+}
+///--- Reload ---///
+
+std::unique_ptr<Interpreter> Interpreter::create(std::unique_ptr<Parser> parser, int backend)
 {
-    return std::make_unique<Interpreter>(std::move(parser));
+    return std::make_unique<Interpreter>(std::move(parser), backend);
 }
-std::unique_ptr<Interpreter> Interpreter::create(std::string const& in_text)
+std::unique_ptr<Interpreter> Interpreter::create(std::string const& in_text, int backend)
 {
     auto lexer = Lexer::create(in_text);
     auto parser = Parser::create(std::move(lexer));
-    return create(std::move(parser));
+    return create(std::move(parser), backend);
+}
+std::unique_ptr<Interpreter> Interpreter::borrow(std::string_view in_text, int backend)
+{
+    auto lexer = Lexer::borrow(in_text);
+    auto parser = Parser::create(std::move(lexer));
+    return create(std::move(parser), backend);
+}
+std::unique_ptr<Interpreter> Interpreter::createFromFile(std::string const& path, int backend)
+{
+    auto lexer = Lexer::createFromFile(path);
+    if(!lexer)
+        return nullptr;
+    auto parser = Parser::create(std::move(lexer));
+    return create(std::move(parser), backend);
+}
+std::unique_ptr<Interpreter> Interpreter::createFromStream(std::istream& in, int backend)
+{
+    auto lexer = Lexer::createFromStream(in);
+    auto parser = Parser::create(std::move(lexer));
+    return create(std::move(parser), backend);
 }
 ///--- Interpreter ---///
 }
\ No newline at end of file
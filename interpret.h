@@ -3,8 +3,13 @@
 #include "lex.h"
 #include "parse.h"
 #include "ast.h"
+#include "astpool.h"
+#include "progcache.h"
+#include "value.h"
 
 #include <map>
+#include <unordered_set>
+#include <unordered_map>
 #include <memory>
 #include <functional>
 #include <iostream>
@@ -28,6 +33,7 @@ class VariableNumberData;
 class VariableStringData;
 class VariableVoidData;
 class VariableSequenceData;
+class TierSequence;
 
 class VariableDataBase
 {
@@ -105,15 +111,24 @@ public:
 class VariableSequenceData: public VariableDataBase
 {
     std::vector<FunctionCallAST*> calls;
+    std::vector<std::uint32_t> pool_calls; // CALL rows of the interpreter's ASTPool
+    std::shared_ptr<TierSequence> tier; // Made by the tiered tree walker when it first runs the sequence, shared by copies
 public:
     VariableSequenceData(std::vector<FunctionCallAST*> value);
 
     std::vector<FunctionCallAST*> const& getValue() const;
     void setValue(std::vector<FunctionCallAST*> calls);
 
+    std::vector<std::uint32_t> const& getPoolCalls() const;
+    void setPoolCalls(std::vector<std::uint32_t> pool_calls);
+
+    std::shared_ptr<TierSequence> const& getTier() const;
+    void setTier(std::shared_ptr<TierSequence> tier);
+
     VariableDataBase* copy() const;
 
     static std::unique_ptr<VariableSequenceData> create(std::vector<FunctionCallAST*> value);
+    static std::unique_ptr<VariableSequenceData> createFromPool(std::vector<std::uint32_t> pool_calls);
 };
 ///--- Variable Data ---///
 
@@ -139,7 +154,9 @@ struct FCIImplementableFunctionArguments
 
 typedef std::unique_ptr<VariableDataBase> FCIType;
 typedef std::unordered_map<std::string, VariableDataBase*> FCIArguments;
-typedef std::function<std::unique_ptr<VariableDataBase>(FCIArguments)> FCIFunctionPtr;
+typedef std::function<std::unique_ptr<VariableDataBase>(FCIArguments const&)> FCIFunctionPtr;
+// Takes the arguments in call signature order. They may be the variables themselves, functions only read them.
+typedef std::function<Value(Value const* args)> FCIValueFunctionPtr;
 
 class FCIFunction
 {
@@ -147,11 +164,30 @@ class FCIFunction
     std::vector<std::pair<std::string, int>> call_signature;
 
     FCIFunctionPtr call_function;
+    FCIValueFunctionPtr value_function; // Used when there is no call_function, through an adapter from the other interface
+
+    // What callValues hands call_function, set up with the call signature. Numbers and void are passed in the
+    // boxes, a call made from inside the function while they are in use gets boxes of its own.
+    std::vector<VariableNumberData> number_boxes;
+    VariableVoidData void_box;
+    FCIArguments argument_map;
+    std::vector<VariableDataBase**> argument_entries; // Into argument_map, in call signature order
+    bool arguments_used;
+
+    std::unique_ptr<VariableDataBase> invoke(FCIArguments const& arguments);
 public:
     FCIFunction(int return_type, FCIFunctionPtr ptr, std::vector<std::pair<std::string, int>> call_signature);
+    FCIFunction(int return_type, FCIValueFunctionPtr ptr, std::vector<std::pair<std::string, int>> call_signature);
     void setFunctionCallPtr(FCIFunctionPtr ptr);
+    void setValueFunctionPtr(FCIValueFunctionPtr ptr);
     void setCallSignature(std::vector<std::pair<std::string, int>> const& call_sig);
+    int const getReturnType() const;
+    std::vector<std::pair<std::string, int>> const& getCallSignature() const;
     std::unique_ptr<VariableDataBase> call(std::unique_ptr<FCICallFunctionArguments> arguments);
+    // Skips the signature check, for callers that matched the arguments to it already
+    std::unique_ptr<VariableDataBase> callUnchecked(FCIArguments const& arguments);
+    // Same checks and messages as call(). A VariableDataBase function gets the arguments through the cached boxes.
+    Value callValues(Value const* arguments, std::size_t count);
 };
 
 class FCIFunctionLibraryBase
@@ -167,27 +203,133 @@ public:
     std::unordered_map<std::string, std::unique_ptr<FCIFunction>> moveLibrary();
 
     void useFunction(std::string const& name, FCIFunctionPtr ptr, FCIImplementableFunctionArguments const& args);
+    void useValueFunction(std::string const& name, FCIValueFunctionPtr ptr, FCIImplementableFunctionArguments const& args);
 };
 ///--- Function Call Interface ---///
 
 ///--- Interpreter ---///
+struct AotOptions;
+class AotModule;
+class TierManager;
+
+enum ExecutionBackend
+{
+    EB_TREE, // Walks the parsed AST
+    EB_POOL, // Walks an ASTPool built from it
+    EB_BYTECODE, // Compiles it to bytecode for the StackVM
+    EB_REGISTER, // Compiles it to register code for the RegisterVM
+    EB_CLOSURE, // Compiles every node to a closure with its operands and functions bound
+    EB_AOT, // Lowers it to C++ and loads the shared object AotOptions::compiler builds, runs on EB_TREE without one
+};
+
+struct ReloadStats
+{
+    std::size_t kept; // Top-level statements matched to a loaded one, they do not run again
+    std::size_t run;
+    std::size_t removed;
+};
+
 class Interpreter
 {
+    friend class StackVM;
+    friend class RegisterVM;
+    friend class ClosureProgram;
+    friend class JitRegion;
+    friend class AotRuntime;
+
+    // Either an AST, a node of a cached pool, or only the hash and defined name of a streamed statement
+    struct LoadedStatement
+    {
+        ASTBase* ast;
+        std::shared_ptr<Program> program;
+        std::uint64_t hash;
+        bool hashed;
+        std::shared_ptr<ASTPool> pool;
+        std::uint32_t node;
+        std::string definition;
+    };
+
     std::unique_ptr<Parser> parser;
-    std::unordered_map<std::string, std::unique_ptr<VariableDataBase>> memory;
+    int backend;
+    bool jit_enabled;
+    bool quickening_enabled;
+    bool superinstructions_enabled;
+    std::size_t superinstruction_count;
+    std::shared_ptr<ASTPool> pool;
+    std::vector<Value*> pool_slots; // Variables by the pool's string ids, nullptr until one is looked up
+    std::uint64_t pool_slots_generation; // Of the memory when pool_slots were filled
+    ProgramCache* program_cache;
+    ProgramMemoryCache* memory_cache;
+    std::unordered_map<std::string, Value> memory; // Values own their objects
+    std::uint64_t memory_generation; // Bumped when variables are removed, pointers into memory stay valid until then
     std::unordered_map<std::string, std::unique_ptr<FCIFunction>> functions;
-
-    std::unique_ptr<VariableDataBase> useBinaryOperation(Token* op, VariableDataBase* lhs, VariableDataBase* rhs);
+    std::vector<Value> call_arguments; // Stack of the arguments of the calls the tree walker is evaluating
+    std::vector<LoadedStatement> loaded_statements;
+    std::vector<std::shared_ptr<Program>> pinned_programs; // Replaced programs that sequence variables still point into
+    ReloadStats reload_stats;
+    std::shared_ptr<AotOptions> aot_options;
+    std::vector<std::shared_ptr<AotModule>> aot_modules; // Loaded by EB_AOT, kept for the sequence values they made
+
+    Value useBinaryOperation(int op, Value const& lhs, Value const& rhs);
+    std::unique_ptr<VariableDataBase> useBinaryOperation(int op, VariableDataBase* lhs, VariableDataBase* rhs);
+    void recordBinaryOperation(BinaryOperationAST* const ast, int lhs_type, int rhs_type);
+    void fuseStatements(ASTList<ASTBase> const& body);
+    VariableDataBase* const interpretShorthandNumber(VariableAssignmentAST* const ast);
+    VariableDataBase* const interpretDefineCall(VariableDefinitionAST* const ast);
+    bool const interpretIfEquals(IfAST* const ast, bool& condition);
+    void interpretStream();
+    void interpretCached();
+    void interpretPoolMain();
+    void loadPoolStatements();
+    void pinReplacedPrograms(std::vector<LoadedStatement> const& replaced);
+    ASTList<ASTBase> parseLazyBody(Arena* const arena, LazyBody const& body, std::string const& name);
+    VariableDataBase* const assignVariable(std::string const& name, Value val, int shorthand_operator);
+    VariableDataBase* const assignVariable(Value& variable, std::string_view name, Value val, int shorthand_operator);
+    Value* const lookupPoolVariable(std::uint32_t node);
+    VariableDataBase* const assignVariable(std::string const& name, std::unique_ptr<VariableDataBase> val, int shorthand_operator);
     bool success;
+    std::unique_ptr<TierManager> tiers; // Last, so its background compiles finish before the members they read go
 public:
-    Interpreter(std::unique_ptr<Parser> parser);
+    Interpreter(std::unique_ptr<Parser> parser, int backend = EB_TREE);
+    ~Interpreter();
+
+    Parser* const getParser() const;
+
+    int const getBackend() const;
+    void setBackend(int backend);
+    // Whether EB_CLOSURE compiles number-only statements to native code, where JitModule::isSupported()
+    bool const isJitEnabled() const;
+    void setJitEnabled(bool enabled);
+    // Whether the tree walker quickens binary operation sites to the operand types they keep seeing
+    bool const isQuickeningEnabled() const;
+    void setQuickeningEnabled(bool enabled);
+    // Whether the tree walker runs the statement shapes selectSuperinstructions marks in their fused forms
+    bool const isSuperinstructionsEnabled() const;
+    void setSuperinstructionsEnabled(bool enabled);
+    std::size_t const getSuperinstructionCount() const; // Statements fused so far
+    // Whether the tree walker compiles hot do-for sequences to closures in the background and moves loops onto them
+    bool const isTieringEnabled() const;
+    void setTieringEnabled(bool enabled);
+    TierManager* const getTierManager() const; // nullptr while tiering is disabled
+    // Used by EB_AOT, nullptr for the defaults
+    std::shared_ptr<AotOptions> const& getAotOptions() const;
+    void setAotOptions(std::shared_ptr<AotOptions> options);
+    std::size_t const getAotModuleCount() const; // Programs EB_AOT ran compiled, the others fell back to the tree walker
+    // Non-streaming programs are then mapped from the cache, or parsed and stored on a miss, and run on the pool.
+    // Only used by EB_POOL, the other backends log and run without it.
+    ProgramCache* const getProgramCache() const;
+    void setProgramCache(ProgramCache* cache);
+    // Looked up before the ProgramCache, a hit shares the pool with the other Interpreters using the cache
+    ProgramMemoryCache* const getProgramMemoryCache() const;
+    void setProgramMemoryCache(ProgramMemoryCache* cache);
 
     VariableDataBase* LogError(std::string const& str);
     std::unique_ptr<VariableDataBase> LogErrorU(std::string const& str);
+    Value LogErrorV(std::string const& str);
 
     void defineVariable(std::string const& name, std::unique_ptr<VariableDataBase> data = nullptr);
     bool isVariableDefined(std::string const& name);
-    VariableDataBase* const getVariableValue(std::string const& name);
+    Value const& getVariableValue(std::string const& name);
     void replaceVariableValue(std::string const& name, std::unique_ptr<VariableDataBase> new_value);
     void changeVariableNumberValue(std::string const& name, double new_value);
     void changeVariableStringValue(std::string const& name, std::string const& new_value);
@@ -197,28 +339,46 @@ public:
     FCIType callFunction(std::string const& name, std::unique_ptr<FCICallFunctionArguments> args);
 
     VariableDataBase* const interpretPrimary(ASTBase* const ast);
-    std::unique_ptr<VariableDataBase> interpretExpression(ASTBase* const ast);
+    Value interpretExpression(ASTBase* const ast);
 
-    VariableDataBase* const interpretVariable(VariableAST* const ast);
+    Value* const interpretVariable(VariableAST* const ast);
     VariableDataBase* const interpretVariableDefinition(VariableDefinitionAST* const ast);
     VariableDataBase* const interpretVariableAssignment(VariableAssignmentAST* const ast);
     
-    std::unique_ptr<VariableNumberData> interpretNumber(NumberAST* const ast);
-    std::unique_ptr<VariableStringData> interpretString(StringAST* const ast);
+    Value interpretNumber(NumberAST* const ast);
+    Value interpretString(StringAST* const ast);
 
     std::unique_ptr<VariableSequenceData> interpretSequence(SequenceAST* const ast);
     VariableDataBase* const interpretDoFor(DoForAST* const ast);
     // VariableDataBase* const interpretDoThrough(DoThroughAST* const ast);
 
-    std::unique_ptr<VariableDataBase> interpretFunctionCall(FunctionCallAST* const ast);
+    Value interpretFunctionCall(FunctionCallAST* const ast);
     void interpretExtern(ExternAST* const ast);
 
-    std::unique_ptr<VariableDataBase> interpretBinaryOperation(BinaryOperationAST* const ast);
+    Value interpretBinaryOperation(BinaryOperationAST* const ast);
 
     bool interpretIf(IfAST* const ast);
     VariableDataBase* interpretIfElse(IfElseAST* const ast);
 
+    VariableDataBase* const interpretPoolPrimary(std::uint32_t node);
+    Value interpretPoolExpression(std::uint32_t node);
+    std::unique_ptr<VariableSequenceData> interpretPoolSequence(std::uint32_t node);
+    VariableDataBase* const interpretPoolDoFor(std::uint32_t node);
+    Value interpretPoolFunctionCall(std::uint32_t node);
+    bool interpretPoolIf(std::uint32_t node);
+    VariableDataBase* interpretPoolIfElse(std::uint32_t node);
+
     void interpretMain();
+    void interpretProgram(Program* const program);
+    // Records the top-level statements of a program run with interpretProgram, so reload can match against them
+    void loadStatements(std::shared_ptr<Program> program);
+
+    // Re-parses the program and runs only the top-level statements that are not structurally identical to one
+    // already loaded by interpretMain, loadStatements or an earlier reload. Variables defined by removed or changed statements
+    // are dropped before the new ones run, all other variables and the registered libraries are kept.
+    bool reload(std::string_view source);
+    bool reloadFromFile(std::string const& path);
+    ReloadStats const& getReloadStats() const;
 
     template <typename T>
     void registerFunctionLibrary()
@@ -244,8 +404,11 @@ public:
         delete libt;
     }
 
-    static std::unique_ptr<Interpreter> create(std::unique_ptr<Parser> parser);
-    static std::unique_ptr<Interpreter> create(std::string const& in_text);
+    static std::unique_ptr<Interpreter> create(std::unique_ptr<Parser> parser, int backend = EB_TREE);
+    static std::unique_ptr<Interpreter> create(std::string const& in_text, int backend = EB_TREE);
+    static std::unique_ptr<Interpreter> borrow(std::string_view in_text, int backend = EB_TREE);
+    static std::unique_ptr<Interpreter> createFromFile(std::string const& path, int backend = EB_TREE);
+    static std::unique_ptr<Interpreter> createFromStream(std::istream& in, int backend = EB_TREE);
 };
 ///--- Interpreter ---///
 
@@ -0,0 +1,561 @@
+#include "jit.h"
+#include "interpret.h"
+
+#include <cmath>
+#include <cstring>
+
+#ifdef XEOUZ_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace xeouz
+{
+
+namespace
+{
+
+// Called from compiled code for every FCI call, `args` points at the call's window in the frame
+double jitCall(JitCallSite* site, double const* args)
+{
+    for(std::uint32_t i=0; i<site->argc; ++i)
+        site->arguments[i] = Value::createNumber(args[i]);
+    Value result = site->function->callValues(site->arguments.data(), site->argc);
+
+    if(!site->value)
+        return 0;
+    if(result.isNumber())
+        return result.getNumber();
+
+    *site->failed = site;
+    return NAN;
+}
+
+bool const isNumberOperator(int op)
+{
+    switch(op)
+    {
+        default: return false;
+        case T_ADD: case T_SUB: case T_MUL: case T_DIV: case T_MOD:
+        case T_DEQUAL: case T_NOTEQ: case T_LARROW: case T_RARROW: case T_LESSEQ: case T_MOREEQ: return true;
+    }
+}
+
+}
+
+///--- JIT ---///
+JitRegion::JitRegion(Interpreter& _interpreter): interpreter(_interpreter), frame_size(0), offset(0), entry(nullptr), failed(nullptr)
+{
+
+}
+
+bool JitRegion::run()
+{
+    if(!entry)
+        return false;
+
+    frame.assign(frame_size, 0);
+    for(auto const& var: variables)
+    {
+        // Something other than the program may have defined it since the slot was last resolved
+        if(!*var.slot)
+        {
+            auto it = interpreter.memory.find(var.name);
+            if(it != interpreter.memory.end())
+                *var.slot = &it->second;
+        }
+        if(var.defined)
+        {
+            if(*var.slot)
+                return false;
+            continue;
+        }
+        if(!*var.slot || !(*var.slot)->isNumber())
+            return false;
+        frame[var.index] = (*var.slot)->getNumber();
+    }
+
+    failed = nullptr;
+    entry(frame.data());
+
+    for(auto const& var: variables)
+    {
+        if(var.defined)
+        {
+            if(failed && var.statement >= failed->statement)
+                continue;
+            *var.slot = &interpreter.memory.emplace(var.name, Value::createNumber(frame[var.index])).first->second;
+        }
+        else
+            **var.slot = Value::createNumber(frame[var.index]);
+    }
+
+    if(failed)
+    {
+        interpreter.LogError(std::string("INTERPRETER: interpretFunctionCall(): Function `")+failed->name+"` is declared to return a number but did not");
+        interpreter.success = false;
+    }
+    return true;
+}
+
+JitModule::JitModule(Interpreter& _interpreter): interpreter(_interpreter), memory(nullptr), memory_size(0), region(nullptr), depth(0), statement(0)
+{
+
+}
+JitModule::~JitModule()
+{
+#ifdef XEOUZ_JIT
+    if(memory)
+        munmap(memory, memory_size);
+#endif
+}
+
+// Whether a statement can be compiled is decided before anything is emitted for it. Variables it reads that
+// the region has not defined are collected in `reads`, they become the region's inputs.
+bool const JitModule::checkRead(std::string_view name, std::vector<std::string_view>& reads) const
+{
+    if(!defined.count(name))
+        reads.push_back(name);
+    return true;
+}
+bool const JitModule::checkExpression(ASTBase* ast, std::vector<std::string_view>& reads) const
+{
+    switch(ast->type)
+    {
+        default: return false;
+        case AST_NUMBER: return true;
+        case AST_VAR: return checkRead(((VariableAST*)ast)->getName(), reads);
+        case AST_CALL: return checkCall((FunctionCallAST*)ast, true, reads);
+        case AST_BINOP: {
+            auto* binop = (BinaryOperationAST*)ast;
+            return isNumberOperator(binop->getOperator()) && checkExpression(binop->getLHS(), reads) && checkExpression(binop->getRHS(), reads);
+        }
+    }
+}
+// A call whose result is used has to be declared to return a number and take numbers, anything else would have
+// the interpreter log in the middle of the statement. A call as a statement logs through the FCI like it would.
+bool const JitModule::checkCall(FunctionCallAST* ast, bool value, std::vector<std::string_view>& reads) const
+{
+    std::string name(ast->getName());
+    if(!interpreter.isFunctionDefined(name))
+        return false;
+
+    auto const& args = ast->getArguments();
+    if(value)
+    {
+        auto* function = interpreter.getFunction(name);
+        auto const& signature = function->getCallSignature();
+        if(function->getReturnType() != VT_NUMBER || signature.size() != args.size())
+            return false;
+        for(auto const& param: signature)
+            if(param.second != VT_NUMBER && param.second != VT_ANY)
+                return false;
+    }
+
+    for(auto&& arg: args)
+        if(!checkExpression(arg.get(), reads))
+            return false;
+    return true;
+}
+// Definitions only at the top of the region, so every later statement runs after them
+bool const JitModule::checkStatement(ASTBase* ast, bool top, std::vector<std::string_view>& reads) const
+{
+    switch(ast->type)
+    {
+        default: return false;
+        case AST_VARDEF: {
+            auto* def = (VariableDefinitionAST*)ast;
+            std::vector<std::string_view> value_reads;
+            if(!top || !checkExpression(def->getValue(), value_reads))
+                return false;
+
+            auto name = def->getName();
+            if(defined.count(name) || inputs.count(name))
+                return false;
+            for(auto read: value_reads)
+                if(read == name)
+                    return false;
+            reads.insert(reads.end(), value_reads.begin(), value_reads.end());
+            return true;
+        }
+        case AST_VARASSIGN: {
+            auto* assign = (VariableAssignmentAST*)ast;
+            int op = assign->getShorthandOperator();
+            if(op != T_EOF && !isNumberOperator(op))
+                return false;
+            return checkExpression(assign->getValue(), reads) && checkRead(assign->getName(), reads);
+        }
+        case AST_CALL: return checkCall((FunctionCallAST*)ast, false, reads);
+        case AST_IFELSE: {
+            auto* ifelse = (IfElseAST*)ast;
+            if(ifelse->getLazyElseBody().isPending())
+                return false;
+            for(auto&& ifstm: ifelse->getIfStatements())
+            {
+                if(ifstm->getLazyBody().isPending() || !checkExpression(ifstm->getExpression(), reads))
+                    return false;
+                for(auto&& stm: ifstm->getBody())
+                    if(!checkStatement(stm.get(), false, reads))
+                        return false;
+            }
+            for(auto&& stm: ifelse->getElseBody())
+                if(!checkStatement(stm.get(), false, reads))
+                    return false;
+            return true;
+        }
+        case AST_DOFOR: {
+            auto* dofor = (DoForAST*)ast;
+            if(!checkExpression(dofor->getForTimes(), reads))
+                return false;
+            for(auto&& seq: dofor->getSequences())
+            {
+                if(seq->type != AST_SEQUENCE)
+                    return false;
+                for(auto&& call: ((SequenceAST*)seq.get())->getBody())
+                    if(!checkCall(call.get(), false, reads))
+                        return false;
+            }
+            return true;
+        }
+    }
+}
+
+std::uint32_t const JitModule::variableIndex(std::string_view name, bool define)
+{
+    auto it = variable_ids.find(name);
+    if(it != variable_ids.end())
+        return it->second;
+
+    std::uint32_t index = allocate(1);
+    variable_ids.emplace(name, index);
+    region->variables.push_back({std::string(name), index, define, statement, nullptr});
+    if(define)
+        defined.insert(name);
+    return index;
+}
+std::uint32_t const JitModule::allocate(std::uint32_t count)
+{
+    std::uint32_t index = region->frame_size;
+    region->frame_size += count;
+    return index;
+}
+
+void JitModule::emit(std::initializer_list<std::uint8_t> bytes)
+{
+    code.insert(code.end(), bytes);
+}
+void JitModule::emit32(std::uint32_t value)
+{
+    for(int i=0; i<4; ++i)
+        code.push_back(value >> (i * 8));
+}
+void JitModule::emit64(std::uint64_t value)
+{
+    for(int i=0; i<8; ++i)
+        code.push_back(value >> (i * 8));
+}
+// movsd xmm, [rbx + index*8]
+void JitModule::emitLoad(int xmm, std::uint32_t index)
+{
+    emit({0xF2, 0x0F, 0x10, (std::uint8_t)(0x83 | xmm << 3)});
+    emit32(index * 8);
+}
+// movsd [rbx + index*8], xmm0
+void JitModule::emitStore(std::uint32_t index)
+{
+    emit({0xF2, 0x0F, 0x11, 0x83});
+    emit32(index * 8);
+}
+// mov rax, imm64; movq xmm, rax
+void JitModule::emitNumber(int xmm, double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    emit({0x48, 0xB8});
+    emit64(bits);
+    emit({0x66, 0x48, 0x0F, 0x6E, (std::uint8_t)(0xC0 | xmm << 3)});
+}
+// Returns where the rel32 to patch is
+std::size_t const JitModule::emitJump(std::initializer_list<std::uint8_t> opcode)
+{
+    emit(opcode);
+    std::size_t at = code.size();
+    emit32(0);
+    return at;
+}
+void JitModule::emitJumpTo(std::initializer_list<std::uint8_t> opcode, std::size_t target)
+{
+    emit(opcode);
+    emit32(target - (code.size() + 4));
+}
+void JitModule::patch(std::size_t jump)
+{
+    std::uint32_t rel = code.size() - (jump + 4);
+    std::memcpy(&code[jump], &rel, sizeof(rel));
+}
+
+// xmm0 = xmm0 op xmm1, the same results as Interpreter::useBinaryOperation on two numbers
+void JitModule::emitOperator(int op)
+{
+    switch(op)
+    {
+        case T_ADD: emit({0xF2, 0x0F, 0x58, 0xC1}); return; // addsd xmm0, xmm1
+        case T_SUB: emit({0xF2, 0x0F, 0x5C, 0xC1}); return; // subsd xmm0, xmm1
+        case T_MUL: emit({0xF2, 0x0F, 0x59, 0xC1}); return; // mulsd xmm0, xmm1
+        case T_DIV: emit({0xF2, 0x0F, 0x5E, 0xC1}); return; // divsd xmm0, xmm1
+        case T_MOD: {
+            emit({0xF2, 0x48, 0x0F, 0x2C, 0xC0}); // cvttsd2si rax, xmm0
+            emit({0xF2, 0x48, 0x0F, 0x2C, 0xC9}); // cvttsd2si rcx, xmm1
+            emit({0x48, 0x99}); // cqo
+            emit({0x48, 0xF7, 0xF9}); // idiv rcx
+            emit({0xF2, 0x48, 0x0F, 0x2A, 0xC2}); // cvtsi2sd xmm0, rdx
+            return;
+        }
+    }
+
+    // Comparisons set al, unordered operands compare like they do in C++
+    switch(op)
+    {
+        case T_DEQUAL: emit({0x66, 0x0F, 0x2E, 0xC1, 0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8}); break; // ucomisd xmm0, xmm1; sete al; setnp cl; and al, cl
+        case T_NOTEQ: emit({0x66, 0x0F, 0x2E, 0xC1, 0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8}); break; // ucomisd xmm0, xmm1; setne al; setp cl; or al, cl
+        case T_RARROW: emit({0x66, 0x0F, 0x2E, 0xC1, 0x0F, 0x97, 0xC0}); break; // ucomisd xmm0, xmm1; seta al
+        case T_MOREEQ: emit({0x66, 0x0F, 0x2E, 0xC1, 0x0F, 0x93, 0xC0}); break; // ucomisd xmm0, xmm1; setae al
+        case T_LARROW: emit({0x66, 0x0F, 0x2E, 0xC8, 0x0F, 0x97, 0xC0}); break; // ucomisd xmm1, xmm0; seta al
+        case T_LESSEQ: emit({0x66, 0x0F, 0x2E, 0xC8, 0x0F, 0x93, 0xC0}); break; // ucomisd xmm1, xmm0; setae al
+    }
+    emit({0x0F, 0xB6, 0xC0}); // movzx eax, al
+    emit({0xF2, 0x0F, 0x2A, 0xC0}); // cvtsi2sd xmm0, eax
+}
+// Into xmm0. A right operand that is not a leaf is evaluated with the left one saved on the machine stack.
+void JitModule::emitExpression(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        case AST_NUMBER: emitNumber(0, ((NumberAST*)ast)->getValue()); return;
+        case AST_VAR: emitLoad(0, variableIndex(((VariableAST*)ast)->getName(), false)); return;
+        case AST_CALL: emitCall((FunctionCallAST*)ast, true); return;
+    }
+
+    auto* binop = (BinaryOperationAST*)ast;
+    auto* rhs = binop->getRHS();
+    emitExpression(binop->getLHS());
+    if(rhs->type == AST_NUMBER)
+        emitNumber(1, ((NumberAST*)rhs)->getValue());
+    else if(rhs->type == AST_VAR)
+        emitLoad(1, variableIndex(((VariableAST*)rhs)->getName(), false));
+    else
+    {
+        emit({0x48, 0x83, 0xEC, 0x08, 0xF2, 0x0F, 0x11, 0x04, 0x24}); // sub rsp, 8; movsd [rsp], xmm0
+        ++depth;
+        emitExpression(rhs);
+        emit({0xF2, 0x0F, 0x10, 0xC8}); // movsd xmm1, xmm0
+        emit({0xF2, 0x0F, 0x10, 0x04, 0x24, 0x48, 0x83, 0xC4, 0x08}); // movsd xmm0, [rsp]; add rsp, 8
+        --depth;
+    }
+    emitOperator(binop->getOperator());
+}
+// Arguments are stored to a window of the frame only this call uses, the result is left in xmm0
+void JitModule::emitCall(FunctionCallAST* ast, bool value)
+{
+    auto const& args = ast->getArguments();
+    std::string name(ast->getName());
+    auto* function = interpreter.getFunction(name);
+    region->calls.push_back(std::make_unique<JitCallSite>(JitCallSite{function, name, (std::uint32_t)args.size(), value, statement, &region->failed, std::vector<Value>(args.size())}));
+    auto* site = region->calls.back().get();
+
+    std::uint32_t window = allocate(args.size());
+    for(std::size_t i=0; i<args.size(); ++i)
+    {
+        emitExpression(args[i].get());
+        emitStore(window + i);
+    }
+
+    // The stack is 16-byte aligned with no doubles pushed
+    bool pad = depth % 2;
+    if(pad)
+        emit({0x48, 0x83, 0xEC, 0x08}); // sub rsp, 8
+    emit({0x48, 0xBF}); // mov rdi, site
+    emit64((std::uint64_t)site);
+    emit({0x48, 0x8D, 0xB3}); // lea rsi, [rbx + window*8]
+    emit32(window * 8);
+    emit({0x48, 0xB8}); // mov rax, jitCall
+    emit64((std::uint64_t)&jitCall);
+    emit({0xFF, 0xD0}); // call rax
+    if(pad)
+        emit({0x48, 0x83, 0xC4, 0x08}); // add rsp, 8
+    if(!value)
+        return;
+
+    // A result that is not a number returns from the region, dropping the doubles pushed so far
+    emit({0x48, 0xB8}); // mov rax, &region->failed
+    emit64((std::uint64_t)&region->failed);
+    emit({0x48, 0x83, 0x38, 0x00}); // cmp qword [rax], 0
+    emit({0x74, (std::uint8_t)(depth ? 9 : 2)}); // je past the return
+    if(depth)
+    {
+        emit({0x48, 0x81, 0xC4}); // add rsp, depth*8
+        emit32(depth * 8);
+    }
+    emit({0x5B, 0xC3}); // pop rbx; ret
+}
+void JitModule::emitStatement(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        case AST_VARDEF: {
+            auto* def = (VariableDefinitionAST*)ast;
+            emitExpression(def->getValue());
+            emitStore(variableIndex(def->getName(), true));
+            break;
+        }
+        case AST_VARASSIGN: {
+            auto* assign = (VariableAssignmentAST*)ast;
+            std::uint32_t index = variableIndex(assign->getName(), false);
+            emitExpression(assign->getValue());
+            if(assign->getShorthandOperator() != T_EOF)
+            {
+                emit({0xF2, 0x0F, 0x10, 0xC8}); // movsd xmm1, xmm0
+                emitLoad(0, index);
+                emitOperator(assign->getShorthandOperator());
+            }
+            emitStore(index);
+            break;
+        }
+        case AST_CALL: emitCall((FunctionCallAST*)ast, false); break;
+        case AST_IFELSE: {
+            auto* ifelse = (IfElseAST*)ast;
+            std::vector<std::size_t> ends;
+            for(auto&& ifstm: ifelse->getIfStatements())
+            {
+                emitExpression(ifstm->getExpression());
+                emit({0x66, 0x0F, 0x57, 0xC9, 0x66, 0x0F, 0x2E, 0xC1}); // xorpd xmm1, xmm1; ucomisd xmm0, xmm1
+                std::size_t next = emitJump({0x0F, 0x86}); // jbe, also taken for NaN
+                for(auto&& stm: ifstm->getBody())
+                    emitStatement(stm.get());
+                ends.push_back(emitJump({0xE9}));
+                patch(next);
+            }
+            for(auto&& stm: ifelse->getElseBody())
+                emitStatement(stm.get());
+            for(auto end: ends)
+                patch(end);
+            break;
+        }
+        case AST_DOFOR: {
+            // Like the interpreter's `for(int i=0; i<times; ++i)`, times and i are kept in two frame slots
+            auto* dofor = (DoForAST*)ast;
+            emitExpression(dofor->getForTimes());
+            std::uint32_t times = allocate(2);
+            emitStore(times);
+            emit({0xC7, 0x83}); // mov dword [rbx + i], 0
+            emit32((times + 1) * 8);
+            emit32(0);
+
+            std::size_t top = code.size();
+            emit({0xF2, 0x0F, 0x2A, 0x83}); // cvtsi2sd xmm0, dword [rbx + i]
+            emit32((times + 1) * 8);
+            emitLoad(1, times);
+            emit({0x66, 0x0F, 0x2E, 0xC8}); // ucomisd xmm1, xmm0
+            std::size_t end = emitJump({0x0F, 0x86}); // jbe
+            for(auto&& seq: dofor->getSequences())
+                for(auto&& call: ((SequenceAST*)seq.get())->getBody())
+                    emitCall(call.get(), false);
+            emit({0x83, 0x83}); // add dword [rbx + i], 1
+            emit32((times + 1) * 8);
+            emit({0x01});
+            emitJumpTo({0xE9}, top);
+            patch(end);
+            break;
+        }
+    }
+}
+
+JitRegion* const JitModule::compile(ASTList<ASTBase> const& statements, std::size_t begin, std::size_t& end)
+{
+#ifndef XEOUZ_JIT
+    return nullptr;
+#else
+    if(memory)
+        return nullptr;
+
+    auto compiled = std::make_unique<JitRegion>(interpreter);
+    region = compiled.get();
+    variable_ids.clear();
+    inputs.clear();
+    defined.clear();
+    depth = 0;
+    statement = 0;
+
+    std::size_t start = code.size();
+    emit({0x53, 0x48, 0x89, 0xFB}); // push rbx; mov rbx, rdi
+
+    std::size_t i = begin;
+    for(; i<statements.size(); ++i)
+    {
+        std::vector<std::string_view> reads;
+        if(!checkStatement(statements[i].get(), true, reads))
+            break;
+        inputs.insert(reads.begin(), reads.end());
+        statement = i - begin;
+        emitStatement(statements[i].get());
+    }
+
+    region = nullptr;
+    if(i == begin)
+    {
+        code.resize(start);
+        return nullptr;
+    }
+
+    emit({0x5B, 0xC3}); // pop rbx; ret
+    compiled->offset = start;
+    end = i;
+    regions.push_back(std::move(compiled));
+    return regions.back().get();
+#endif
+}
+bool JitModule::finalize()
+{
+#ifndef XEOUZ_JIT
+    return false;
+#else
+    if(memory || regions.empty())
+        return false;
+
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    std::size_t size = (code.size() + page - 1) / page * page;
+    void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mapped == MAP_FAILED)
+    {
+        std::cout << "JIT: finalize(): Could not map memory for the compiled code" << std::endl;
+        return false;
+    }
+    std::memcpy(mapped, code.data(), code.size());
+    if(mprotect(mapped, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        std::cout << "JIT: finalize(): Could not make the compiled code executable" << std::endl;
+        munmap(mapped, size);
+        return false;
+    }
+
+    memory = mapped;
+    memory_size = size;
+    for(auto& compiled: regions)
+        compiled->entry = (void (*)(double*))((std::uint8_t*)mapped + compiled->offset);
+    code.clear();
+    code.shrink_to_fit();
+    return true;
+#endif
+}
+
+bool const JitModule::isSupported()
+{
+#ifdef XEOUZ_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+///--- JIT ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.h"
+#include "value.h"
+
+// Native code is only emitted for Linux x86-64, define XEOUZ_NO_JIT to leave it out there too
+#if defined(__x86_64__) && defined(__linux__) && !defined(XEOUZ_NO_JIT)
+#define XEOUZ_JIT 1
+#endif
+
+namespace xeouz
+{
+
+class Interpreter;
+class FCIFunction;
+class VariableDataBase;
+
+///--- JIT ---///
+struct JitCallSite
+{
+    FCIFunction* function;
+    std::string name;
+    std::uint32_t argc;
+    bool value; // The result is used, the function is declared to return a number
+    std::uint32_t statement; // Of the region the call is in
+    JitCallSite** failed; // The region's, set to this call when its result is not a number
+    std::vector<Value> arguments; // Reused by every call
+};
+
+// A run of number-only statements compiled to x86-64. The code works on a frame of doubles, variables are
+// copied into it through the slots they are bound to when the region starts and back when it ends.
+class JitRegion
+{
+    friend class JitModule;
+
+    struct Variable
+    {
+        std::string name;
+        std::uint32_t index;
+        bool defined; // By the region, it has to be undefined before
+        std::uint32_t statement; // Defining it
+        Value** slot; // Into the interpreter's memory, looked up while it is nullptr
+    };
+
+    Interpreter& interpreter;
+    std::vector<Variable> variables;
+    std::vector<std::unique_ptr<JitCallSite>> calls;
+    std::vector<double> frame;
+    std::uint32_t frame_size;
+    std::size_t offset;
+    void (*entry)(double* frame);
+    JitCallSite* failed; // The code returns right after a call sets it, the statement it is in does not finish
+public:
+    JitRegion(Interpreter& interpreter);
+
+    // Gives every variable the slot `slot_of` returns for its name, the slot is kept up to date by run()
+    template <typename SlotOf>
+    void bindVariables(SlotOf slot_of)
+    {
+        for(auto& var: variables)
+            var.slot = slot_of(var.name);
+    }
+    // False without running anything when a variable it reads is not a number or one it defines already is. A
+    // failed call ends the program like a failed statement of the tree walker does.
+    bool run();
+};
+
+class JitModule
+{
+    Interpreter& interpreter;
+    std::vector<std::uint8_t> code;
+    std::vector<std::unique_ptr<JitRegion>> regions;
+    void* memory;
+    std::size_t memory_size;
+
+    // Filled while compiling a region
+    JitRegion* region;
+    std::unordered_map<std::string_view, std::uint32_t> variable_ids;
+    std::unordered_set<std::string_view> inputs;
+    std::unordered_set<std::string_view> defined;
+    std::uint32_t depth; // Doubles pushed on the machine stack
+    std::uint32_t statement; // Of the region, counted from its first one
+
+    bool const checkRead(std::string_view name, std::vector<std::string_view>& reads) const;
+    bool const checkExpression(ASTBase* ast, std::vector<std::string_view>& reads) const;
+    bool const checkCall(FunctionCallAST* ast, bool value, std::vector<std::string_view>& reads) const;
+    bool const checkStatement(ASTBase* ast, bool top, std::vector<std::string_view>& reads) const;
+
+    std::uint32_t const variableIndex(std::string_view name, bool define);
+    std::uint32_t const allocate(std::uint32_t count);
+
+    void emit(std::initializer_list<std::uint8_t> bytes);
+    void emit32(std::uint32_t value);
+    void emit64(std::uint64_t value);
+    void emitLoad(int xmm, std::uint32_t index);
+    void emitStore(std::uint32_t index);
+    void emitNumber(int xmm, double value);
+    std::size_t const emitJump(std::initializer_list<std::uint8_t> opcode);
+    void emitJumpTo(std::initializer_list<std::uint8_t> opcode, std::size_t target);
+    void patch(std::size_t jump);
+
+    void emitOperator(int op);
+    void emitExpression(ASTBase* ast);
+    void emitCall(FunctionCallAST* ast, bool value);
+    void emitStatement(ASTBase* ast);
+public:
+    JitModule(Interpreter& interpreter);
+    ~JitModule();
+
+    // Compiles the longest run of number-only statements starting at `begin`, `end` is set past it. Returns
+    // nullptr when statements[begin] does not qualify. Regions can only run after finalize().
+    JitRegion* const compile(ASTList<ASTBase> const& statements, std::size_t begin, std::size_t& end);
+    // Maps the code of all regions executable
+    bool finalize();
+
+    static bool const isSupported();
+};
+///--- JIT ---///
+
+}
\ No newline at end of file
@@ -14,9 +14,13 @@
     #define CREATE_SEQUENCE(value) xeouz:VariableSequenceData::create(value)
     #define FUNCTION static xeouz::FCIType
     #define ARGUMENTS xeouz::FCIArguments
+    #define VALUE_FUNCTION static xeouz::Value
+    #define VALUE_ARGUMENTS xeouz::Value const*
+    #define NUMBER_VALUE(value) xeouz::Value::createNumber(value)
 
     #define LIBRARY_END()       }
     #define ADD_FUNCTION(funcname, ...)  useFunction(#funcname, &funcname, {.args = {__VA_ARGS__ }
+    #define ADD_VALUE_FUNCTION(funcname, ...)  useValueFunction(#funcname, &funcname, {.args = {__VA_ARGS__ }
 
     #define RETURNS(type) ,.ret_type = type}); 
     #define LIBRARY_BEGIN(libname)      \
@@ -36,73 +40,73 @@ class Syslib: public FCIFunctionLibraryBase
 public:
     Syslib(): FCIFunctionLibraryBase("sys")
     {
-        useFunction("print", &Syslib::printFunction, {.args = {{"val", VT_ANY}}, .ret_type = VT_VOID});
-        useFunction("toNumber", &Syslib::toNumberFunction, {.args = {{"val", VT_ANY}}, .ret_type = VT_NUMBER});
-        useFunction("toString", &Syslib::toStringFunction, {.args = {{"val", VT_ANY}}, .ret_type = VT_STRING});
+        useValueFunction("print", &Syslib::printFunction, {.args = {{"val", VT_ANY}}, .ret_type = VT_VOID});
+        useValueFunction("toNumber", &Syslib::toNumberFunction, {.args = {{"val", VT_ANY}}, .ret_type = VT_NUMBER});
+        useValueFunction("toString", &Syslib::toStringFunction, {.args = {{"val", VT_ANY}}, .ret_type = VT_STRING});
     }
 
-    static FCIType printFunction(FCIArguments args)
+    static Value printFunction(Value const* args)
     {
-        auto* val = args.at("val");
-        if(val->getType() == VT_NUMBER)
+        auto const& val = args[0];
+        if(val.getType() == VT_NUMBER)
         {
-            std::cout << val->getAsNumber()->getValue() << std::endl;
+            std::cout << val.getNumber() << std::endl;
         }
-        else if(val->getType() == VT_STRING)
+        else if(val.getType() == VT_STRING)
         {
-            std::cout << val->getAsString()->getValue() << std::endl;
+            std::cout << val.getString()->getValue() << std::endl;
         }
-        else if(val->getType() == VT_SEQUENCE)
+        else if(val.getType() == VT_SEQUENCE)
         {
             std::cout << "<sequence>" << std::endl;
         }
-        else if(val->getType() == VT_STRUCT)
+        else if(val.getType() == VT_STRUCT)
         {
             std::cout << "<struct>" << std::endl;
         }
 
-        return VariableVoidData::create();
+        return Value::createVoid();
     }
 
-    static FCIType toStringFunction(FCIArguments args)
+    static Value toStringFunction(Value const* args)
     {
         std::string retval = "<unknown>";
-        auto* val = args.at("val");
-        if(val->getType() == VT_NUMBER)
+        auto const& val = args[0];
+        if(val.getType() == VT_NUMBER)
         {
-            retval = std::to_string(val->getAsNumber()->getValue());
+            retval = std::to_string(val.getNumber());
             retval.erase ( retval.find_last_not_of('0') + 1, std::string::npos );
             retval.erase ( retval.find_last_not_of('.') + 1, std::string::npos );
         }
-        else if(val->getType() == VT_STRING)
+        else if(val.getType() == VT_STRING)
         {
-            retval = val->getAsString()->getValue();
+            retval = val.getString()->getValue();
         }
-        else if(val->getType() == VT_SEQUENCE)
+        else if(val.getType() == VT_SEQUENCE)
         {
             retval = "<sequence>";
         }
-        else if(val->getType() == VT_STRUCT)
+        else if(val.getType() == VT_STRUCT)
         {
             retval = "<struct>";
         }
 
-        return VariableStringData::create(retval);
+        return Value::createOwned(VariableStringData::create(retval));
     }
-    static FCIType toNumberFunction(FCIArguments args)
+    static Value toNumberFunction(Value const* args)
     {
         double retval = 0;
-        auto* val = args.at("val");
-        switch (val->getType())
+        auto const& val = args[0];
+        switch (val.getType())
         {
-            case VT_NUMBER: retval = val->getAsNumber()->getValue(); break;
-            case VT_STRING: retval = std::stod(val->getAsString()->getValue()); break;
+            case VT_NUMBER: retval = val.getNumber(); break;
+            case VT_STRING: retval = std::stod(val.getString()->getValue()); break;
             default: {
                 std::cout << "toNumber(): Given value is of invalid type, could not convert to number" << std::endl;
             }
         }
 
-        return VariableNumberData::create(retval);
+        return Value::createNumber(retval);
     }
 };
 #endif
@@ -1,21 +1,38 @@
 #include "lex.h"
+#include "scan.h"
+#include "threadpool.h"
 #include <string>
 #include <iostream>
+#include <algorithm>
 
 namespace xeouz
 {
 
 ///---  TOKEN  ---///
-Token::Token(): line(0), charpos(0)
+Token::Token(): owns_value(false), offset(0)
 {
     toknum = 0;
-    value = "";
 }
-Token::Token(int _toknum, std::string _value, std::size_t _line, std::size_t _charpos)
-: toknum(_toknum), value(_value), line(_line), charpos(_charpos)
+Token::Token(int _toknum, std::string_view _value, std::uint32_t _offset)
+: toknum(_toknum), value(_value), owns_value(false), offset(_offset)
 {
 
 }
+Token::Token(Token const& other)
+: toknum(other.toknum), value(other.value), storage(other.storage), owns_value(other.owns_value), offset(other.offset)
+{
+    if(owns_value)
+        value = storage;
+}
+
+std::unique_ptr<Token> Token::createOwned(int toknum, std::string const& value, std::uint32_t offset)
+{
+    auto token = std::make_unique<Token>(toknum, std::string_view(), offset);
+    token->storage = value;
+    token->value = token->storage;
+    token->owns_value = true;
+    return token;
+}
 
 std::string const Token::GetStringFromType(int token_type)
 {
@@ -70,6 +87,8 @@ std::string const Token::GetStringFromType(int token_type)
     case T_EXTERN: return "EXTERN";
 
     case T_NEXTLINE: return "NEXTLINE";
+
+    case T_INVALID: return "INVALID";
     
     default: return "<INVALID>";
     };
@@ -78,243 +97,523 @@ std::string const Token::toString() const
 {
     return GetStringFromType(toknum);
 }
-std::string const& Token::getValue() const
+std::string_view Token::getValue() const
 {
     return value;
 };
+std::size_t const Token::getLength() const
+{
+    return value.length();
+}
 int const Token::getTokenType() const
 {
     return toknum;
 };
 
-int const Token::getKeywordTokenType(std::string const& str)
+///---  TOKEN  ---///
+
+///--- Token Buffer ---///
+TokenBuffer::TokenBuffer(): text_offset(0), first(0), live(0)
 {
-    if(KeywordMap.count(str))
-        return KeywordMap.at(str);
-    return -1;
+
+}
+
+void TokenBuffer::clear()
+{
+    text_offset = first = live = 0;
+    types.clear();
+    offsets.clear();
+    lengths.clear();
+}
+void TokenBuffer::reserve(std::size_t count)
+{
+    types.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+}
+void TokenBuffer::setText(std::string_view _text, std::size_t _text_offset)
+{
+    text = _text;
+    text_offset = _text_offset;
+}
+std::string_view TokenBuffer::getText() const
+{
+    return text;
+}
+std::size_t const TokenBuffer::getTextOffset() const
+{
+    return text_offset;
+}
+
+void TokenBuffer::resize(std::size_t count)
+{
+    types.resize(count);
+    offsets.resize(count);
+    lengths.resize(count);
+}
+// Copies the first `count` entries of a buffer tokenized from the part of the source starting at
+// `offset` to `index`. Calls for disjoint ranges may run concurrently.
+void TokenBuffer::place(std::size_t index, TokenBuffer const& part, std::size_t count, std::uint32_t offset)
+{
+    std::copy(part.types.begin(), part.types.begin() + count, types.begin() + index);
+    std::copy(part.lengths.begin(), part.lengths.begin() + count, lengths.begin() + index);
+    for(std::size_t i=0; i<count; ++i)
+        offsets[index + i] = part.offsets[i] + offset;
+}
+void TokenBuffer::release(std::size_t index)
+{
+    if(index <= live)
+        return;
+    live = index < size() ? index : size();
+
+    // Storage is only compacted once most of it is released, so releasing stays amortized O(1)
+    std::size_t count = live - first;
+    if(count < 1024 || count < types.size() / 2)
+        return;
+
+    types.erase(types.begin(), types.begin() + count);
+    offsets.erase(offsets.begin(), offsets.begin() + count);
+    lengths.erase(lengths.begin(), lengths.begin() + count);
+    first = live;
+}
+std::size_t const TokenBuffer::getLiveIndex() const
+{
+    return live;
+}
+std::size_t const TokenBuffer::getRetainedOffset() const
+{
+    if(live >= size())
+        return SIZE_MAX;
+    return getOffset(live);
 }
-///---  TOKEN  ---///
+
+Token TokenBuffer::getToken(std::size_t index) const
+{
+    return Token(getType(index), getValue(index), getOffset(index));
+}
+///--- Token Buffer ---///
 
 ///---  LEXER  ---///
 Lexer::Lexer(std::string const& in_text, char _new_line_char)
-: new_line_char(_new_line_char)
+: Lexer(SourceBuffer::copy(in_text), _new_line_char)
 {
-    input_code = in_text;
-    length = in_text.length();
-    index = line = charpos = 0;
 
-    if(input_code.length() > 0)
-        cur = input_code.at(0);
-    else
-        cur = 0;
+}
+Lexer::Lexer(std::unique_ptr<SourceBuffer> _source, char _new_line_char)
+: new_line_char(_new_line_char), source(std::move(_source)), window_offset(0), retain_offset(SIZE_MAX), chunk_size(0), stream_finished(true)
+{
+    input_code = source->getText();
+    resetScan();
+}
+Lexer::Lexer(std::unique_ptr<SourceStream> _stream, std::size_t _chunk_size, char _new_line_char)
+: new_line_char(_new_line_char), stream(std::move(_stream)), window_offset(0), retain_offset(SIZE_MAX), chunk_size(_chunk_size ? _chunk_size : 1), stream_finished(false)
+{
+    input_code = window;
+    resetScan();
 }
 
-std::unique_ptr<Token> Lexer::constructCurrentToken(int type, std::string value)
+void Lexer::resetScan()
 {
-    if(type == -1)
-        type = T_IDENTIFIER;
-    auto token = std::make_unique<Token>(type, value, line, charpos);
-    return std::move(token);
+    begin = ptr = input_code.data();
+    end = begin + input_code.length();
+    token_start = 0;
+    line_table.clear();
+}
+// Drops the input before the earliest byte still needed and appends the next chunk of the stream
+bool Lexer::readChunk()
+{
+    std::size_t keep = std::min(retain_offset, offsetOf(ptr));
+    std::size_t drop = keep > window_offset ? keep - window_offset : 0;
+    std::size_t ptr_index = ptr - begin - drop;
+
+    line_table.extend(input_code, window_offset); // Before the text is gone
+    window.erase(0, drop);
+    window_offset += drop;
+
+    std::size_t buffered = window.size();
+    window.resize(buffered + chunk_size);
+    std::size_t count = stream->read(&window[buffered], chunk_size);
+    window.resize(buffered + count);
+
+    if(count == 0)
+        stream_finished = true;
+    else if(window_offset + window.size() >= UINT32_MAX)
+    {
+        std::cout << "LEXER: readChunk(): Stream is too large, token offsets are limited to 32 bits" << std::endl;
+        window.resize(buffered);
+        stream_finished = true;
+    }
+
+    input_code = window;
+    begin = input_code.data();
+    end = begin + input_code.length();
+    ptr = begin + ptr_index;
+    return count > 0;
+}
+
+void Lexer::skipWhitespace()
+{
+    ptr = Scanner::skipWhitespace(ptr, end);
+}
+void Lexer::markTokenStart()
+{
+    token_start = offsetOf(ptr);
 }
-std::unique_ptr<Token> Lexer::constructCurrentTokenAndAdvance(int type, std::string value)
+std::unique_ptr<Token> Lexer::constructCurrentToken(int type, char const* value_begin)
 {
-    advance(value.length()-1);
-    return constructCurrentToken(type, value);
+    if(type == -1)
+        type = T_IDENTIFIER;
+    std::string_view value(value_begin, ptr - value_begin);
+    return std::make_unique<Token>(type, value, offsetOf(value_begin));
 }
 char const Lexer::peekNext(int peek_amt) const
 {
-    int findex = index + peek_amt + 1;
-    if(findex > length-1)
+    char const* next = ptr + peek_amt + 1;
+    if(next >= end)
         return T_EOF;
 
-    return input_code.at(findex);
+    return *next;
 }
 
 int const Lexer::getIndex()
 {
-    return index;
+    return offsetOf(ptr);
+}
+std::string_view Lexer::getSource() const
+{
+    return input_code;
+}
+bool const Lexer::isStreaming() const
+{
+    return stream != nullptr;
+}
+// Only the first lookup scans the source for line starts, later ones binary search the table
+SourceLocation Lexer::getLocation(std::uint32_t offset)
+{
+    line_table.extend(input_code, window_offset);
+    return line_table.resolve(offset);
 }
 void Lexer::advance(int move_amt)
 {
-    int findex = index + move_amt + 1;
-    if(findex >= length)
+    std::size_t remaining = end - ptr;
+    std::size_t step = move_amt + 1;
+    ptr += step < remaining ? step : remaining;
+}
+std::string_view Lexer::gatherIdentifier()
+{
+    char const* start = ptr;
+    ptr = Scanner::skipIdentifier(ptr, end);
+    return std::string_view(start, ptr - start);
+}
+void Lexer::skipNumber()
+{
+    ptr = Scanner::skipDigits(ptr, end);
+    if(ptr < end && *ptr == '.')
     {
-        cur = EOF;
-        return;
+        ptr = Scanner::skipDigits(ptr + 1, end);
     }
-    
-    index += move_amt + 1;
-    charpos += move_amt + 1;
-    cur = input_code.at(index);
 }
-std::string const Lexer::gatherIdentifier()
+std::unique_ptr<Token> Lexer::gatherNumber()
 {
-    std::string id = "";
-
-    while(isalnum(cur) || cur=='_')
+    char const* start = ptr;
+    skipNumber();
+    return constructCurrentToken(T_NUMBER, start);
+}
+std::unique_ptr<Token> Lexer::gatherString()
+{
+    char const* start = ptr + 1;
+    char const* close = Scanner::findQuote(start, end, *ptr);
+    if(close >= end)
     {
-        if(cur==EOF)
-            break;
-        
-        id += cur;
-        advance();
+        ptr = end;
+        return nullptr;
     }
 
-    return id;
+    ptr = close;
+    auto token = constructCurrentToken(T_STRING, start);
+    ptr++;
+    return token;
 }
-std::unique_ptr<Token> Lexer::gatherNumber()
+
+// Picks the `<op>=` form of an operator when the next character is `=`
+static inline int pickCompound(char peek, int single, int compound, std::size_t& token_length)
+{
+    if(peek != '=')
+        return single;
+    token_length = 2;
+    return compound;
+}
+int Lexer::scanToken(char const*& value_begin, char const*& value_end)
 {
-    std::string numstring;
+    skipWhitespace();
+    markTokenStart();
 
-    while(isdigit(cur))
+    value_begin = ptr;
+    if(ptr >= end)
     {
-        numstring += cur;
-        advance();
+        value_end = ptr;
+        return T_EOF;
     }
 
-    if(cur == '.')
+    char cur = *ptr;
+    unsigned char cls = CharClassTable[(unsigned char)cur];
+    if(cls & CC_ALPHA)
+    {
+        auto id_str = gatherIdentifier();
+        value_end = ptr;
+
+        int type = Token::getKeywordTokenType(id_str);
+        return type == -1 ? T_IDENTIFIER : type;
+    }
+    
+    if(cls & CC_DIGIT)
     {
-        numstring += '.';
-        advance();
+        skipNumber();
+        value_end = ptr;
+        return T_NUMBER;
     }
 
-    while(isdigit(cur))
+    if(cls & CC_QUOTE)
+    {
+        char const* close = Scanner::findQuote(ptr + 1, end, cur);
+        if(close >= end) // Unterminated string, the value keeps the opening quote
+        {
+            ptr = value_end = end;
+            return T_INVALID;
+        }
+
+        value_begin++;
+        value_end = close;
+        ptr = close + 1;
+        return T_STRING;
+    }
+
+    int type = T_INVALID;
+    std::size_t token_length = 1;
+    char peek = peekNext(0);
+    if(cur == new_line_char)
+    {
+        type = T_NEXTLINE;
+    }
+    else switch(cur)
     {
-        numstring += cur;
-        advance();
+        case '{': type = T_LBRACE; break;
+        case '}': type = T_RBRACE; break;
+        case '[': type = T_LBRACK; break;
+        case ']': type = T_RBRACK; break;
+        case '(': type = T_LPAREN; break;
+        case ')': type = T_RPAREN; break;
+        case ',': type = T_COMMA; break;
+        case '@': type = T_ATSIGN; break;
+        case '.': type = T_DOT; break;
+
+        case '=': type = pickCompound(peek, T_EQUALS, T_DEQUAL, token_length); break;
+        case '!': type = pickCompound(peek, T_EXCLAM, T_NOTEQ, token_length); break;
+        case '>': type = pickCompound(peek, T_RARROW, T_MOREEQ, token_length); break;
+        case '<': type = pickCompound(peek, T_LARROW, T_LESSEQ, token_length); break;
+
+        case '+': type = pickCompound(peek, T_ADD, T_ADDEQ, token_length); break;
+        case '-': type = pickCompound(peek, T_SUB, T_SUBEQ, token_length); break;
+        case '*': type = pickCompound(peek, T_MUL, T_MULEQ, token_length); break;
+        case '/': type = pickCompound(peek, T_DIV, T_DIVEQ, token_length); break;
+        case '%': type = pickCompound(peek, T_MOD, T_MODEQ, token_length); break;
     }
 
-    return constructCurrentToken(T_NUMBER, numstring);
+    ptr += token_length;
+    value_end = ptr;
+    return type;
 }
-std::unique_ptr<Token> Lexer::gatherString()
-{
-    std::string str = "";
-    char start_quote = cur;
-    advance();
 
-    while(cur != start_quote)
+// Scans one token, reading more of the stream while the token may continue past the buffered input
+int Lexer::nextToken(char const*& value_begin, char const*& value_end)
+{
+    while(true)
     {
-        str += cur;
-        advance();
+        char const* start = ptr;
 
-        if(cur == EOF)
-            return nullptr;
-    }
+        int type = scanToken(value_begin, value_end);
+        if(ptr < end || stream_finished)
+            return type;
 
-    advance();
-    return constructCurrentToken(T_STRING, str);
+        // Only whitespace was left, which is kept skipped; anything else is scanned again
+        if(type != T_EOF)
+            ptr = start;
+        readChunk();
+    }
 }
 
 std::unique_ptr<Token> Lexer::getToken()
 {
-    while(isspace(cur))
-    {
-        if(cur == '\n' || cur == '\r')
-        {
-            line++;
-            charpos = 0;
-        }
-        else
-        {
-            charpos++;
-        }
+    char const* value_begin;
+    char const* value_end;
+    int type = nextToken(value_begin, value_end);
 
-        advance();
+    if(type == T_INVALID)
+    {
+        if(!isCharClass(*value_begin, CC_QUOTE))
+            std::cout << "LEXER: getToken(): Default case ran. Current Character ASCII: " << (int)*value_begin << std::endl;
+        return nullptr;
     }
 
-    if(isalpha(cur) || cur == '_')
+    std::string_view value(value_begin, value_end - value_begin);
+    if(stream) // The window is reused by the next read
+        return Token::createOwned(type, std::string(value), offsetOf(value_begin));
+    return std::make_unique<Token>(type, value, offsetOf(value_begin));
+}
+bool Lexer::tokenize(TokenBuffer& buffer)
+{
+    buffer.clear();
+    if(stream)
     {
-        std::string id_str = gatherIdentifier();
-        return constructCurrentToken(Token::getKeywordTokenType(id_str), id_str);
+        while(fill(buffer, 4096));
+        return true;
     }
-    
-    if(isdigit(cur))
+
+    buffer.setText(input_code);
+    if(input_code.length() >= UINT32_MAX)
     {
-        return gatherNumber();
+        std::cout << "LEXER: tokenize(): Source is too large, token offsets are limited to 32 bits" << std::endl;
+        buffer.push(T_EOF, 0, 0);
+        return false;
     }
 
-    if(cur == new_line_char)
+    buffer.reserve(input_code.length() / 6 + 1);
+    while(true)
     {
-        return constructCurrentTokenAndAdvance(T_NEXTLINE, std::string("")+new_line_char);
+        char const* value_begin;
+        char const* value_end;
+        int type = scanToken(value_begin, value_end);
+
+        buffer.push(type, value_begin - begin, value_end - value_begin);
+        if(type == T_EOF)
+            break;
     }
 
-    char peek = peekNext(0);
-    switch(cur)
+    return true;
+}
+// Splits the source at newlines outside strings and braces into chunks of about `target_size` bytes
+static void findSplitPoints(std::string_view text, std::size_t target_size, std::vector<std::size_t>& starts)
+{
+    starts.push_back(0);
+
+    char const* begin = text.data();
+    char const* end = begin + text.length();
+    std::size_t next_split = target_size;
+    int depth = 0;
+    for(char const* p = begin; p < end; ++p)
     {
-        case '{': return constructCurrentTokenAndAdvance(T_LBRACE, "{");
-        case '}': return constructCurrentTokenAndAdvance(T_RBRACE, "}");
-        case '[': return constructCurrentTokenAndAdvance(T_LBRACK, "[");
-        case ']': return constructCurrentTokenAndAdvance(T_RBRACK, "]");
-        case '(': return constructCurrentTokenAndAdvance(T_LPAREN, "(");
-        case ')': return constructCurrentTokenAndAdvance(T_RPAREN, ")");
-        case ',': return constructCurrentTokenAndAdvance(T_COMMA, ",");
-        case '@': return constructCurrentTokenAndAdvance(T_ATSIGN, "@");
-
-        case '=': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_DEQUAL, "==");
-            return constructCurrentTokenAndAdvance(T_EQUALS, "=");
-        }
-        case '!': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_NOTEQ, "!=");
-            return constructCurrentTokenAndAdvance(T_EXCLAM, "!");
-        }
-        case '>': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_MOREEQ, ">=");
-            return constructCurrentTokenAndAdvance(T_RARROW, ">");
-        }
-        case '<': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_LESSEQ, "<=");
-            return constructCurrentTokenAndAdvance(T_LARROW, "<");
+        switch(*p)
+        {
+            case '\n': {
+                std::size_t split = p + 1 - begin;
+                if(depth == 0 && split >= next_split && split < text.length())
+                {
+                    starts.push_back(split);
+                    next_split = split + target_size;
+                }
+                break;
+            }
+            case '"':
+            case '\'': {
+                p = Scanner::findQuote(p + 1, end, *p);
+                if(p >= end) // Unterminated, the rest of the source is one token
+                    return;
+                break;
+            }
+            case '{': depth++; break;
+            case '}': if(depth > 0) depth--; break;
         }
+    }
+}
+// Tokenizes chunks of the source on the pool and stitches them together, the result is identical to `tokenize`
+bool Lexer::tokenizeParallel(TokenBuffer& buffer, ThreadPool& pool, std::size_t min_chunk_size)
+{
+    if(stream || input_code.length() >= UINT32_MAX || pool.getThreadCount() < 2)
+        return tokenize(buffer);
 
-        case '+': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_ADDEQ, "+=");
-            return constructCurrentTokenAndAdvance(T_ADD, "+");
-        }
-        case '-': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_SUBEQ, "-=");
-            return constructCurrentTokenAndAdvance(T_SUB, "-");
-        }
-        case '*': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_MULEQ, "*=");
-            return constructCurrentTokenAndAdvance(T_MUL, "*");
-        }
-        case '/': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_DIVEQ, "/=");
-            return constructCurrentTokenAndAdvance(T_DIV, "/");
-        }
-        case '%': {
-            if(peek == '=')
-                return constructCurrentTokenAndAdvance(T_MODEQ, "%=");
-            return constructCurrentTokenAndAdvance(T_MOD, "%");
-        }
+    std::size_t target_size = input_code.length() / (pool.getThreadCount() * 4) + 1;
+    if(target_size < min_chunk_size)
+        target_size = min_chunk_size;
 
-        case '.': return constructCurrentTokenAndAdvance(T_DOT, ".");
+    std::vector<std::size_t> starts;
+    findSplitPoints(input_code, target_size, starts);
+    if(starts.size() == 1)
+        return tokenize(buffer);
 
-        case '"':  return gatherString();
-        case '\'': return gatherString();
+    std::vector<TokenBuffer> parts(starts.size());
+    for(std::size_t i=0; i<starts.size(); ++i)
+    {
+        pool.submit([this, i, &starts, &parts]() {
+            std::size_t chunk_end = i + 1 < starts.size() ? starts[i + 1] : input_code.length();
+            Lexer chunk(SourceBuffer::borrow(input_code.substr(starts[i], chunk_end - starts[i])), new_line_char);
+            chunk.tokenize(parts[i]);
+        });
+    }
+    pool.wait();
 
-        case EOF: return constructCurrentTokenAndAdvance(T_EOF, "");
+    // Every part ends with T_EOF, only the last one is kept
+    std::vector<std::size_t> indices(parts.size() + 1, 0);
+    for(std::size_t i=0; i<parts.size(); ++i)
+        indices[i + 1] = indices[i] + parts[i].size() - (i + 1 < parts.size());
 
-        default: {
-            std::cout << "LEXER: getToken(): Default case ran. Current Character ASCII: " << (int)cur << std::endl;
-            advance();
-            return nullptr;
-        }
+    buffer.clear();
+    buffer.setText(input_code);
+    buffer.resize(indices.back());
+    for(std::size_t i=0; i<parts.size(); ++i)
+    {
+        pool.submit([i, &buffer, &parts, &indices, &starts]() {
+            buffer.place(indices[i], parts[i], indices[i + 1] - indices[i], starts[i]);
+        });
+    }
+    pool.wait();
+
+    ptr = end;
+    return true;
+}
+
+// Appends up to `count` tokens, returns false once the T_EOF token has been appended.
+// A streaming Lexer keeps the text of every entry from the buffer's live index on.
+bool Lexer::fill(TokenBuffer& buffer, std::size_t count)
+{
+    for(std::size_t i=0; i<count; ++i)
+    {
+        retain_offset = buffer.getRetainedOffset();
+
+        char const* value_begin;
+        char const* value_end;
+        int type = nextToken(value_begin, value_end);
+
+        buffer.setText(input_code, window_offset);
+        buffer.push(type, offsetOf(value_begin), value_end - value_begin);
+        if(type == T_EOF)
+            return false;
     }
+
+    return true;
 }
 
 std::unique_ptr<Lexer> Lexer::create(std::string const& in_text, char new_line_char)
 {
     return std::make_unique<Lexer>(in_text, new_line_char);
 }
+std::unique_ptr<Lexer> Lexer::borrow(std::string_view in_text, char new_line_char)
+{
+    return std::make_unique<Lexer>(SourceBuffer::borrow(in_text), new_line_char);
+}
+std::unique_ptr<Lexer> Lexer::createFromFile(std::string const& path, char new_line_char)
+{
+    auto source = SourceBuffer::map(path);
+    if(!source)
+        return nullptr;
+    return std::make_unique<Lexer>(std::move(source), new_line_char);
+}
+std::unique_ptr<Lexer> Lexer::createFromStream(std::istream& in, std::size_t chunk_size, char new_line_char)
+{
+    return std::make_unique<Lexer>(SourceStream::fromStream(in), chunk_size, new_line_char);
+}
+std::unique_ptr<Lexer> Lexer::createFromFileDescriptor(int fd, std::size_t chunk_size, char new_line_char)
+{
+    return std::make_unique<Lexer>(SourceStream::fromFileDescriptor(fd), chunk_size, new_line_char);
+}
 ///---  LEXER  ---///
 }
\ No newline at end of file
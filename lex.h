@@ -1,8 +1,12 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <memory>
-#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+#include "source.h"
 
 namespace xeouz
 {
@@ -60,9 +64,20 @@ enum
     T_EXTERN,
 
     T_NEXTLINE,
+
+    T_INVALID,
+
+    T_TOKEN_COUNT,
+};
+
+///--- Keywords ---///
+struct KeywordEntry
+{
+    std::string_view word;
+    int type;
 };
 
-const std::unordered_map<std::string, int> KeywordMap = {
+inline constexpr KeywordEntry Keywords[] = {
     {"if", T_IF},
     {"else", T_ELSE},
     {"let", T_LET},
@@ -75,24 +90,105 @@ const std::unordered_map<std::string, int> KeywordMap = {
     {"true", T_TRUE},
     {"false", T_FALSE}
 };
+inline constexpr std::size_t KeywordCount = sizeof(Keywords) / sizeof(Keywords[0]);
+
+// Perfect hash over the keyword list, the multipliers are searched for at compile time
+struct KeywordHashTable
+{
+    static constexpr std::size_t Size = 32;
+
+    unsigned first_mul, length_mul;
+    std::size_t min_length, max_length;
+    signed char slots[Size];
+
+    static constexpr std::size_t hash(std::string_view word, unsigned first_mul, unsigned length_mul)
+    {
+        return ((unsigned char)word[0] * first_mul + (unsigned char)word[word.size()-1] + word.size() * length_mul) % Size;
+    }
+    constexpr std::size_t hash(std::string_view word) const
+    {
+        return hash(word, first_mul, length_mul);
+    }
+};
+
+constexpr KeywordHashTable makeKeywordHashTable()
+{
+    KeywordHashTable table {};
+    table.min_length = Keywords[0].word.size();
+    table.max_length = Keywords[0].word.size();
+    for(auto const& keyword: Keywords)
+    {
+        table.min_length = keyword.word.size() < table.min_length ? keyword.word.size() : table.min_length;
+        table.max_length = keyword.word.size() > table.max_length ? keyword.word.size() : table.max_length;
+    }
+
+    for(unsigned first_mul=1; first_mul<64; ++first_mul)
+    {
+        for(unsigned length_mul=0; length_mul<64; ++length_mul)
+        {
+            bool collides = false;
+            for(auto& slot: table.slots)
+                slot = -1;
+
+            for(std::size_t i=0; i<KeywordCount && !collides; ++i)
+            {
+                auto index = KeywordHashTable::hash(Keywords[i].word, first_mul, length_mul);
+                if(table.slots[index] != -1)
+                    collides = true;
+                table.slots[index] = (signed char)i;
+            }
+
+            if(!collides)
+            {
+                table.first_mul = first_mul;
+                table.length_mul = length_mul;
+                return table;
+            }
+        }
+    }
 
+    table.first_mul = 0;
+    return table;
+}
+
+inline constexpr KeywordHashTable KeywordHash = makeKeywordHashTable();
+static_assert(KeywordHash.first_mul != 0, "No perfect hash found for the keyword list, widen the search in makeKeywordHashTable()");
+///--- Keywords ---///
+
+// A Token's value is a view. Lexed tokens point into the Lexer's source buffer,
+// tokens made with `createOwned` keep their own copy of the text.
 class Token
 {
     int toknum;
-    std::string value;
+    std::string_view value;
+    std::string storage;
+    bool owns_value;
 public:
-    const std::size_t line, charpos;
+    const std::uint32_t offset; // Resolved to a line and column through the Lexer's line table
     Token();
-    Token(int toknum, std::string value, std::size_t line=0, std::size_t charpos=0);
+    Token(int toknum, std::string_view value, std::uint32_t offset=0);
+    Token(Token const& other);
 
-    std::string const& getValue() const;
+    std::string_view getValue() const;
+    std::size_t const getLength() const;
     int const getTokenType() const;
 
+    static std::unique_ptr<Token> createOwned(int toknum, std::string const& value, std::uint32_t offset=0);
+
     inline friend std::ostream& operator<<(std::ostream& os, const Token& token);
     inline friend bool operator==(int num, const Token& token);
     inline friend bool operator==(const Token& lhs, const Token& rhs);
 
-    static int const getKeywordTokenType(std::string const& string);
+    static int const getKeywordTokenType(std::string_view string)
+    {
+        if(string.size() < KeywordHash.min_length || string.size() > KeywordHash.max_length)
+            return -1;
+
+        int slot = KeywordHash.slots[KeywordHash.hash(string)];
+        if(slot < 0 || Keywords[slot].word != string)
+            return -1;
+        return Keywords[slot].type;
+    }
 
     std::string const toString() const;
     static std::string const GetStringFromType(int token_type);
@@ -112,30 +208,110 @@ inline bool operator==(const Token& lhs, const Token& rhs)
     return lhs.toknum == rhs.toknum;
 }
 
+class ThreadPool;
+
+///--- Token Buffer ---///
+// Structure-of-arrays storage for a tokenized source. Entry `i` is described by
+// its type and the offset and length of its value in the source text (for strings
+// the text between the quotes). The last entry is T_EOF.
+// Indices and offsets are absolute: a streaming Lexer appends entries as it
+// reads and drops text once the entries before a `release` index are gone, so
+// `text` starts at source offset `text_offset` and `size` is one past the last index.
+class TokenBuffer
+{
+    std::string_view text;
+    std::size_t text_offset;
+    std::size_t first, live;
+    std::vector<unsigned char> types;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+public:
+    TokenBuffer();
+
+    void clear();
+    void reserve(std::size_t count);
+    void setText(std::string_view text, std::size_t text_offset=0);
+    std::string_view getText() const;
+    std::size_t const getTextOffset() const;
+
+    void push(int type, std::uint32_t offset, std::uint32_t length)
+    {
+        types.push_back((unsigned char)type);
+        offsets.push_back(offset);
+        lengths.push_back(length);
+    }
+    void resize(std::size_t count);
+    void place(std::size_t index, TokenBuffer const& part, std::size_t count, std::uint32_t offset);
+    void release(std::size_t index);
+    std::size_t const getLiveIndex() const;
+    std::size_t const getRetainedOffset() const;
+
+    std::size_t const size() const { return first + types.size(); }
+    int const getType(std::size_t index) const { return types[index - first]; }
+    std::uint32_t const getOffset(std::size_t index) const { return offsets[index - first]; }
+    std::uint32_t const getLength(std::size_t index) const { return lengths[index - first]; }
+    std::string_view getValue(std::size_t index) const
+    {
+        return text.substr(offsets[index - first] - text_offset, lengths[index - first]);
+    }
+
+    Token getToken(std::size_t index) const;
+};
+///--- Token Buffer ---///
+
 class Lexer
 {
-    char cur;
     char new_line_char;
-    std::string input_code;
-    std::size_t index, line, charpos, length;
+    std::unique_ptr<SourceBuffer> source;
+    std::unique_ptr<SourceStream> stream;
+    std::string window; // Buffered stream input, starting at source offset `window_offset`
+    std::size_t window_offset, retain_offset, chunk_size;
+    bool stream_finished;
+    std::string_view input_code;
+    LineTable line_table;
+    char const* begin;
+    char const* ptr;
+    char const* end;
+    std::size_t token_start;
 
-    std::unique_ptr<Token> constructCurrentToken(int type, std::string value);
-    std::unique_ptr<Token> constructCurrentTokenAndAdvance(int type, std::string value);
+    std::size_t const offsetOf(char const* p) const { return window_offset + (p - begin); }
+    void resetScan();
+    bool readChunk();
+    int nextToken(char const*& value_begin, char const*& value_end);
+    void skipWhitespace();
+    void markTokenStart();
+    void skipNumber();
+    int scanToken(char const*& value_begin, char const*& value_end);
+    std::unique_ptr<Token> constructCurrentToken(int type, char const* value_begin);
     char const peekNext(int peek_amt=0) const;
 public:
     Lexer(std::string const& in_text, char new_line_char='\n');
+    Lexer(std::unique_ptr<SourceBuffer> source, char new_line_char='\n');
+    Lexer(std::unique_ptr<SourceStream> stream, std::size_t chunk_size, char new_line_char='\n');
+
+    static constexpr std::size_t DefaultChunkSize = 64 * 1024;
 
     int const getIndex();
+    std::string_view getSource() const;
+    bool const isStreaming() const;
+    SourceLocation getLocation(std::uint32_t offset);
     void advance(int move_amt=0);
-    std::string const gatherIdentifier();
+    std::string_view gatherIdentifier();
     std::unique_ptr<Token> gatherNumber();
     std::unique_ptr<Token> gatherString();
 
     std::unique_ptr<Token> getToken();
-    
+    bool tokenize(TokenBuffer& buffer);
+    bool fill(TokenBuffer& buffer, std::size_t count);
+    bool tokenizeParallel(TokenBuffer& buffer, ThreadPool& pool, std::size_t min_chunk_size = 256 * 1024);
+
     std::unique_ptr<Token> constructToken();
 
     static std::unique_ptr<Lexer> create(std::string const& in_text, char new_line_char='\n');
+    static std::unique_ptr<Lexer> borrow(std::string_view in_text, char new_line_char='\n');
+    static std::unique_ptr<Lexer> createFromFile(std::string const& path, char new_line_char='\n');
+    static std::unique_ptr<Lexer> createFromStream(std::istream& in, std::size_t chunk_size=DefaultChunkSize, char new_line_char='\n');
+    static std::unique_ptr<Lexer> createFromFileDescriptor(int fd, std::size_t chunk_size=DefaultChunkSize, char new_line_char='\n');
 };
 
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "loader.h"
+
+#include <iostream>
+#include <algorithm>
+#include <unordered_set>
+
+namespace xeouz
+{
+
+///--- Program Loader ---///
+ProgramLoader::ProgramLoader(ThreadPool* _pool): pool(_pool)
+{
+
+}
+
+bool ProgramLoader::addFile(std::string const& path)
+{
+    auto lexer = Lexer::createFromFile(path);
+    if(!lexer)
+        return false;
+    units.push_back({path, std::move(lexer), nullptr});
+    return true;
+}
+void ProgramLoader::addSource(std::string const& name, std::string const& text)
+{
+    units.push_back({name, Lexer::create(text), nullptr});
+}
+std::size_t const ProgramLoader::getUnitCount() const
+{
+    return units.size();
+}
+
+std::unique_ptr<Program> ProgramLoader::link(std::string const& program_name)
+{
+    auto arena = Arena::create();
+    ArenaScope scope(arena.get());
+
+    ASTList<ASTBase> statements(Arena::getActiveResource());
+    ASTList<ExternAST> externs(Arena::getActiveResource());
+    std::unordered_set<std::string_view> extern_names;
+    std::vector<std::unique_ptr<Arena>> unit_arenas;
+    for(auto& unit: units)
+    {
+        MainAST* main = unit.program->getMain();
+        for(auto& stm: main->releaseBody())
+            statements.push_back(std::move(stm));
+        for(auto& ext: main->releaseExternalFunctions())
+            if(extern_names.insert(ext->getName()).second)
+                externs.push_back(std::move(ext));
+        unit_arenas.push_back(unit.program->releaseArena());
+    }
+
+    auto main = std::make_unique<MainAST>(std::move(statements), std::move(externs), program_name);
+    auto program = Program::create(std::move(arena), main.release());
+    for(auto& unit_arena: unit_arenas)
+        program->adoptArena(std::move(unit_arena));
+    return program;
+}
+
+std::unique_ptr<Program> ProgramLoader::load(std::string const& program_name)
+{
+    std::unique_ptr<ThreadPool> own_pool;
+    if(!pool)
+        own_pool = ThreadPool::create();
+    ThreadPool* workers = pool ? pool : own_pool.get();
+
+    // Largest units first so a big one does not start last and hold up the link
+    std::vector<std::size_t> order(units.size());
+    for(std::size_t i=0; i<order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return units[a].lexer->getSource().size() > units[b].lexer->getSource().size();
+    });
+
+    for(std::size_t index: order)
+        workers->submit([this, index]() {
+            Unit& unit = units[index];
+            auto parser = Parser::create(std::move(unit.lexer));
+            unit.program = parser->ParseProgram(unit.name); // Eager, the unit's parser is gone by the time it runs
+        });
+    workers->wait();
+
+    bool parsed = true;
+    for(auto const& unit: units)
+        if(!unit.program)
+        {
+            std::cout << "LOADER: load(): Could not parse unit `" << unit.name << "`" << std::endl;
+            parsed = false;
+        }
+
+    std::unique_ptr<Program> program = parsed ? link(program_name) : nullptr;
+    units.clear();
+    return program;
+}
+
+std::unique_ptr<ProgramLoader> ProgramLoader::create(ThreadPool* pool)
+{
+    return std::make_unique<ProgramLoader>(pool);
+}
+///--- Program Loader ---///
+
+}
\ No newline at end of file
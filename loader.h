@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lex.h"
+#include "parse.h"
+#include "threadpool.h"
+
+namespace xeouz
+{
+
+///--- Program Loader ---///
+// Lexes and parses a set of source units concurrently and links them into one Program.
+// The linked body runs the units in the order they were added, and externs are listed once
+// in the order they are first declared, whatever order the workers finish in.
+// Run the result with Interpreter::interpretProgram, and pass it to Interpreter::loadStatements for reload to match against.
+class ProgramLoader
+{
+    struct Unit
+    {
+        std::string name;
+        std::unique_ptr<Lexer> lexer;
+        std::unique_ptr<Program> program;
+    };
+
+    std::vector<Unit> units;
+    ThreadPool* pool;
+
+    std::unique_ptr<Program> link(std::string const& program_name);
+public:
+    ProgramLoader(ThreadPool* pool = nullptr);
+
+    bool addFile(std::string const& path);
+    void addSource(std::string const& name, std::string const& text);
+    std::size_t const getUnitCount() const;
+
+    // Returns nullptr if any unit fails to parse, the units are consumed either way
+    std::unique_ptr<Program> load(std::string const& program_name = "main");
+
+    static std::unique_ptr<ProgramLoader> create(ThreadPool* pool = nullptr);
+};
+///--- Program Loader ---///
+
+}
\ No newline at end of file
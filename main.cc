@@ -29,18 +29,11 @@ class MathLib: xeouz::FCIFunctionLibraryBase
 using namespace xeouz;
 void run_test()
 {
-    // Get file text
-    std::string text;
+    // Open the script, it is read and run in chunks
     std::ifstream file("../in/test.lang");
 
-    std::string line;
-    while(getline(file, line))
-    {
-        text += line + "\n";
-    }
-
     // Setup Aphel
-    auto interpreter = Interpreter::create(text);
+    auto interpreter = Interpreter::createFromStream(file);
 
     // Add Libraries
     interpreter->registerFunctionLibrary<MathLib>();
@@ -52,16 +45,9 @@ void run_test()
 
 void run_interpret_test()
 {
-    std::string text;
     std::ifstream file("../in/test.xeouz");
 
-    std::string line;
-    while(getline(file, line))
-    {
-        text += line + "\n";
-    }
-
-    auto lex = xeouz::Lexer::create(text);
+    auto lex = xeouz::Lexer::createFromStream(file);
     auto parse = xeouz::Parser::create(std::move(lex));
     auto it = xeouz::Interpreter::create(std::move(parse));
     xeouz::lib::registerLibraries(it);
@@ -1,57 +1,147 @@
 #include "parse.h"
 #include <iostream>
+#include <cstdlib>
 
 namespace xeouz
 {
 
-Parser::Parser(std::unique_ptr<Lexer> _lexer): lexer(std::move(_lexer))
+///--- Program ---///
+Program::Program(std::unique_ptr<Arena> _arena, MainAST* _root): arena(std::move(_arena)), root(_root)
+{
+
+}
+
+MainAST* const Program::getMain() const
+{
+    return root;
+}
+Arena* const Program::getArena() const
+{
+    return arena.get();
+}
+void Program::adoptArena(std::unique_ptr<Arena> linked_arena)
+{
+    linked_arenas.push_back(std::move(linked_arena));
+}
+
+std::unique_ptr<Program> Program::create(std::unique_ptr<Arena> arena, MainAST* root)
+{
+    return std::make_unique<Program>(std::move(arena), root);
+}
+// For a Program linking this one's statements, which then has to adopt the arena they live in
+std::unique_ptr<Arena> Program::releaseArena()
+{
+    return std::move(arena);
+}
+///--- Program ---///
+
+Parser::Parser(std::unique_ptr<Lexer> _lexer): lexer(std::move(_lexer)), lexer_pool(nullptr), position(0), parse_success(true), tokens_complete(false), sequence_count(0), lazy_bodies(false)
 {
     
 }
 
-std::unique_ptr<ASTBase> Parser::LogError(std::string const& error, bool should_set_success)
+std::unique_ptr<ASTBase> Parser::LogError(std::string const& error, bool should_set_success, bool with_location)
 {
     if(should_set_success)
         parse_success = false;
 
-    std::cout << error;
+    if(!with_location)
+    {
+        std::cout << error;
+        return nullptr;
+    }
+
+    // The location goes before the trailing newline of the message
+    std::size_t length = error.length();
+    if(length > 0 && error[length - 1] == '\n')
+        length--;
+    std::cout << error.substr(0, length) << describeLocation(position) << error.substr(length);
     return nullptr;
 }
+std::string Parser::describeLocation(std::size_t token_index)
+{
+    if(token_index >= tokens.size())
+        return "";
+
+    auto location = lexer->getLocation(tokens.getOffset(token_index));
+    return " (line " + std::to_string(location.line + 1) + ", column " + std::to_string(location.column + 1) + ")";
+}
 bool const Parser::getParseSuccess() const
 {
     return parse_success;
 }
+void Parser::resetParseSuccess()
+{
+    parse_success = true;
+}
 
+void Parser::tokenizeInput()
+{
+    position = 0;
+    if(lexer->isStreaming())
+    {
+        tokens.clear();
+        tokens_complete = false;
+        fillTokens();
+        return;
+    }
+
+    if(lexer_pool)
+        lexer->tokenizeParallel(tokens, *lexer_pool);
+    else
+        lexer->tokenize(tokens);
+    tokens_complete = true;
+}
+// Streaming input is tokenized a batch at a time as the parser reaches the end of the buffer
+void Parser::fillTokens()
+{
+    if(!tokens_complete)
+        tokens_complete = !lexer->fill(tokens, 256);
+}
 void Parser::getNextTokenUnchecked(bool first_token)
 {
-    if(current_token && current_token->getTokenType()==T_EOF && !first_token)
+    if(first_token)
+    {
+        tokenizeInput();
+    }
+    else if(getCurrentTokenType() == T_EOF)
     {
         LogError("PARSER: getNextTokenUnchecked(): End of file\n");
         return;
     }
+    else
+    {
+        position++;
+    }
 
-    current_token.reset();
-    current_token = lexer->getToken();
-
-    if(!current_token)
+    while(true)
     {
-        LogError("PARSER: getNextTokenUnchecked(): Recieved Null Token\n");
-        getNextTokenUnchecked();
+        if(position >= tokens.size())
+            fillTokens();
+        if(getCurrentTokenType() != T_INVALID)
+            break;
+
+        auto value = getCurrentTokenValue();
+        if(value.length() > 0 && value[0] != '"' && value[0] != '\'')
+            LogError("PARSER: getNextTokenUnchecked(): Unexpected character ASCII " + std::to_string((int)value[0]) + "\n");
+        else
+            LogError("PARSER: getNextTokenUnchecked(): Unterminated string\n");
+        position++;
     }
 }
 void Parser::getNextToken(int token_type)
 {
     bool passed = true;
-    if(current_token->getTokenType() != token_type)
+    if(getCurrentTokenType() != token_type)
         passed = false;
-    if(current_token->getTokenType() == T_EOF && token_type == T_NEXTLINE)
+    if(getCurrentTokenType() == T_EOF && token_type == T_NEXTLINE)
         passed = true;
 
     if(!passed)
     {
         std::string error = "PARSER: getNextToken(): ";
         error += "Current Token type ";
-        error += current_token->toString();
+        error += Token::GetStringFromType(getCurrentTokenType());
         error += " does not match expected type ";
         error += Token::GetStringFromType(token_type);
         error += "\n";
@@ -62,14 +152,96 @@ void Parser::getNextToken(int token_type)
     getNextTokenUnchecked();
 }
 
-std::unique_ptr<Token> Parser::copyCurrentToken()
+TokenBuffer const& Parser::getTokens() const
+{
+    return tokens;
+}
+std::size_t const Parser::getPosition() const
+{
+    return position;
+}
+int const Parser::getCurrentTokenType() const
+{
+    if(position >= tokens.size())
+        return T_EOF;
+    return tokens.getType(position);
+}
+std::uint32_t const Parser::getCurrentTokenOffset() const
+{
+    if(position >= tokens.size())
+        return 0;
+    return tokens.getOffset(position);
+}
+std::string_view Parser::getCurrentTokenValue() const
 {
-    return std::make_unique<Token>(current_token->getTokenType(), current_token->getValue(), current_token->line, current_token->charpos);
+    if(position >= tokens.size())
+        return std::string_view();
+    return tokens.getValue(position);
 }
+int const Parser::peekTokenType(std::size_t lookahead)
+{
+    std::size_t index = position + lookahead;
+    while(index >= tokens.size() && !tokens_complete)
+        fillTokens();
+    if(index >= tokens.size())
+        return T_EOF;
+    return tokens.getType(index);
+}
+bool const Parser::isStreaming() const
+{
+    return lexer->isStreaming();
+}
+std::string_view Parser::getSource() const
+{
+    return lexer->getSource();
+}
+// Tokenizes large sources in parallel on the pool, which must outlive the parser
+void Parser::setLexerThreadPool(ThreadPool* pool)
+{
+    lexer_pool = pool;
+}
+std::size_t const Parser::getSequenceCount() const
+{
+    return sequence_count;
+}
+// Tokens before the current one are no longer needed, a streaming Lexer may drop their text
+void Parser::releaseTokens()
+{
+    tokens.release(position);
+}
+void Parser::setLazyBodies(bool enable)
+{
+    lazy_bodies = enable;
+}
+bool const Parser::getLazyBodies() const
+{
+    return lazy_bodies;
+}
+
+double Parser::parseNumberValue(std::string_view text)
+{
+    // Token values are not null-terminated, so copy short numbers to the stack before strtod
+    char buffer[64];
+    if(text.length() < sizeof(buffer))
+    {
+        text.copy(buffer, text.length());
+        buffer[text.length()] = 0;
+        return std::strtod(buffer, nullptr);
+    }
 
+    return std::strtod(std::string(text).c_str(), nullptr);
+}
 std::unique_ptr<ASTBase> Parser::ParsePrimary()
 {
-    switch(current_token->getTokenType())
+    std::uint32_t offset = getCurrentTokenOffset();
+    auto ast = ParsePrimaryUnlocated();
+    if(ast)
+        ast->setOffset(offset);
+    return ast;
+}
+std::unique_ptr<ASTBase> Parser::ParsePrimaryUnlocated()
+{
+    switch(getCurrentTokenType())
     {
         case T_ATSIGN: return ParseIdentifier(true);
         case T_IDENTIFIER: return ParseIdentifier();
@@ -92,29 +264,24 @@ std::unique_ptr<ASTBase> Parser::ParsePrimary()
             parse_success = false;
             
             std::string error = "PARSER: ParsePrimary(): Unable to parse unexpected token ";
-            error += current_token->toString();
+            error += Token::GetStringFromType(getCurrentTokenType());
+            error += describeLocation(position);
             error += "\n";
 
             getNextTokenUnchecked();
-            return LogError(error);
+            return LogError(error, true, false);
         }
     }
 }
 std::unique_ptr<ASTBase> Parser::ParseExpression()
 {
-    auto lhs = ParsePrimary();
-    if(!lhs)
-    {
-        return LogError("PARSER: ParseExpression(): LHS was null\n");
-    }
-
-    return ParseBinaryOperation(0, std::move(lhs));
+    return runExpression(EF_EXPRESSION, 0, nullptr);
 }
-std::unique_ptr<FunctionCallAST> Parser::ParseFunctionCall(std::unique_ptr<Token> name)
+std::unique_ptr<FunctionCallAST> Parser::ParseFunctionCall(std::size_t name_token)
 {
     getNextToken(T_LPAREN);
-    std::vector<std::unique_ptr<ASTBase>> args;
-    while(current_token->getTokenType() != T_RPAREN)
+    ASTList<ASTBase> args(Arena::getActiveResource());
+    while(getCurrentTokenType() != T_RPAREN)
     {
         if(auto arg = ParseExpression())
         {
@@ -123,10 +290,10 @@ std::unique_ptr<FunctionCallAST> Parser::ParseFunctionCall(std::unique_ptr<Token
         else
             return nullptr;
 
-        if(current_token->getTokenType() == T_RPAREN)
+        if(getCurrentTokenType() == T_RPAREN)
             break;
 
-        if(current_token->getTokenType() != T_COMMA)
+        if(getCurrentTokenType() != T_COMMA)
         {
             LogError("PARSER: ParseFunctionCall(): Expected ')' or ',' in function call argument list\n");
             return nullptr;
@@ -137,32 +304,33 @@ std::unique_ptr<FunctionCallAST> Parser::ParseFunctionCall(std::unique_ptr<Token
 
     getNextToken(T_RPAREN);
 
-    auto call = std::make_unique<FunctionCallAST>(name->getValue(), std::move(args));
+    auto call = std::make_unique<FunctionCallAST>(tokens.getValue(name_token), std::move(args));
+    call->setOffset(tokens.getOffset(name_token));
     return std::move(call);
 }
 
 std::unique_ptr<ASTBase> Parser::ParseIdentifier(bool atsign, bool ignore_assignment)
 {
-    auto id_copy = copyCurrentToken();
+    std::size_t id_token = position;
 
     getNextToken(T_IDENTIFIER);
 
     std::unique_ptr<ASTBase> expr;
-    if(current_token->getTokenType() != T_LPAREN)
+    if(getCurrentTokenType() != T_LPAREN)
     {
-        expr = std::make_unique<VariableAST>(id_copy->getValue());
+        expr = std::make_unique<VariableAST>(tokens.getValue(id_token));
 
         if(!ignore_assignment)
         {
-            if(current_token->getTokenType() == T_EQUALS)
+            if(getCurrentTokenType() == T_EQUALS)
             {
                 return ParseVariableAssignment(std::move(expr));
             }
-            else if(current_token->getTokenType() == T_ADDEQ
-                 || current_token->getTokenType() == T_SUBEQ
-                 || current_token->getTokenType() == T_MULEQ
-                 || current_token->getTokenType() == T_DIVEQ
-                 || current_token->getTokenType() == T_MODEQ)
+            else if(getCurrentTokenType() == T_ADDEQ
+                 || getCurrentTokenType() == T_SUBEQ
+                 || getCurrentTokenType() == T_MULEQ
+                 || getCurrentTokenType() == T_DIVEQ
+                 || getCurrentTokenType() == T_MODEQ)
             {
                 return ParseShorthandVariableAssignment(std::move(expr));
             }
@@ -172,15 +340,13 @@ std::unique_ptr<ASTBase> Parser::ParseIdentifier(bool atsign, bool ignore_assign
     }
 
     // It is a function call
-    return ParseFunctionCall(std::move(id_copy));
+    return ParseFunctionCall(id_token);
 }
 
 std::unique_ptr<NumberAST> Parser::ParseNumber()
 {
-    auto token = copyCurrentToken();
+    double num = parseNumberValue(getCurrentTokenValue());
     getNextToken(T_NUMBER);
-
-    double num = std::stod(token->getValue());
     
     auto ast = std::make_unique<NumberAST>(0);
     ast->setValue(num);
@@ -189,87 +355,210 @@ std::unique_ptr<NumberAST> Parser::ParseNumber()
 }
 std::unique_ptr<StringAST> Parser::ParseString()
 {
-    auto token = copyCurrentToken();
+    std::size_t string_token = position;
     getNextToken(T_STRING);
 
-    return std::make_unique<StringAST>(token->getValue());
+    return std::make_unique<StringAST>(tokens.getValue(string_token));
 }
 
 std::unique_ptr<ASTBase> Parser::ParseParenthesis()
 {
-    getNextToken(T_LPAREN);
-
-    auto stm = ParsePrimary();
-    if(!stm)
-        return nullptr;
-
-    stm = ParseBinaryOperation(0, std::move(stm));
-
-    if(current_token->getTokenType() != T_RPAREN)
-        return LogError("PARSER: ParseParenthesis(): Expected ')' at end of parenthesis expression\n");
-
-    getNextToken(T_RPAREN);
-
-    return std::move(stm);
+    return runExpression(EF_PARENTHESIS, 0, nullptr);
 }
-
 std::unique_ptr<ASTBase> Parser::ParseBinaryOperation(int expr_precedence, std::unique_ptr<ASTBase> lhs)
 {
-    if(current_token->getTokenType() == T_EOF)
-        return std::move(lhs);
+    return runExpression(EF_OPERATION, expr_precedence, std::move(lhs));
+}
 
-    while(true)
+///--- Expression Stack ---///
+// Expressions are parsed by a loop over an explicit stack of frames instead of native recursion, so long
+// operator chains and deeply nested parentheses use constant native stack. Each frame is one call of the
+// precedence climbing grammar (ParseExpression, ParseBinaryOperation and ParseParenthesis) and `step`
+// is where that call resumes once the call it made returns its node in `result`.
+enum ExpressionStep
+{
+    ES_ENTER,
+    ES_OPERAND,       // EF_EXPRESSION and EF_PARENTHESIS: first operand parsed
+    ES_CLOSE,         // EF_PARENTHESIS: inner operation parsed, expects ')'
+    ES_LOOP,          // EF_OPERATION: looks at the next operator
+    ES_LOGICAL_RHS,   // EF_OPERATION: rest of the expression after `and`/`or` parsed
+    ES_RHS,           // EF_OPERATION: right operand parsed
+    ES_HIGHER_RHS,    // EF_OPERATION: right operand with its higher precedence operators parsed
+};
+
+void Parser::pushExpressionFrame(int kind, int min_precedence, std::unique_ptr<ASTBase> lhs)
+{
+    ExpressionFrame frame;
+    frame.kind = kind;
+    frame.step = ES_ENTER;
+    frame.min_precedence = min_precedence;
+    frame.precedence = frame.op = -1;
+    frame.offset = 0;
+    frame.lhs = std::move(lhs);
+    expression_frames.push_back(std::move(frame));
+}
+// Parentheses get a frame, any other operand is a leaf for ParsePrimary
+void Parser::callExpressionOperand(std::unique_ptr<ASTBase>& result)
+{
+    if(getCurrentTokenType() == T_LPAREN)
+        pushExpressionFrame(EF_PARENTHESIS, 0, nullptr);
+    else
+        result = ParsePrimary();
+}
+std::unique_ptr<ASTBase> Parser::runExpression(int kind, int min_precedence, std::unique_ptr<ASTBase> lhs)
+{
+    // Operands may hold nested expressions (call arguments), which run above `base`
+    std::size_t base = expression_frames.size();
+    pushExpressionFrame(kind, min_precedence, std::move(lhs));
+
+    std::unique_ptr<ASTBase> result;
+    while(expression_frames.size() > base)
     {
-        int prec = -1;
-        if(ParserPrecedenceMap.count(current_token->getValue()))
-            prec = ParserPrecedenceMap[current_token->getValue()];
+        std::size_t top = expression_frames.size() - 1;
+        ExpressionFrame& frame = expression_frames[top];
 
-        if(prec < expr_precedence && !(current_token->getTokenType() == T_AND || current_token->getTokenType() == T_OR))
-            return std::move(lhs);
-        else if(current_token->getTokenType() == T_AND || current_token->getTokenType() == T_OR)
+        if(frame.kind == EF_EXPRESSION)
         {
-            auto binop = copyCurrentToken();
-            getNextTokenUnchecked();
+            if(frame.step == ES_ENTER)
+            {
+                frame.step = ES_OPERAND;
+                callExpressionOperand(result);
+                continue;
+            }
 
-            auto rhs = ParseExpression();
-            return std::make_unique<BinaryOperationAST>(std::move(binop), std::move(lhs), std::move(rhs));
+            expression_frames.pop_back();
+            if(!result)
+            {
+                result = LogError("PARSER: ParseExpression(): LHS was null\n");
+                continue;
+            }
+            pushExpressionFrame(EF_OPERATION, 0, std::move(result));
+            continue;
         }
 
-        auto binop = copyCurrentToken();
-        getNextTokenUnchecked();
+        if(frame.kind == EF_PARENTHESIS)
+        {
+            if(frame.step == ES_ENTER)
+            {
+                frame.offset = getCurrentTokenOffset();
+                frame.step = ES_OPERAND;
+                getNextToken(T_LPAREN);
+                callExpressionOperand(result);
+                continue;
+            }
+            if(frame.step == ES_OPERAND)
+            {
+                if(!result)
+                {
+                    expression_frames.pop_back();
+                    continue;
+                }
+                frame.step = ES_CLOSE;
+                pushExpressionFrame(EF_OPERATION, 0, std::move(result));
+                continue;
+            }
 
-        auto rhs = ParsePrimary();
-        if(!rhs)
-            return nullptr;
-        
-        int next_prec = -1;
-        if(ParserPrecedenceMap.count(current_token->getValue()))
-            next_prec = ParserPrecedenceMap[current_token->getValue()];
+            std::uint32_t offset = frame.offset;
+            expression_frames.pop_back();
+            if(getCurrentTokenType() != T_RPAREN)
+            {
+                result = LogError("PARSER: ParseParenthesis(): Expected ')' at end of parenthesis expression\n");
+                continue;
+            }
+            getNextToken(T_RPAREN);
+            if(result)
+                result->setOffset(offset);
+            continue;
+        }
 
-        if(prec < next_prec)
+        // EF_OPERATION
+        switch(frame.step)
         {
-            rhs = ParseBinaryOperation(prec + 1, std::move(rhs));
-            if(!rhs)
-                return nullptr;
-        }
+            case ES_ENTER: {
+                if(getCurrentTokenType() == T_EOF)
+                {
+                    result = std::move(frame.lhs);
+                    expression_frames.pop_back();
+                    continue;
+                }
+                frame.step = ES_LOOP;
+                continue;
+            }
+
+            case ES_LOOP: {
+                int token_type = getCurrentTokenType();
+                int prec = getOperatorPrecedence(token_type);
+                bool logical = token_type == T_AND || token_type == T_OR;
+                if(prec < frame.min_precedence && !logical)
+                {
+                    result = std::move(frame.lhs);
+                    expression_frames.pop_back();
+                    continue;
+                }
+
+                frame.op = token_type;
+                frame.precedence = prec;
+                frame.offset = getCurrentTokenOffset();
+                getNextTokenUnchecked();
+
+                // `and`/`or` take the rest of the expression as their right side
+                if(logical)
+                {
+                    frame.step = ES_LOGICAL_RHS;
+                    pushExpressionFrame(EF_EXPRESSION, 0, nullptr);
+                    continue;
+                }
+
+                frame.step = ES_RHS;
+                callExpressionOperand(result);
+                continue;
+            }
 
-        lhs = std::make_unique<BinaryOperationAST>(std::move(binop), std::move(lhs), std::move(rhs));
-        if(current_token->getTokenType() == T_EOF)
-            return std::move(lhs);
+            case ES_LOGICAL_RHS: {
+                result = std::make_unique<BinaryOperationAST>(frame.op, std::move(frame.lhs), std::move(result));
+                result->setOffset(frame.offset);
+                expression_frames.pop_back();
+                continue;
+            }
+
+            case ES_RHS:
+            case ES_HIGHER_RHS: {
+                if(!result)
+                {
+                    expression_frames.pop_back();
+                    continue;
+                }
+
+                if(frame.step == ES_RHS && frame.precedence < getOperatorPrecedence(getCurrentTokenType()))
+                {
+                    frame.step = ES_HIGHER_RHS;
+                    pushExpressionFrame(EF_OPERATION, frame.precedence + 1, std::move(result));
+                    continue;
+                }
+
+                frame.lhs = std::make_unique<BinaryOperationAST>(frame.op, std::move(frame.lhs), std::move(result));
+                frame.lhs->setOffset(frame.offset);
+                frame.step = ES_ENTER;
+                continue;
+            }
+        }
     }
+
+    return result;
 }
+///--- Expression Stack ---///
 
 std::unique_ptr<VariableDefinitionAST> Parser::ParseVariableDefinition()
 {
     getNextToken(T_LET);
 
-    auto var_name = copyCurrentToken();
+    std::size_t name_token = position;
     getNextToken(T_IDENTIFIER);
 
     getNextToken(T_EQUALS);
     auto expr = ParseExpression();
 
-    return std::make_unique<VariableDefinitionAST>(var_name->getValue(), std::move(expr));
+    return std::make_unique<VariableDefinitionAST>(tokens.getValue(name_token), std::move(expr));
 }
 std::unique_ptr<VariableAssignmentAST> Parser::ParseVariableAssignment(std::unique_ptr<ASTBase> expression)
 {
@@ -294,66 +583,52 @@ std::unique_ptr<VariableAssignmentAST> Parser::ParseShorthandVariableAssignment(
         case AST_VARDEF: name = ((VariableDefinitionAST*)expression.get())->getName();
     }
 
-    auto token = copyCurrentToken();
+    int token = getCurrentTokenType();
     getNextTokenUnchecked();
 
     auto value = ParseExpression();
 
-    std::unique_ptr<Token> symbol;
-    switch(token->getTokenType())
+    int symbol = T_EOF;
+    switch(token)
     {
-        case T_ADDEQ: {
-            symbol = std::make_unique<Token>(T_ADD, "+", token->line, token->charpos);
-            break;
-        }
-        case T_SUBEQ: {
-            symbol = std::make_unique<Token>(T_SUB, "-", token->line, token->charpos);
-            break;
-        }
-        case T_MULEQ: {
-            symbol = std::make_unique<Token>(T_MUL, "*", token->line, token->charpos);
-            break;
-        }
-        case T_DIVEQ: {
-            symbol = std::make_unique<Token>(T_DIV, "/", token->line, token->charpos);
-            break;
-        }
-        case T_MODEQ: {
-            symbol = std::make_unique<Token>(T_MOD, "%", token->line, token->charpos);
-            break;
-        }
+        case T_ADDEQ: symbol = T_ADD; break;
+        case T_SUBEQ: symbol = T_SUB; break;
+        case T_MULEQ: symbol = T_MUL; break;
+        case T_DIVEQ: symbol = T_DIV; break;
+        case T_MODEQ: symbol = T_MOD; break;
     }
 
-    return std::make_unique<VariableAssignmentAST>(name, std::move(value), std::move(symbol));
+    return std::make_unique<VariableAssignmentAST>(name, std::move(value), symbol);
 }
 
 std::unique_ptr<SequenceAST> Parser::ParseSequence()
 {
     getNextToken(T_LARROW);
 
-    std::vector<std::unique_ptr<FunctionCallAST>> calls;
-    while(current_token->getTokenType() != T_RARROW)
+    ASTList<FunctionCallAST> calls(Arena::getActiveResource());
+    while(getCurrentTokenType() != T_RARROW)
     {
-        auto name_token = copyCurrentToken();
+        std::size_t name_token = position;
         getNextToken(T_IDENTIFIER);
 
-        if(current_token->getTokenType() != T_LPAREN)
+        if(getCurrentTokenType() != T_LPAREN)
         {
             LogError("PARSER: ParseSequence(): Only function calls are allowed in a sequence\n");
             return nullptr;
         }
         
-        auto call = ParseFunctionCall(std::move(name_token));
+        auto call = ParseFunctionCall(name_token);
         if(!call)
             return nullptr;
         calls.push_back(std::move(call));
 
-        if(current_token->getTokenType() != T_RARROW)
+        if(getCurrentTokenType() != T_RARROW)
             getNextToken(T_COMMA);
     }
     
     getNextToken(T_RARROW);
 
+    sequence_count++;
     return std::make_unique<SequenceAST>(std::move(calls));
 }
 std::unique_ptr<ASTBase> Parser::ParseDo()
@@ -370,10 +645,10 @@ std::unique_ptr<ASTBase> Parser::ParseDo()
         return LogError("PARSER: ParseDo(): Given AST is neither a sequence nor a variable");
     }
 
-    std::vector<std::unique_ptr<ASTBase>> sequences;
+    ASTList<ASTBase> sequences(Arena::getActiveResource());
     sequences.push_back(std::move(val));
     
-    switch(current_token->getTokenType())
+    switch(getCurrentTokenType())
     {
         default: {
             return LogError("PARSER: ParseDo(): Only keywords `for` and `through` can be used after a sequence in a `do` statement\n");
@@ -394,64 +669,115 @@ std::unique_ptr<ASTBase> Parser::ParseDo()
 
 std::unique_ptr<ExternAST> Parser::ParseExtern()
 {
+    std::uint32_t offset = getCurrentTokenOffset();
     getNextToken(T_EXTERN);
 
-    auto name = copyCurrentToken();
+    std::size_t name_token = position;
     getNextToken(T_IDENTIFIER);
 
-    return std::make_unique<ExternAST>(name->getValue());
+    auto ast = std::make_unique<ExternAST>(tokens.getValue(name_token));
+    ast->setOffset(offset);
+    return ast;
 }
 
 std::unique_ptr<NumberAST> Parser::ParseTrueFalse()
 {
-    auto tok = copyCurrentToken();
+    int value_type = getCurrentTokenType();
     getNextTokenUnchecked();
 
-    if(tok->getTokenType() == T_TRUE)
+    if(value_type == T_TRUE)
         return std::make_unique<NumberAST>(1);
     else
         return std::make_unique<NumberAST>(0);
 }
-std::unique_ptr<IfAST> Parser::ParseIf()
+// Parses a braced body or a single statement into `statements`
+bool Parser::ParseBlock(ASTList<ASTBase>& statements)
 {
-    getNextToken(T_IF);
-    getNextToken(T_LPAREN);
-    
-    auto expression = ParseExpression();
-
-    getNextToken(T_RPAREN);
+    if(getCurrentTokenType() != T_LBRACE)
+    {
+        auto stm = ParsePrimary();
+        if(!stm)
+            return false;
+        statements.push_back(std::move(stm));
+        return true;
+    }
 
-    std::vector<std::unique_ptr<ASTBase>> statements;
-    if(current_token->getTokenType() != T_LBRACE)
+    getNextToken(T_LBRACE);
+    while(getCurrentTokenType() != T_RBRACE)
     {
         auto stm = ParsePrimary();
         if(!stm)
-            return nullptr;
+            return false;
         statements.push_back(std::move(stm));
+
+        if(getCurrentTokenType() != T_RBRACE)
+            getNextToken(T_NEXTLINE);
     }
-    else
+    getNextToken(T_RBRACE);
+    return true;
+}
+// Brace-matches the body at the current `{` and moves past it without building any nodes
+bool Parser::SkipBlock(LazyBody& body)
+{
+    body.begin = position;
+
+    std::size_t depth = 0;
+    while(true)
     {
-        getNextToken(T_LBRACE);
-        while(current_token->getTokenType() != T_RBRACE)
-        {
-            auto stm = ParsePrimary();
-            if(!stm)
-                return nullptr;
-            statements.push_back(std::move(stm));
+        if(position >= tokens.size())
+            fillTokens();
 
-            if(current_token->getTokenType() != T_RBRACE)
-                getNextToken(T_NEXTLINE);
+        int type = getCurrentTokenType();
+        if(type == T_EOF)
+        {
+            LogError("PARSER: SkipBlock(): Body starting" + describeLocation(body.begin) + " is missing its closing brace\n", true, false);
+            body = LazyBody();
+            return false;
         }
-        getNextToken(T_RBRACE);
+
+        if(type == T_LBRACE)
+            depth++;
+        else if(type == T_RBRACE && --depth == 0)
+            break;
+        position++;
     }
+
+    body.end = position;
+    getNextToken(T_RBRACE);
+    return true;
+}
+bool Parser::ParseBody(ASTList<ASTBase>& statements, LazyBody& lazy_body)
+{
+    if(lazy_bodies && !isStreaming() && getCurrentTokenType() == T_LBRACE)
+        return SkipBlock(lazy_body);
+    return ParseBlock(statements);
+}
+
+std::unique_ptr<IfAST> Parser::ParseIf()
+{
+    std::uint32_t offset = getCurrentTokenOffset();
+    getNextToken(T_IF);
+    getNextToken(T_LPAREN);
+    
+    auto expression = ParseExpression();
+
+    getNextToken(T_RPAREN);
+
+    ASTList<ASTBase> statements(Arena::getActiveResource());
+    LazyBody lazy_body;
+    if(!ParseBody(statements, lazy_body))
+        return nullptr;
     
-    return std::make_unique<IfAST>(std::move(expression), std::move(statements));
+    auto ast = std::make_unique<IfAST>(std::move(expression), std::move(statements));
+    ast->setLazyBody(lazy_body);
+    ast->setOffset(offset);
+    return ast;
 }
 std::unique_ptr<ASTBase> Parser::ParseIfElse()
 {
     bool has_else = false;
-    std::vector<std::unique_ptr<IfAST>> if_statements;
-    while(current_token->getTokenType() == T_IF)
+    ASTList<IfAST> if_statements(Arena::getActiveResource());
+    while(getCurrentTokenType() == T_IF)
     {
         auto ast = ParseIf();
         if(!ast)
@@ -459,10 +785,10 @@ std::unique_ptr<ASTBase> Parser::ParseIfElse()
         
         if_statements.push_back(std::move(ast));
 
-        if(current_token->getTokenType() == T_ELSE)
+        if(getCurrentTokenType() == T_ELSE)
         {
             getNextToken(T_ELSE);
-            if(current_token->getTokenType() != T_IF)
+            if(getCurrentTokenType() != T_IF)
             {
                 has_else = true;
                 break;
@@ -474,71 +800,97 @@ std::unique_ptr<ASTBase> Parser::ParseIfElse()
         }
     }
 
-    std::vector<std::unique_ptr<ASTBase>> else_stms;
-    if(has_else)
+    ASTList<ASTBase> else_stms(Arena::getActiveResource());
+    LazyBody lazy_else_body;
+    if(has_else && !ParseBody(else_stms, lazy_else_body))
+        return nullptr;
+
+    auto ast = std::make_unique<IfElseAST>(std::move(if_statements), std::move(else_stms));
+    ast->setLazyElseBody(lazy_else_body);
+    return ast;
+}
+// Parses a body that ParseIf or ParseIfElse skipped, the tokens of the program must still be held
+bool Parser::ParseLazyBody(LazyBody const& body, ASTList<ASTBase>& statements)
+{
+    if(!body.isPending() || body.end >= tokens.size() || body.begin < tokens.getLiveIndex())
     {
-        if(current_token->getTokenType() != T_LBRACE)
-        {
-            auto stm = ParsePrimary();
-            if(!stm)
-                return nullptr;
-            else_stms.push_back(std::move(stm));
-        }
-        else
-        {
-            getNextToken(T_LBRACE);
-            while(current_token->getTokenType() != T_RBRACE)
-            {
-                auto stm = ParsePrimary();
-                if(!stm)
-                    return nullptr;
-                else_stms.push_back(std::move(stm));
+        LogError("PARSER: ParseLazyBody(): Tokens of the body are no longer available\n", true, false);
+        return false;
+    }
 
-                if(current_token->getTokenType() != T_RBRACE)
-                    getNextToken(T_NEXTLINE);
-            }
-            getNextToken(T_RBRACE);
-        }
+    std::size_t saved_position = position;
+    position = body.begin;
+
+    bool parsed = ParseBlock(statements);
+    if(parsed && position <= body.end)
+    {
+        LogError("PARSER: ParseLazyBody(): Body ended before its closing brace\n");
+        parsed = false;
     }
 
-    return std::make_unique<IfElseAST>(std::move(if_statements), std::move(else_stms));
+    position = saved_position;
+    return parsed;
 }
 
-std::unique_ptr<MainAST> Parser::ParseMain(std::string const& program_name)
+void Parser::startParsing()
 {
     getNextTokenUnchecked(true);
     parse_success = true;
+}
+// Parses one top-level statement or extern, returns false at the end of the input
+bool Parser::ParseTopLevel(ASTList<ASTBase>& statements, ASTList<ExternAST>& externs)
+{
+    if(getCurrentTokenType() == T_EOF)
+        return false;
 
-    std::vector<std::unique_ptr<ASTBase>> statements;
-    std::vector<std::unique_ptr<ExternAST>> externs;
-    while(current_token->getTokenType() != T_EOF)
+    if(getCurrentTokenType() == T_EXTERN)
     {
-        if(current_token->getTokenType() == T_EXTERN)
-        {
-            auto extern_ast = ParseExtern();
-            externs.push_back(std::move(extern_ast));
-            if(current_token->getTokenType() == T_NEXTLINE)
-                getNextToken(T_NEXTLINE);
-        }
-        else
-        {
-            auto stm = ParsePrimary();
-            if(current_token->getTokenType() == T_NEXTLINE)
-                getNextToken(T_NEXTLINE);
+        auto extern_ast = ParseExtern();
+        externs.push_back(std::move(extern_ast));
+        if(getCurrentTokenType() == T_NEXTLINE)
+            getNextToken(T_NEXTLINE);
+    }
+    else
+    {
+        auto stm = ParsePrimary();
+        if(getCurrentTokenType() == T_NEXTLINE)
+            getNextToken(T_NEXTLINE);
 
-            statements.push_back(std::move(stm));
-        }
+        statements.push_back(std::move(stm));
     }
+    return true;
+}
+std::unique_ptr<MainAST> Parser::ParseMain(std::string const& program_name)
+{
+    startParsing();
+
+    ASTList<ASTBase> statements(Arena::getActiveResource());
+    ASTList<ExternAST> externs(Arena::getActiveResource());
+    while(ParseTopLevel(statements, externs));
 
     if(!parse_success)
     {
-        LogError("PARSER: ParseMain(): Could not parse input code successfully\n");
+        LogError("PARSER: ParseMain(): Could not parse input code successfully\n", true, false);
         return nullptr;
     }
     
     return std::make_unique<MainAST>(std::move(statements), std::move(externs), program_name);
 }
 
+std::unique_ptr<Program> Parser::ParseProgram(std::string const& program_name)
+{
+    auto arena = Arena::create();
+    std::unique_ptr<MainAST> main;
+    {
+        ArenaScope scope(arena.get());
+        main = ParseMain(program_name);
+    }
+
+    if(!main)
+        return nullptr;
+    return Program::create(std::move(arena), main.release());
+}
+
 std::unique_ptr<Parser> Parser::create(std::unique_ptr<Lexer> lexer)
 {
     return std::make_unique<Parser>(std::move(lexer));
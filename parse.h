@@ -1,8 +1,9 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "lex.h"
 #include "ast.h"
@@ -10,41 +11,124 @@
 namespace xeouz
 {
 
-static std::unordered_map<std::string, int> ParserPrecedenceMap = {
-    {"<", 10},
-    {">", 10},
-    {"<=", 10},
-    {">=", 10},
-    {"==", 10},
-    {"!=", 10},
-    {"+", 20},
-    {"-", 20},
-    {"*", 40},
-    {"/", 40},
-    {"%", 40},
-    {"**", 60}
+constexpr std::array<signed char, T_TOKEN_COUNT> makeParserPrecedenceTable()
+{
+    std::array<signed char, T_TOKEN_COUNT> table {};
+    for(auto& prec: table)
+        prec = -1;
+
+    table[T_LARROW] = 10;
+    table[T_RARROW] = 10;
+    table[T_LESSEQ] = 10;
+    table[T_MOREEQ] = 10;
+    table[T_DEQUAL] = 10;
+    table[T_NOTEQ] = 10;
+    table[T_ADD] = 20;
+    table[T_SUB] = 20;
+    table[T_MUL] = 40;
+    table[T_DIV] = 40;
+    table[T_MOD] = 40;
+    return table;
+}
+
+// Binary operator precedence indexed by token type, -1 for tokens that are not operators
+inline constexpr std::array<signed char, T_TOKEN_COUNT> ParserPrecedenceTable = makeParserPrecedenceTable();
+
+enum ExpressionFrameKind
+{
+    EF_EXPRESSION,  // ParseExpression
+    EF_OPERATION,   // ParseBinaryOperation
+    EF_PARENTHESIS, // ParseParenthesis
 };
 
+// One pending call of the expression grammar, kept on the parser's own stack
+struct ExpressionFrame
+{
+    int kind;
+    int step;
+    int min_precedence;
+    int precedence;
+    int op;
+    std::uint32_t offset;
+    std::unique_ptr<ASTBase> lhs;
+};
+
+///--- Program ---///
+// A parsed program whose nodes all live in its own arena. Dropping it gives the memory back
+// in one go without visiting the tree, lazy bodies parsed later are placed in the same arena.
+class Program
+{
+    std::unique_ptr<Arena> arena;
+    std::vector<std::unique_ptr<Arena>> linked_arenas; // Arenas of the units linked into the root
+    MainAST* root;
+public:
+    Program(std::unique_ptr<Arena> arena, MainAST* root);
+
+    MainAST* const getMain() const;
+    Arena* const getArena() const;
+    void adoptArena(std::unique_ptr<Arena> linked_arena);
+    std::unique_ptr<Arena> releaseArena();
+
+    static std::unique_ptr<Program> create(std::unique_ptr<Arena> arena, MainAST* root);
+};
+///--- Program ---///
+
 class Parser
 {
     std::unique_ptr<Lexer> lexer;
+    ThreadPool* lexer_pool;
+    TokenBuffer tokens;
+    std::size_t position;
     bool parse_success;
+    bool tokens_complete;
+    std::size_t sequence_count;
+    std::vector<ExpressionFrame> expression_frames;
+    bool lazy_bodies;
 
+    void tokenizeInput();
+    void fillTokens();
     void getNextTokenUnchecked(bool first_token = false);
+    std::string describeLocation(std::size_t token_index);
+    std::unique_ptr<ASTBase> ParsePrimaryUnlocated();
+    void pushExpressionFrame(int kind, int min_precedence, std::unique_ptr<ASTBase> lhs);
+    void callExpressionOperand(std::unique_ptr<ASTBase>& result);
+    std::unique_ptr<ASTBase> runExpression(int kind, int min_precedence, std::unique_ptr<ASTBase> lhs);
+    bool ParseBlock(ASTList<ASTBase>& statements);
+    bool SkipBlock(LazyBody& body);
+    bool ParseBody(ASTList<ASTBase>& statements, LazyBody& lazy_body);
+
+    static double parseNumberValue(std::string_view text);
+    static int getOperatorPrecedence(int token_type)
+    {
+        return ParserPrecedenceTable[token_type];
+    }
 public:
-    std::unique_ptr<Token> current_token;
-
     Parser(std::unique_ptr<Lexer> lexer);
 
-    std::unique_ptr<ASTBase> LogError(std::string const& error, bool should_set_success=true);
+    std::unique_ptr<ASTBase> LogError(std::string const& error, bool should_set_success=true, bool with_location=true);
     bool const getParseSuccess() const;
-
+    void resetParseSuccess();
+
+    TokenBuffer const& getTokens() const;
+    std::size_t const getPosition() const;
+    int const getCurrentTokenType() const;
+    std::string_view getCurrentTokenValue() const;
+    int const peekTokenType(std::size_t lookahead = 1);
+    bool const isStreaming() const;
+    std::string_view getSource() const;
+    void setLexerThreadPool(ThreadPool* pool);
+    std::size_t const getSequenceCount() const;
+    void releaseTokens();
+    // Braced if/else bodies are only brace-matched while parsing, see ParseLazyBody. Ignored for streaming input.
+    void setLazyBodies(bool enable);
+    bool const getLazyBodies() const;
+
+    std::uint32_t const getCurrentTokenOffset() const;
     void getNextToken(int token_type);
-    std::unique_ptr<Token> copyCurrentToken();
 
     std::unique_ptr<ASTBase> ParsePrimary();
     std::unique_ptr<ASTBase> ParseExpression();
-    std::unique_ptr<FunctionCallAST> ParseFunctionCall(std::unique_ptr<Token> name);
+    std::unique_ptr<FunctionCallAST> ParseFunctionCall(std::size_t name_token);
 
     std::unique_ptr<ASTBase> ParseIdentifier(bool atsign = false, bool ignore_assignment = false);
     std::unique_ptr<NumberAST> ParseNumber();
@@ -65,8 +149,12 @@ public:
     std::unique_ptr<NumberAST> ParseTrueFalse();
     std::unique_ptr<IfAST> ParseIf();
     std::unique_ptr<ASTBase> ParseIfElse();
+    bool ParseLazyBody(LazyBody const& body, ASTList<ASTBase>& statements);
 
+    void startParsing();
+    bool ParseTopLevel(ASTList<ASTBase>& statements, ASTList<ExternAST>& externs);
     std::unique_ptr<MainAST> ParseMain(std::string const& program_name = "main");
+    std::unique_ptr<Program> ParseProgram(std::string const& program_name = "main");
 
     static std::unique_ptr<Parser> create(std::unique_ptr<Lexer> lexer);
 };
@@ -0,0 +1,198 @@
+#include "progcache.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <random>
+#include <filesystem>
+
+// The Makefile passes a hash of the sources, other builds fall back to when this file was compiled
+#ifndef XEOUZ_BUILD_ID
+#define XEOUZ_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+namespace xeouz
+{
+
+///--- Program Cache ---///
+// FNV-1a over 8-byte words with a final avalanche, seeded with the length
+std::uint64_t const hashSource(std::string_view text)
+{
+    std::uint64_t const prime = 0x100000001b3ull;
+    std::uint64_t hash = 0xcbf29ce484222325ull ^ text.size();
+
+    std::size_t i = 0;
+    for(; i + 8 <= text.size(); i += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, text.data() + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for(; i < text.size(); ++i)
+        hash = (hash ^ (unsigned char)text[i]) * prime;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+std::uint64_t const getBuildID()
+{
+    static std::uint64_t const build_id = hashSource(std::string(XEOUZ_BUILD_ID) + " " + std::to_string(sizeof(void*)));
+    return build_id;
+}
+
+ProgramCache::ProgramCache(std::string const& _directory): directory(_directory)
+{
+
+}
+
+std::string const& ProgramCache::getDirectory() const
+{
+    return directory;
+}
+std::string ProgramCache::getImagePath(std::uint64_t source_hash) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.aphc", (unsigned long long)source_hash);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+std::unique_ptr<ASTPool> ProgramCache::load(std::uint64_t source_hash)
+{
+    std::string path = getImagePath(source_hash);
+    std::error_code error;
+    if(!std::filesystem::is_regular_file(path, error))
+        return nullptr;
+
+    auto image = SourceBuffer::map(path);
+    if(!image)
+        return nullptr;
+    return ASTPool::mapImage(std::move(image), source_hash, getBuildID());
+}
+bool ProgramCache::store(std::uint64_t source_hash, ASTPool const& pool)
+{
+    std::string bytes;
+    if(!pool.writeImage(bytes, source_hash, getBuildID()))
+        return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // Renamed over the final name once complete, a concurrent run maps either the old image or the new one
+    std::string path = getImagePath(source_hash);
+    std::string temp_path = path + ".tmp" + std::to_string(std::random_device()());
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if(!file.write(bytes.data(), bytes.size()))
+        {
+            std::cout << "PROGRAMCACHE: store(): Could not write image `" << temp_path << "`" << std::endl;
+            std::filesystem::remove(temp_path, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, path, error);
+    if(error)
+    {
+        std::cout << "PROGRAMCACHE: store(): Could not replace image `" << path << "`" << std::endl;
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<ProgramCache> ProgramCache::create(std::string const& directory)
+{
+    return std::make_unique<ProgramCache>(directory);
+}
+///--- Program Cache ---///
+
+///--- Program Memory Cache ---///
+ProgramMemoryCache::ProgramMemoryCache(std::size_t _byte_budget)
+: byte_budget(_byte_budget), bytes_used(0), hits(0), misses(0), evictions(0)
+{
+
+}
+
+// Called with the mutex held
+void ProgramMemoryCache::evict()
+{
+    while(bytes_used > byte_budget && !entries.empty())
+    {
+        Entry const& oldest = entries.back();
+        bytes_used -= oldest.bytes;
+        index.erase(oldest.source_hash);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+std::shared_ptr<ASTPool> ProgramMemoryCache::find(std::uint64_t source_hash)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(source_hash);
+    if(it == index.end())
+    {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->pool;
+}
+void ProgramMemoryCache::insert(std::uint64_t source_hash, std::shared_ptr<ASTPool> pool)
+{
+    std::size_t bytes = pool->getByteSize();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(source_hash);
+    if(it != index.end()) // Another thread compiled the same source first
+    {
+        bytes_used -= it->second->bytes;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    entries.push_front({source_hash, std::move(pool), bytes});
+    index[source_hash] = entries.begin();
+    bytes_used += bytes;
+    evict();
+}
+void ProgramMemoryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    bytes_used = 0;
+}
+
+std::size_t const ProgramMemoryCache::getByteBudget()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return byte_budget;
+}
+void ProgramMemoryCache::setByteBudget(std::size_t new_byte_budget)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    byte_budget = new_byte_budget;
+    evict();
+}
+ProgramMemoryCacheStats ProgramMemoryCache::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return {hits, misses, evictions, entries.size(), bytes_used};
+}
+
+std::unique_ptr<ProgramMemoryCache> ProgramMemoryCache::create(std::size_t byte_budget)
+{
+    return std::make_unique<ProgramMemoryCache>(byte_budget);
+}
+///--- Program Memory Cache ---///
+
+}
\ No newline at end of file
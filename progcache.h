@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "astpool.h"
+
+namespace xeouz
+{
+
+///--- Program Cache ---///
+std::uint64_t const hashSource(std::string_view text);
+// Differs between builds of the interpreter, the Makefile defines XEOUZ_BUILD_ID as a hash of the sources
+std::uint64_t const getBuildID();
+
+// Compiled programs kept on disk as ASTPool images, one file per source hash. A later run maps
+// the image and walks it in place. Images of another source, build or version are not loaded.
+class ProgramCache
+{
+    std::string directory;
+public:
+    ProgramCache(std::string const& directory);
+
+    std::string const& getDirectory() const;
+    std::string getImagePath(std::uint64_t source_hash) const;
+
+    std::unique_ptr<ASTPool> load(std::uint64_t source_hash);
+    bool store(std::uint64_t source_hash, ASTPool const& pool);
+
+    static std::unique_ptr<ProgramCache> create(std::string const& directory);
+};
+///--- Program Cache ---///
+
+///--- Program Memory Cache ---///
+struct ProgramMemoryCacheStats
+{
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t evictions;
+    std::size_t entries;
+    std::size_t bytes;
+};
+
+// Compiled programs shared between the Interpreters of one process, keyed by source hash.
+// Least recently used pools are dropped once their total size exceeds the byte budget,
+// an Interpreter still running one keeps it alive. Safe to use from several threads.
+class ProgramMemoryCache
+{
+    struct Entry
+    {
+        std::uint64_t source_hash;
+        std::shared_ptr<ASTPool> pool;
+        std::size_t bytes;
+    };
+
+    std::mutex mutex;
+    std::list<Entry> entries; // Most recently used first
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+    std::size_t byte_budget;
+    std::size_t bytes_used;
+    std::size_t hits, misses, evictions;
+
+    void evict();
+public:
+    ProgramMemoryCache(std::size_t byte_budget);
+
+    std::shared_ptr<ASTPool> find(std::uint64_t source_hash);
+    void insert(std::uint64_t source_hash, std::shared_ptr<ASTPool> pool);
+    void clear();
+
+    std::size_t const getByteBudget();
+    void setByteBudget(std::size_t byte_budget);
+    ProgramMemoryCacheStats getStats();
+
+    static std::unique_ptr<ProgramMemoryCache> create(std::size_t byte_budget = 64 * 1024 * 1024);
+};
+///--- Program Memory Cache ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,746 @@
+#include "regvm.h"
+#include "bytecode.h"
+#include "interpret.h"
+
+#include <climits>
+
+#if defined(__GNUC__) && !defined(XEOUZ_NO_COMPUTED_GOTO)
+#define XEOUZ_COMPUTED_GOTO 1
+#endif
+
+namespace xeouz
+{
+
+namespace
+{
+
+// Reading these cannot log or call anything, so they can wait in an operand while later ones are evaluated
+inline bool const isLeaf(ASTBase* ast)
+{
+    return ast->type == AST_NUMBER || ast->type == AST_VAR;
+}
+
+}
+
+///--- Register Bytecode ---///
+RegisterProgram::RegisterProgram(): register_count(1)
+{
+
+}
+
+std::uint32_t const RegisterProgram::addNumber(double value)
+{
+    auto it = number_ids.find(value);
+    if(it != number_ids.end())
+        return it->second;
+    numbers.push_back(value);
+    number_ids.emplace(value, numbers.size() - 1);
+    return numbers.size() - 1;
+}
+std::uint32_t const RegisterProgram::addString(std::string value)
+{
+    strings.push_back(std::move(value));
+    return strings.size() - 1;
+}
+std::uint32_t const RegisterProgram::addVariable(std::string_view name)
+{
+    auto it = variable_ids.find(name);
+    if(it != variable_ids.end())
+        return it->second;
+    variables.emplace_back(name);
+    variable_ids.emplace(name, variables.size() - 1);
+    return variables.size() - 1;
+}
+std::uint32_t const RegisterProgram::addFunction(std::string_view name)
+{
+    auto it = function_ids.find(name);
+    if(it != function_ids.end())
+        return it->second;
+    functions.emplace_back(name);
+    function_ids.emplace(name, functions.size() - 1);
+    return functions.size() - 1;
+}
+std::uint32_t const RegisterProgram::addTree(ASTBase* ast)
+{
+    trees.push_back(ast);
+    return trees.size() - 1;
+}
+std::uint32_t const RegisterProgram::useRegister(std::uint32_t r)
+{
+    if(r >= register_count)
+        register_count = r + 1;
+    return r;
+}
+
+void RegisterProgram::emit(std::initializer_list<std::uint32_t> words)
+{
+    code.insert(code.end(), words);
+}
+std::uint32_t const RegisterProgram::here() const
+{
+    return code.size();
+}
+
+// Numbers always become constants, variables only when `fold_variable`, anything else is evaluated into register `r`
+std::uint32_t const RegisterProgram::compileOperand(ASTBase* ast, std::uint32_t r, bool fold_variable)
+{
+    if(ast->type == AST_NUMBER)
+        return RK_NUMBER | addNumber(((NumberAST*)ast)->getValue());
+    if(ast->type == AST_VAR && fold_variable)
+        return RK_VARIABLE | addVariable(((VariableAST*)ast)->getName());
+
+    compileValue(ast, r);
+    return RK_REGISTER | r;
+}
+void RegisterProgram::compileValue(ASTBase* ast, std::uint32_t r)
+{
+    useRegister(r);
+    switch(ast->type)
+    {
+        default: {
+            emit({RI_ERROR, r, addString("INTERPRETER: interpretExpression(): Unable to interpret invalid AST type `"+ast->toString()+"`")});
+            break;
+        }
+        case AST_NUMBER: emit({RI_MOVE, r, RK_NUMBER | addNumber(((NumberAST*)ast)->getValue())}); break;
+        case AST_VAR: emit({RI_MOVE, r, RK_VARIABLE | addVariable(((VariableAST*)ast)->getName())}); break;
+        case AST_STRING: emit({RI_STRING, r, addString(std::string(((StringAST*)ast)->getValue()))}); break;
+        case AST_CALL: compileCall((FunctionCallAST*)ast, r); break;
+        case AST_SEQUENCE: {
+            emit({RI_SEQUENCE, r, addTree(ast)});
+            for(auto&& call: ((SequenceAST*)ast)->getBody())
+                if(sequence_calls.emplace(call.get(), UINT32_MAX).second)
+                    pending_calls.push_back(call.get());
+            break;
+        }
+        case AST_BINOP: {
+            auto* binop = (BinaryOperationAST*)ast;
+            std::uint32_t lhs = compileOperand(binop->getLHS(), r, isLeaf(binop->getRHS()));
+            std::uint32_t rhs = compileOperand(binop->getRHS(), lhs == (RK_REGISTER | r) ? useRegister(r + 1) : r, true);
+            emit({RI_BINARY, (std::uint32_t)binop->getOperator(), r, lhs, rhs});
+            break;
+        }
+    }
+}
+// Argument i is evaluated into register r+i and checked, up to the last one that is not a leaf. Leaves after it
+// are passed as operands and checked by CALL itself, in order.
+void RegisterProgram::compileCall(FunctionCallAST* ast, std::uint32_t r)
+{
+    auto const& args = ast->getArguments();
+    std::uint32_t function = addFunction(ast->getName());
+    useRegister(r);
+
+    std::size_t evaluated = 0;
+    for(std::size_t i=0; i<args.size(); ++i)
+        if(!isLeaf(args[i].get()))
+            evaluated = i + 1;
+
+    std::vector<std::uint32_t> ends;
+    ends.push_back(here() + 3);
+    emit({RI_CALL_TEST, function, r, 0});
+
+    std::vector<std::uint32_t> operands;
+    for(std::size_t i=0; i<args.size(); ++i)
+    {
+        auto* arg = args[i].get();
+        if(i >= evaluated || arg->type == AST_NUMBER)
+        {
+            operands.push_back(compileOperand(arg, r, true));
+            continue;
+        }
+
+        std::uint32_t arg_register = useRegister(r + i);
+        compileValue(arg, arg_register);
+        ends.push_back(here() + 5);
+        emit({RI_ARGUMENT, function, (std::uint32_t)i, arg_register, r, 0});
+        operands.push_back(RK_REGISTER | arg_register);
+    }
+
+    emit({RI_CALL, function, r, (std::uint32_t)operands.size()});
+    code.insert(code.end(), operands.begin(), operands.end());
+    for(auto end: ends)
+        code[end] = here();
+}
+void RegisterProgram::compileStatement(ASTBase* ast)
+{
+    switch(ast->type)
+    {
+        default: {
+            emit({RI_TREE, addTree(ast)});
+            break;
+        }
+        case AST_VARDEF: {
+            auto* def = (VariableDefinitionAST*)ast;
+            std::uint32_t slot = addVariable(def->getName());
+            std::uint32_t end = here() + 2;
+            emit({RI_DEFINE_TEST, slot, 0});
+            emit({RI_DEFINE, slot, compileOperand(def->getValue(), 0, true)});
+            code[end] = here();
+            break;
+        }
+        case AST_VARASSIGN: {
+            auto* assign = (VariableAssignmentAST*)ast;
+            std::uint32_t slot = addVariable(assign->getName());
+            std::uint32_t end = here() + 2;
+            emit({RI_ASSIGN_TEST, slot, 0});
+
+            int op = assign->getShorthandOperator();
+            auto* value = assign->getValue();
+            if(op == T_EOF && value->type == AST_BINOP)
+            {
+                // `a = a + b * 2` computes the product into a register and adds straight into `a`. The target
+                // passed ASSIGN_TEST, so reading it late cannot log.
+                auto* binop = (BinaryOperationAST*)value;
+                auto* left = binop->getLHS();
+                bool fold = isLeaf(binop->getRHS()) || (left->type == AST_VAR && ((VariableAST*)left)->getName() == assign->getName());
+                std::uint32_t lhs = compileOperand(left, 0, fold);
+                std::uint32_t rhs = compileOperand(binop->getRHS(), lhs == RK_REGISTER ? useRegister(1) : 0, true);
+                emit({RI_BINARY_STORE, (std::uint32_t)binop->getOperator(), slot, lhs, rhs});
+            }
+            else
+            {
+                std::uint32_t src = compileOperand(value, 0, true);
+                emit({RI_ASSIGN, slot, (std::uint32_t)op, src});
+            }
+            code[end] = here();
+            break;
+        }
+        case AST_IFELSE: compileIfElse((IfElseAST*)ast); break;
+        case AST_DOFOR: compileDoFor((DoForAST*)ast); break;
+        case AST_CALL: compileCall((FunctionCallAST*)ast, 0); break;
+    }
+}
+void RegisterProgram::compileIfElse(IfElseAST* ast)
+{
+    // Pending lazy bodies are parsed by the tree walker the first time they run
+    bool lazy = ast->getLazyElseBody().isPending();
+    for(auto&& ifstm: ast->getIfStatements())
+        lazy = lazy || ifstm->getLazyBody().isPending();
+    if(lazy)
+    {
+        emit({RI_TREE, addTree(ast)});
+        return;
+    }
+
+    std::vector<std::uint32_t> ends;
+    for(auto&& ifstm: ast->getIfStatements())
+    {
+        std::uint32_t condition = compileOperand(ifstm->getExpression(), 0, true);
+        std::uint32_t next = here() + 2;
+        emit({RI_IF_TEST, condition, 0});
+        for(auto&& stm: ifstm->getBody())
+            compileStatement(stm.get());
+        ends.push_back(here() + 1);
+        emit({RI_JUMP, 0});
+        code[next] = here();
+    }
+    for(auto&& stm: ast->getElseBody())
+        compileStatement(stm.get());
+
+    for(auto end: ends)
+        code[end] = here();
+}
+void RegisterProgram::compileDoFor(DoForAST* ast)
+{
+    std::uint32_t times = compileOperand(ast->getForTimes(), 0, true);
+    std::uint32_t end = here() + 2;
+    emit({RI_LOOP_BEGIN, times, 0});
+    std::uint32_t body = here();
+
+    std::vector<std::uint32_t> aborts;
+    for(auto&& seq: ast->getSequences())
+    {
+        if(seq->type == AST_SEQUENCE)
+        {
+            for(auto&& call: ((SequenceAST*)seq.get())->getBody())
+                compileCall(call.get(), 0);
+        }
+        else if(seq->type == AST_VAR)
+        {
+            aborts.push_back(here() + 2);
+            emit({RI_RUN_SEQUENCE, addVariable(((VariableAST*)seq.get())->getName()), 0});
+        }
+    }
+
+    emit({RI_LOOP_NEXT, body});
+    code[end] = here();
+    for(auto abort: aborts)
+        code[abort] = here();
+}
+
+std::vector<std::uint32_t> const& RegisterProgram::getCode() const
+{
+    return code;
+}
+double const RegisterProgram::getNumber(std::uint32_t index) const
+{
+    return numbers[index];
+}
+std::string const& RegisterProgram::getString(std::uint32_t index) const
+{
+    return strings[index];
+}
+std::vector<std::string> const& RegisterProgram::getVariables() const
+{
+    return variables;
+}
+std::vector<std::string> const& RegisterProgram::getFunctions() const
+{
+    return functions;
+}
+ASTBase* const RegisterProgram::getTree(std::uint32_t index) const
+{
+    return trees[index];
+}
+std::uint32_t const RegisterProgram::getSequenceCallEntry(FunctionCallAST const* call) const
+{
+    auto it = sequence_calls.find(call);
+    if(it == sequence_calls.end())
+        return UINT32_MAX;
+    return it->second;
+}
+std::uint32_t const RegisterProgram::getRegisterCount() const
+{
+    return register_count;
+}
+
+std::unique_ptr<RegisterProgram> RegisterProgram::compile(MainAST* const main)
+{
+    auto program = std::make_unique<RegisterProgram>();
+    for(auto&& stm: main->getBody())
+        program->compileStatement(stm.get());
+    program->emit({RI_RETURN});
+
+    // Arguments can hold further sequence literals, which queue more calls
+    for(std::size_t i=0; i<program->pending_calls.size(); ++i)
+    {
+        auto* call = program->pending_calls[i];
+        program->sequence_calls[call] = program->here();
+        program->compileCall(call, 0);
+        program->emit({RI_RETURN});
+    }
+
+    program->pending_calls.clear();
+    program->number_ids.clear();
+    program->variable_ids.clear();
+    program->function_ids.clear();
+    return program;
+}
+///--- Register Bytecode ---///
+
+///--- Register VM ---///
+RegisterVM::RegisterVM(Interpreter& _interpreter, RegisterProgram const& _program): interpreter(_interpreter), program(_program)
+{
+
+}
+
+void RegisterVM::resolveSlots()
+{
+    auto const& variables = program.getVariables();
+    slots.resize(variables.size());
+    for(std::size_t i=0; i<variables.size(); ++i)
+    {
+        auto it = interpreter.memory.find(variables[i]);
+        slots[i] = it == interpreter.memory.end() ? nullptr : &it->second;
+    }
+}
+// False for anything but a number, without logging
+bool RegisterVM::readNumber(std::uint32_t operand, double& value) const
+{
+    std::uint32_t index = operand & ~RK_MASK;
+    switch(operand & RK_MASK)
+    {
+        case RK_REGISTER: {
+            auto const& reg = registers[index];
+            if(reg.type != VT_NUMBER)
+                return false;
+            value = reg.number;
+            return true;
+        }
+        case RK_VARIABLE: {
+            auto* slot = slots[index];
+            if(!slot || !slot->isNumber())
+                return false;
+            value = slot->getNumber();
+            return true;
+        }
+        default: {
+            value = program.getNumber(index);
+            return true;
+        }
+    }
+}
+// The operand as the tree walker would hold it, moved out of a register. An undefined variable is logged.
+std::unique_ptr<VariableDataBase> RegisterVM::take(std::uint32_t operand)
+{
+    std::uint32_t index = operand & ~RK_MASK;
+    switch(operand & RK_MASK)
+    {
+        case RK_REGISTER: {
+            auto& reg = registers[index];
+            if(reg.type == VT_NUMBER)
+                return std::make_unique<VariableNumberData>(reg.number);
+            reg.type = -1;
+            return std::move(reg.object);
+        }
+        case RK_VARIABLE: {
+            auto* slot = slots[index];
+            if(!slot)
+                return interpreter.LogErrorU(std::string("INTERPRETER: interpretVariable(): Variable `")+program.getVariables()[index]+"` is not defined");
+            return slot->borrow().takeData();
+        }
+        default: {
+            return std::make_unique<VariableNumberData>(program.getNumber(index));
+        }
+    }
+}
+void RegisterVM::store(std::uint32_t r, std::unique_ptr<VariableDataBase> value)
+{
+    if(!value)
+    {
+        storeInvalid(r);
+        return;
+    }
+    if(value->getType() == VT_NUMBER)
+    {
+        storeNumber(r, value->getAsNumber()->getValue());
+        return;
+    }
+    auto& reg = registers[r];
+    reg.type = value->getType();
+    reg.object = std::move(value);
+}
+void RegisterVM::storeNumber(std::uint32_t r, double value)
+{
+    auto& reg = registers[r];
+    reg.type = VT_NUMBER;
+    reg.number = value;
+    reg.object.reset();
+}
+void RegisterVM::storeInvalid(std::uint32_t r)
+{
+    auto& reg = registers[r];
+    reg.type = -1;
+    reg.object.reset();
+}
+// Everything but number operators, through the interpreter
+std::unique_ptr<VariableDataBase> RegisterVM::binary(int op, std::uint32_t lhs, std::uint32_t rhs)
+{
+    auto l = take(lhs);
+    auto r = take(rhs);
+    if(!l || !r)
+        return interpreter.LogErrorU("INTERPRETER: interpretBinaryOperation(): Binary operation has invalid LHS or RHS");
+    return interpreter.useBinaryOperation(op, l.get(), r.get());
+}
+
+#ifdef XEOUZ_COMPUTED_GOTO
+#define VM_CASE(op) label_##op:
+#define VM_NEXT() goto *labels[code[pc]]
+#else
+#define VM_CASE(op) case op:
+#define VM_NEXT() continue
+#endif
+
+void RegisterVM::execute(std::uint32_t pc)
+{
+    std::uint32_t const* code = program.getCode().data();
+    auto const& variables = program.getVariables();
+
+#ifdef XEOUZ_COMPUTED_GOTO
+    static void* const labels[RI_COUNT] = {
+        &&label_RI_MOVE, &&label_RI_STRING, &&label_RI_SEQUENCE, &&label_RI_BINARY, &&label_RI_BINARY_STORE,
+        &&label_RI_DEFINE_TEST, &&label_RI_DEFINE, &&label_RI_ASSIGN_TEST, &&label_RI_ASSIGN,
+        &&label_RI_CALL_TEST, &&label_RI_ARGUMENT, &&label_RI_CALL, &&label_RI_IF_TEST, &&label_RI_JUMP,
+        &&label_RI_LOOP_BEGIN, &&label_RI_LOOP_NEXT, &&label_RI_RUN_SEQUENCE, &&label_RI_TREE, &&label_RI_ERROR,
+        &&label_RI_RETURN,
+    };
+    VM_NEXT();
+#else
+    for(;;)
+    switch(code[pc])
+    {
+#endif
+    VM_CASE(RI_MOVE)
+    {
+        double number;
+        if(readNumber(code[pc+2], number))
+            storeNumber(code[pc+1], number);
+        else
+            store(code[pc+1], take(code[pc+2]));
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_STRING)
+    {
+        store(code[pc+1], std::make_unique<VariableStringData>(program.getString(code[pc+2])));
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_SEQUENCE)
+    {
+        store(code[pc+1], interpreter.interpretSequence((SequenceAST*)program.getTree(code[pc+2])));
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_BINARY)
+    {
+        double l, r;
+        if(readNumber(code[pc+3], l) && readNumber(code[pc+4], r) && applyNumberOperator(code[pc+1], l, r))
+            storeNumber(code[pc+2], l);
+        else
+            store(code[pc+2], binary(code[pc+1], code[pc+3], code[pc+4]));
+        pc += 5;
+        VM_NEXT();
+    }
+    VM_CASE(RI_BINARY_STORE)
+    {
+        auto& value = *slots[code[pc+2]];
+        double l, r;
+        if(value.isNumber() && readNumber(code[pc+3], l) && readNumber(code[pc+4], r) && applyNumberOperator(code[pc+1], l, r))
+            value = Value::createNumber(l);
+        else
+            interpreter.assignVariable(variables[code[pc+2]], binary(code[pc+1], code[pc+3], code[pc+4]), T_EOF);
+        pc += 5;
+        VM_NEXT();
+    }
+    VM_CASE(RI_DEFINE_TEST)
+    {
+        if(slots[code[pc+1]])
+        {
+            interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Variable `)")+variables[code[pc+1]]+"` is already defined");
+            pc = code[pc+2];
+            VM_NEXT();
+        }
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_DEFINE)
+    {
+        std::uint32_t slot = code[pc+1];
+        auto value = take(code[pc+2]);
+        if(!value)
+            interpreter.LogError(std::string("INTERPRETER: interpretVariableDefinition(): Assigned value is undefined in variable definition of `")+variables[slot]+"`");
+        else
+            slots[slot] = &interpreter.memory.emplace(variables[slot], Value::createOwned(std::move(value))).first->second;
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_ASSIGN_TEST)
+    {
+        if(!slots[code[pc+1]])
+        {
+            interpreter.LogError(std::string("INTERPRETER: interpretVariableAssignment(): Variable `)")+variables[code[pc+1]]+"` is not defined");
+            pc = code[pc+2];
+            VM_NEXT();
+        }
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_ASSIGN)
+    {
+        auto& value = *slots[code[pc+1]];
+        int op = code[pc+2];
+        double r;
+        bool done = false;
+        if(value.isNumber() && readNumber(code[pc+3], r))
+        {
+            double l = r;
+            done = true;
+            if(op != T_EOF)
+            {
+                l = value.getNumber();
+                done = applyNumberOperator(op, l, r);
+            }
+            if(done)
+                value = Value::createNumber(l);
+        }
+        if(!done)
+            interpreter.assignVariable(variables[code[pc+1]], take(code[pc+3]), op);
+        pc += 4;
+        VM_NEXT();
+    }
+    VM_CASE(RI_CALL_TEST)
+    {
+        std::uint32_t function = code[pc+1];
+        if(!functions[function])
+        {
+            interpreter.LogError(std::string("INTERPRETER: interpretFunctionCall(): Function `")+program.getFunctions()[function]+"` was not found");
+            storeInvalid(code[pc+2]);
+            pc = code[pc+3];
+            VM_NEXT();
+        }
+        pc += 4;
+        VM_NEXT();
+    }
+    VM_CASE(RI_ARGUMENT)
+    {
+        if(registers[code[pc+3]].type == -1)
+        {
+            interpreter.LogError(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+program.getFunctions()[code[pc+1]]+"`, argument at index "+std::to_string(code[pc+2])+" is invalid");
+            storeInvalid(code[pc+4]);
+            pc = code[pc+5];
+            VM_NEXT();
+        }
+        pc += 6;
+        VM_NEXT();
+    }
+    VM_CASE(RI_CALL)
+    {
+        std::uint32_t function = code[pc+1];
+        std::uint32_t result = code[pc+2];
+        std::uint32_t argc = code[pc+3];
+        std::uint32_t const* operands = code + pc + 4;
+        pc += 4 + argc;
+
+        bool valid = true;
+        for(std::uint32_t i=0; i<argc && valid; ++i)
+        {
+            if((operands[i] & RK_MASK) == RK_VARIABLE && !slots[operands[i] & ~RK_MASK])
+            {
+                take(operands[i]);
+                interpreter.LogError(std::string("INTERPRETER: interpretFunctionCall(): In function call of `")+program.getFunctions()[function]+"`, argument at index "+std::to_string(i)+" is invalid");
+                valid = false;
+            }
+        }
+        if(!valid)
+        {
+            storeInvalid(result);
+            VM_NEXT();
+        }
+
+        std::vector<FCIType> args;
+        args.reserve(argc);
+        for(std::uint32_t i=0; i<argc; ++i)
+            args.push_back(take(operands[i]));
+        store(result, functions[function]->call(std::make_unique<FCICallFunctionArguments>(std::move(args))));
+        VM_NEXT();
+    }
+    VM_CASE(RI_IF_TEST)
+    {
+        double condition;
+        if(readNumber(code[pc+1], condition))
+        {
+            pc = condition > 0 ? pc + 3 : code[pc+2];
+            VM_NEXT();
+        }
+        take(code[pc+1]);
+        interpreter.LogError("INTERPRETER: interpretIf(): Expression in if conditional is not of type number");
+        pc = code[pc+2];
+        VM_NEXT();
+    }
+    VM_CASE(RI_JUMP)
+    {
+        pc = code[pc+1];
+        VM_NEXT();
+    }
+    VM_CASE(RI_LOOP_BEGIN)
+    {
+        double times;
+        if(readNumber(code[pc+1], times))
+        {
+            if(!(0 < times))
+            {
+                pc = code[pc+2];
+                VM_NEXT();
+            }
+            loops.push_back({times, 0});
+            pc += 3;
+            VM_NEXT();
+        }
+        bool valid = take(code[pc+1]) != nullptr;
+        interpreter.LogError(valid ? "INTERPRETER: interpretDoFor(): Value specified in do-for is not of type number" : "INTERPRETER: interpretDoFor(): Value specified in do-for is not of valid");
+        pc = code[pc+2];
+        VM_NEXT();
+    }
+    VM_CASE(RI_LOOP_NEXT)
+    {
+        Loop& loop = loops.back();
+        if(++loop.i < loop.times)
+        {
+            pc = code[pc+1];
+            VM_NEXT();
+        }
+        loops.pop_back();
+        pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(RI_RUN_SEQUENCE)
+    {
+        std::uint32_t slot = code[pc+1];
+        Value* seq = slots[slot];
+        if(!seq)
+            interpreter.LogError(std::string("INTERPRETER: interpretVariable(): Variable `")+variables[slot]+"` is not defined");
+        if(!seq || seq->getType() != VT_SEQUENCE)
+        {
+            interpreter.LogError(!seq ? "INTERPRETER: interpretDoFor(): Sequence variable given is invalid" : "INTERPRETER: interpretDoFor(): Sequence variable given is not of type <sequence>");
+            loops.pop_back();
+            pc = code[pc+2];
+            VM_NEXT();
+        }
+
+        for(auto* call: seq->getSequence()->getValue())
+        {
+            std::uint32_t entry = program.getSequenceCallEntry(call);
+            if(entry == UINT32_MAX)
+                interpreter.interpretFunctionCall(call);
+            else
+                execute(entry);
+        }
+        for(auto call: seq->getSequence()->getPoolCalls())
+            interpreter.interpretPoolFunctionCall(call);
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_TREE)
+    {
+        interpreter.interpretPrimary(program.getTree(code[pc+1]));
+        resolveSlots();
+        pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(RI_ERROR)
+    {
+        interpreter.LogError(program.getString(code[pc+2]));
+        storeInvalid(code[pc+1]);
+        pc += 3;
+        VM_NEXT();
+    }
+    VM_CASE(RI_RETURN)
+    {
+        return;
+    }
+#ifndef XEOUZ_COMPUTED_GOTO
+    }
+#endif
+}
+
+#undef VM_CASE
+#undef VM_NEXT
+
+void RegisterVM::run()
+{
+    resolveSlots();
+    registers.resize(program.getRegisterCount());
+    for(auto& reg: registers)
+        reg.type = -1;
+
+    auto const& names = program.getFunctions();
+    functions.resize(names.size());
+    for(std::size_t i=0; i<names.size(); ++i)
+        functions[i] = interpreter.isFunctionDefined(names[i]) ? interpreter.getFunction(names[i]) : nullptr;
+
+    execute(0);
+    registers.clear();
+    loops.clear();
+}
+
+bool const RegisterVM::usesComputedGoto()
+{
+#ifdef XEOUZ_COMPUTED_GOTO
+    return true;
+#else
+    return false;
+#endif
+}
+///--- Register VM ---///
+
+}
\ No newline at end of file
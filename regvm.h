@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+
+namespace xeouz
+{
+
+class Interpreter;
+class FCIFunction;
+class VariableDataBase;
+class Value;
+
+///--- Register Bytecode ---///
+// Operands name a frame register, a variable slot or a number constant, the kind sits in the top two bits.
+// Variables are folded in as operands only where reading them late cannot reorder what the tree walker logs.
+enum RegisterOperandKind: std::uint32_t
+{
+    RK_REGISTER = 0u << 30,
+    RK_VARIABLE = 1u << 30,
+    RK_NUMBER = 2u << 30,
+    RK_MASK = 3u << 30,
+};
+
+// Registers are written as r, operands as a, b or src.
+//   MOVE         r src                    copy an operand into r
+//   STRING       r s                      r = a copy of strings[s]
+//   SEQUENCE     r t                      r = the calls of trees[t], a SequenceAST
+//   BINARY       op r a b                 r = a op b
+//   BINARY_STORE op v a b                 assign a op b to the defined variable slot v
+//   DEFINE_TEST  v end                    jump to end if slot v is already defined
+//   DEFINE       v src                    define slot v
+//   ASSIGN_TEST  v end                    jump to end if slot v is not defined
+//   ASSIGN       v op src                 assign to slot v, op is the shorthand operator or T_EOF
+//   CALL_TEST    f r end                  r = invalid and jump to end if function f is not registered
+//   ARGUMENT     f i r end                on an invalid argument i in r, log it, leave the call result invalid and jump to end
+//   CALL         f r argc a...            call function f with argc operands, r = the result
+//   IF_TEST      src next                 jump to next unless src is a number above zero
+//   JUMP         to
+//   LOOP_BEGIN   src end                  open a do-for loop of src iterations, jump to end if it runs none
+//   LOOP_NEXT    body                     jump back to body while the innermost loop has iterations left, else close it
+//   RUN_SEQUENCE v end                    run the calls of sequence slot v, on an invalid one close the loop and jump to end
+//   TREE         t                        run trees[t] on the tree walker
+//   ERROR        r s                      log strings[s], r = invalid
+//   RETURN
+enum RegisterOpcode: std::uint32_t
+{
+    RI_MOVE,
+    RI_STRING,
+    RI_SEQUENCE,
+    RI_BINARY,
+    RI_BINARY_STORE,
+    RI_DEFINE_TEST,
+    RI_DEFINE,
+    RI_ASSIGN_TEST,
+    RI_ASSIGN,
+    RI_CALL_TEST,
+    RI_ARGUMENT,
+    RI_CALL,
+    RI_IF_TEST,
+    RI_JUMP,
+    RI_LOOP_BEGIN,
+    RI_LOOP_NEXT,
+    RI_RUN_SEQUENCE,
+    RI_TREE,
+    RI_ERROR,
+    RI_RETURN,
+    RI_COUNT,
+};
+
+class RegisterProgram
+{
+    std::vector<std::uint32_t> code;
+    std::vector<double> numbers;
+    std::vector<std::string> strings;
+    std::vector<std::string> variables;
+    std::vector<std::string> functions;
+    std::vector<ASTBase*> trees;
+    std::unordered_map<FunctionCallAST const*, std::uint32_t> sequence_calls;
+    std::uint32_t register_count;
+
+    std::unordered_map<double, std::uint32_t> number_ids;
+    std::unordered_map<std::string_view, std::uint32_t> variable_ids;
+    std::unordered_map<std::string_view, std::uint32_t> function_ids;
+    std::vector<FunctionCallAST*> pending_calls;
+
+    std::uint32_t const addNumber(double value);
+    std::uint32_t const addString(std::string value);
+    std::uint32_t const addVariable(std::string_view name);
+    std::uint32_t const addFunction(std::string_view name);
+    std::uint32_t const addTree(ASTBase* ast);
+    std::uint32_t const useRegister(std::uint32_t r);
+
+    void emit(std::initializer_list<std::uint32_t> words);
+    std::uint32_t const here() const;
+
+    std::uint32_t const compileOperand(ASTBase* ast, std::uint32_t r, bool fold_variable);
+    void compileValue(ASTBase* ast, std::uint32_t r);
+    void compileCall(FunctionCallAST* ast, std::uint32_t r);
+    void compileStatement(ASTBase* ast);
+    void compileIfElse(IfElseAST* ast);
+    void compileDoFor(DoForAST* ast);
+public:
+    RegisterProgram();
+
+    std::vector<std::uint32_t> const& getCode() const;
+    double const getNumber(std::uint32_t index) const;
+    std::string const& getString(std::uint32_t index) const;
+    std::vector<std::string> const& getVariables() const;
+    std::vector<std::string> const& getFunctions() const;
+    ASTBase* const getTree(std::uint32_t index) const;
+    std::uint32_t const getSequenceCallEntry(FunctionCallAST const* call) const;
+    std::uint32_t const getRegisterCount() const;
+
+    // The program's ASTs have to outlive it, sequences and tree fallbacks point into them
+    static std::unique_ptr<RegisterProgram> compile(MainAST* const main);
+};
+///--- Register Bytecode ---///
+
+///--- Register VM ---///
+struct RegisterValue
+{
+    int type; // -1 for a failed expression
+    double number;
+    std::unique_ptr<VariableDataBase> object;
+};
+
+class RegisterVM
+{
+    Interpreter& interpreter;
+    RegisterProgram const& program;
+
+    std::vector<RegisterValue> registers;
+    std::vector<Value*> slots; // Into the interpreter's memory, nullptr while undefined
+    std::vector<FCIFunction*> functions;
+
+    struct Loop
+    {
+        double times;
+        int i;
+    };
+    std::vector<Loop> loops;
+
+    void resolveSlots();
+    bool readNumber(std::uint32_t operand, double& value) const;
+    std::unique_ptr<VariableDataBase> take(std::uint32_t operand);
+    void store(std::uint32_t r, std::unique_ptr<VariableDataBase> value);
+    void storeNumber(std::uint32_t r, double value);
+    void storeInvalid(std::uint32_t r);
+    std::unique_ptr<VariableDataBase> binary(int op, std::uint32_t lhs, std::uint32_t rhs);
+    void execute(std::uint32_t pc);
+public:
+    RegisterVM(Interpreter& interpreter, RegisterProgram const& program);
+
+    void run();
+
+    // Labels-as-values dispatch, unless the compiler lacks it or XEOUZ_NO_COMPUTED_GOTO is defined
+    static bool const usesComputedGoto();
+};
+///--- Register VM ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "scan.h"
+
+#include <atomic>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__)
+#define XEOUZ_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace xeouz
+{
+
+namespace
+{
+
+struct ScanFunctions
+{
+    int mode;
+    char const* (*skip_whitespace)(char const*, char const*);
+    char const* (*skip_identifier)(char const*, char const*);
+    char const* (*skip_digits)(char const*, char const*);
+    char const* (*find_quote)(char const*, char const*, char);
+};
+
+///--- Scalar ---///
+char const* skipWhitespaceScalar(char const* p, char const* end)
+{
+    while(p < end && isCharClass(*p, CC_SPACE))
+        p++;
+    return p;
+}
+char const* skipIdentifierScalar(char const* p, char const* end)
+{
+    while(p < end && isCharClass(*p, CC_IDENT))
+        p++;
+    return p;
+}
+char const* skipDigitsScalar(char const* p, char const* end)
+{
+    while(p < end && isCharClass(*p, CC_DIGIT))
+        p++;
+    return p;
+}
+char const* findQuoteScalar(char const* p, char const* end, char quote)
+{
+    while(p < end && *p != quote)
+        p++;
+    return p;
+}
+
+ScanFunctions const ScalarScan = {
+    SCAN_SCALAR, skipWhitespaceScalar, skipIdentifierScalar, skipDigitsScalar, findQuoteScalar
+};
+///--- Scalar ---///
+
+#ifdef XEOUZ_SCAN_X86
+///--- SSE2 ---///
+// Signed compare trick for an unsigned range check of every byte: lo <= b <= hi
+inline __m128i inRange128(__m128i v, char lo, char hi)
+{
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x80 + (hi - lo) + 1)));
+}
+inline unsigned whitespaceMask128(__m128i v)
+{
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    return _mm_movemask_epi8(_mm_or_si128(space, inRange128(v, '\t', '\r')));
+}
+inline unsigned identifierMask128(__m128i v)
+{
+    __m128i alpha = inRange128(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    __m128i digit = inRange128(v, '0', '9');
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+
+char const* skipWhitespaceSSE2(char const* p, char const* end)
+{
+    if(p < end && !isCharClass(*p, CC_SPACE)) // Most tokens are not preceded by whitespace at all
+        return p;
+
+    while(end - p >= 16)
+    {
+        unsigned ws = whitespaceMask128(_mm_loadu_si128((__m128i const*)p));
+        if(ws != 0xFFFF)
+            return p + __builtin_ctz(~ws);
+        p += 16;
+    }
+    return skipWhitespaceScalar(p, end);
+}
+char const* skipIdentifierSSE2(char const* p, char const* end)
+{
+    while(end - p >= 16)
+    {
+        unsigned id = identifierMask128(_mm_loadu_si128((__m128i const*)p));
+        if(id != 0xFFFF)
+            return p + __builtin_ctz(~id);
+        p += 16;
+    }
+    return skipIdentifierScalar(p, end);
+}
+char const* skipDigitsSSE2(char const* p, char const* end)
+{
+    while(end - p >= 16)
+    {
+        unsigned digits = _mm_movemask_epi8(inRange128(_mm_loadu_si128((__m128i const*)p), '0', '9'));
+        if(digits != 0xFFFF)
+            return p + __builtin_ctz(~digits);
+        p += 16;
+    }
+    return skipDigitsScalar(p, end);
+}
+char const* findQuoteSSE2(char const* p, char const* end, char quote)
+{
+    __m128i q = _mm_set1_epi8(quote);
+    while(end - p >= 16)
+    {
+        unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)p), q));
+        if(found)
+            return p + __builtin_ctz(found);
+        p += 16;
+    }
+    return findQuoteScalar(p, end, quote);
+}
+
+ScanFunctions const SSE2Scan = {
+    SCAN_SSE2, skipWhitespaceSSE2, skipIdentifierSSE2, skipDigitsSSE2, findQuoteSSE2
+};
+///--- SSE2 ---///
+
+///--- AVX2 ---///
+#define XEOUZ_AVX2 __attribute__((target("avx2")))
+
+XEOUZ_AVX2 inline __m256i inRange256(__m256i v, char lo, char hi)
+{
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + (hi - lo) + 1)), shifted);
+}
+XEOUZ_AVX2 inline unsigned whitespaceMask256(__m256i v)
+{
+    __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    return _mm256_movemask_epi8(_mm256_or_si256(space, inRange256(v, '\t', '\r')));
+}
+XEOUZ_AVX2 inline unsigned identifierMask256(__m256i v)
+{
+    __m256i alpha = inRange256(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    __m256i digit = inRange256(v, '0', '9');
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+}
+
+XEOUZ_AVX2 char const* skipWhitespaceAVX2(char const* p, char const* end)
+{
+    if(p < end && !isCharClass(*p, CC_SPACE))
+        return p;
+
+    while(end - p >= 32)
+    {
+        unsigned ws = whitespaceMask256(_mm256_loadu_si256((__m256i const*)p));
+        if(ws != 0xFFFFFFFFu)
+            return p + __builtin_ctz(~ws);
+        p += 32;
+    }
+    return skipWhitespaceSSE2(p, end);
+}
+XEOUZ_AVX2 char const* skipIdentifierAVX2(char const* p, char const* end)
+{
+    while(end - p >= 32)
+    {
+        unsigned id = identifierMask256(_mm256_loadu_si256((__m256i const*)p));
+        if(id != 0xFFFFFFFFu)
+            return p + __builtin_ctz(~id);
+        p += 32;
+    }
+    return skipIdentifierSSE2(p, end);
+}
+XEOUZ_AVX2 char const* skipDigitsAVX2(char const* p, char const* end)
+{
+    while(end - p >= 32)
+    {
+        unsigned digits = _mm256_movemask_epi8(inRange256(_mm256_loadu_si256((__m256i const*)p), '0', '9'));
+        if(digits != 0xFFFFFFFFu)
+            return p + __builtin_ctz(~digits);
+        p += 32;
+    }
+    return skipDigitsSSE2(p, end);
+}
+XEOUZ_AVX2 char const* findQuoteAVX2(char const* p, char const* end, char quote)
+{
+    __m256i q = _mm256_set1_epi8(quote);
+    while(end - p >= 32)
+    {
+        unsigned found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)p), q));
+        if(found)
+            return p + __builtin_ctz(found);
+        p += 32;
+    }
+    return findQuoteSSE2(p, end, quote);
+}
+
+#undef XEOUZ_AVX2
+
+ScanFunctions const AVX2Scan = {
+    SCAN_AVX2, skipWhitespaceAVX2, skipIdentifierAVX2, skipDigitsAVX2, findQuoteAVX2
+};
+///--- AVX2 ---///
+#endif
+
+ScanFunctions const* selectScanFunctions(int mode)
+{
+#ifdef XEOUZ_SCAN_X86
+    __builtin_cpu_init(); // May run before the constructor that normally does this
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    if(mode == SCAN_AUTO)
+        mode = has_avx2 ? SCAN_AVX2 : SCAN_SSE2;
+    if(mode == SCAN_AVX2 && has_avx2)
+        return &AVX2Scan;
+    if(mode == SCAN_AVX2 || mode == SCAN_SSE2)
+        return &SSE2Scan;
+#endif
+    return &ScalarScan;
+}
+
+std::atomic<ScanFunctions const*> active_scan { selectScanFunctions(SCAN_AUTO) };
+
+inline ScanFunctions const* scanFunctions()
+{
+    return active_scan.load(std::memory_order_relaxed);
+}
+
+}
+
+///--- Scanner ---///
+int const Scanner::setMode(int mode)
+{
+    auto* functions = selectScanFunctions(mode);
+    active_scan.store(functions, std::memory_order_relaxed);
+    return functions->mode;
+}
+int const Scanner::getMode()
+{
+    return scanFunctions()->mode;
+}
+bool const Scanner::isModeSupported(int mode)
+{
+    if(mode == SCAN_AUTO)
+        return true;
+    return selectScanFunctions(mode)->mode == mode;
+}
+
+char const* Scanner::skipWhitespace(char const* p, char const* end)
+{
+    return scanFunctions()->skip_whitespace(p, end);
+}
+char const* Scanner::skipIdentifier(char const* p, char const* end)
+{
+    return scanFunctions()->skip_identifier(p, end);
+}
+char const* Scanner::skipDigits(char const* p, char const* end)
+{
+    return scanFunctions()->skip_digits(p, end);
+}
+char const* Scanner::findQuote(char const* p, char const* end, char quote)
+{
+    return scanFunctions()->find_quote(p, end, quote);
+}
+///--- Scanner ---///
+
+}
\ No newline at end of file
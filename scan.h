@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace xeouz
+{
+
+///--- Character Classes ---///
+enum CharClass
+{
+    CC_SPACE   = 1 << 0,
+    CC_NEWLINE = 1 << 1,
+    CC_ALPHA   = 1 << 2, // Letters and `_`, anything that may start an identifier
+    CC_DIGIT   = 1 << 3,
+    CC_IDENT   = 1 << 4, // Letters, digits and `_`
+    CC_QUOTE   = 1 << 5,
+};
+
+constexpr std::array<unsigned char, 256> makeCharClassTable()
+{
+    std::array<unsigned char, 256> table {};
+    for(int c=0; c<256; ++c)
+    {
+        unsigned char cls = 0;
+        if(c == ' ' || (c >= '\t' && c <= '\r'))
+            cls |= CC_SPACE;
+        if(c == '\n')
+            cls |= CC_NEWLINE;
+        if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+            cls |= CC_ALPHA | CC_IDENT;
+        if(c >= '0' && c <= '9')
+            cls |= CC_DIGIT | CC_IDENT;
+        if(c == '"' || c == '\'')
+            cls |= CC_QUOTE;
+        table[c] = cls;
+    }
+    return table;
+}
+
+// Matches the "C" locale behaviour of isspace/isalpha/isdigit/isalnum
+inline constexpr std::array<unsigned char, 256> CharClassTable = makeCharClassTable();
+
+inline bool isCharClass(char c, int cls)
+{
+    return CharClassTable[(unsigned char)c] & cls;
+}
+///--- Character Classes ---///
+
+///--- Scanner ---///
+enum ScanMode
+{
+    SCAN_AUTO,
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+};
+
+// Span scanners used by the Lexer. Every function returns a pointer to the first
+// byte at or after `p` that ends the run, or `end` if the run reaches it.
+// All modes produce identical results; the SIMD ones only look at more bytes at once.
+class Scanner
+{
+public:
+    static int const setMode(int mode);
+    static int const getMode();
+    static bool const isModeSupported(int mode);
+
+    static char const* skipWhitespace(char const* p, char const* end);
+    static char const* skipIdentifier(char const* p, char const* end);
+    static char const* skipDigits(char const* p, char const* end);
+    static char const* findQuote(char const* p, char const* end, char quote);
+};
+///--- Scanner ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include "source.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define XEOUZ_HAS_MMAP 1
+#endif
+
+namespace xeouz
+{
+
+///--- Source Buffer ---///
+SourceBuffer::SourceBuffer(): mapping(nullptr), mapping_length(0)
+{
+
+}
+SourceBuffer::~SourceBuffer()
+{
+#ifdef XEOUZ_HAS_MMAP
+    if(mapping)
+        munmap(mapping, mapping_length);
+#endif
+}
+
+std::string_view SourceBuffer::getText() const
+{
+    return text;
+}
+std::size_t const SourceBuffer::getLength() const
+{
+    return text.length();
+}
+bool const SourceBuffer::isMapped() const
+{
+    return mapping != nullptr;
+}
+
+std::unique_ptr<SourceBuffer> SourceBuffer::copy(std::string const& text)
+{
+    auto source = std::make_unique<SourceBuffer>();
+    source->owned_text = text;
+    source->text = source->owned_text;
+    return source;
+}
+std::unique_ptr<SourceBuffer> SourceBuffer::borrow(std::string_view text)
+{
+    auto source = std::make_unique<SourceBuffer>();
+    source->text = text;
+    return source;
+}
+std::unique_ptr<SourceBuffer> SourceBuffer::map(std::string const& path)
+{
+#ifdef XEOUZ_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cout << "SOURCE: map(): Could not open file `" << path << "`" << std::endl;
+        return nullptr;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        std::cout << "SOURCE: map(): Could not stat file `" << path << "`" << std::endl;
+        return nullptr;
+    }
+
+    auto source = std::make_unique<SourceBuffer>();
+    if(st.st_size == 0) // mmap does not accept empty ranges
+    {
+        close(fd);
+        return source;
+    }
+
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED)
+    {
+        std::cout << "SOURCE: map(): Could not map file `" << path << "`" << std::endl;
+        return nullptr;
+    }
+
+    source->mapping = addr;
+    source->mapping_length = st.st_size;
+    source->text = std::string_view((char const*)addr, st.st_size);
+    return source;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+    {
+        std::cout << "SOURCE: map(): Could not open file `" << path << "`" << std::endl;
+        return nullptr;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return copy(contents.str());
+#endif
+}
+///--- Source Buffer ---///
+
+///--- Line Table ---///
+LineTable::LineTable(): line_starts(1, 0), scanned(0)
+{
+
+}
+
+void LineTable::clear()
+{
+    line_starts.assign(1, 0);
+    scanned = 0;
+}
+// Records the lines starting in the part of `text` (found at `text_offset` in the source) not scanned yet
+void LineTable::extend(std::string_view text, std::size_t text_offset)
+{
+    std::size_t text_end = text_offset + text.length();
+    if(scanned >= text_end || scanned < text_offset)
+        return;
+
+    char const* p = text.data() + (scanned - text_offset);
+    char const* end = text.data() + text.length();
+    while((p = (char const*)std::memchr(p, '\n', end - p)))
+    {
+        p++;
+        line_starts.push_back(text_offset + (p - text.data()));
+    }
+    scanned = text_end;
+}
+SourceLocation LineTable::resolve(std::uint32_t offset) const
+{
+    auto next = std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+    std::uint32_t line = (next - line_starts.begin()) - 1;
+    return SourceLocation { line, offset - line_starts[line] };
+}
+std::size_t const LineTable::getLineCount() const
+{
+    return line_starts.size();
+}
+///--- Line Table ---///
+
+///--- Source Stream ---///
+std::unique_ptr<SourceStream> SourceStream::fromStream(std::istream& in)
+{
+    return std::make_unique<IStreamSource>(in);
+}
+std::unique_ptr<SourceStream> SourceStream::fromFileDescriptor(int fd, bool close_on_destroy)
+{
+    return std::make_unique<FileDescriptorSource>(fd, close_on_destroy);
+}
+std::unique_ptr<SourceStream> SourceStream::fromText(std::string_view text)
+{
+    return std::make_unique<TextSource>(text);
+}
+
+IStreamSource::IStreamSource(std::istream& _in): in(_in)
+{
+
+}
+std::size_t IStreamSource::read(char* buffer, std::size_t size)
+{
+    if(size == 0 || !in.read(buffer, 1))
+        return 0;
+
+    // Only wait for the first byte, take whatever else is already buffered
+    std::streamsize count = in.readsome(buffer + 1, size - 1);
+    return 1 + (count > 0 ? count : 0);
+}
+
+TextSource::TextSource(std::string_view _text): text(_text), position(0)
+{
+
+}
+std::size_t TextSource::read(char* buffer, std::size_t size)
+{
+    std::size_t count = std::min(size, text.length() - position);
+    std::memcpy(buffer, text.data() + position, count);
+    position += count;
+    return count;
+}
+
+FileDescriptorSource::FileDescriptorSource(int _fd, bool _close_on_destroy): fd(_fd), close_on_destroy(_close_on_destroy)
+{
+
+}
+FileDescriptorSource::~FileDescriptorSource()
+{
+#ifdef XEOUZ_HAS_MMAP
+    if(close_on_destroy && fd >= 0)
+        close(fd);
+#endif
+}
+std::size_t FileDescriptorSource::read(char* buffer, std::size_t size)
+{
+#ifdef XEOUZ_HAS_MMAP
+    while(true)
+    {
+        ssize_t count = ::read(fd, buffer, size);
+        if(count >= 0)
+            return count;
+        if(errno != EINTR)
+        {
+            std::cout << "SOURCE: read(): Could not read from file descriptor " << fd << std::endl;
+            return 0;
+        }
+    }
+#else
+    std::cout << "SOURCE: read(): File descriptors are not supported on this platform" << std::endl;
+    return 0;
+#endif
+}
+///--- Source Stream ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <istream>
+#include <vector>
+#include <cstdint>
+
+namespace xeouz
+{
+
+///--- Source Buffer ---///
+// Immutable program text handed to the Lexer. The text is either an owned copy,
+// a borrowed view (the caller keeps it alive for as long as the Lexer, its
+// Parser and any Tokens exist) or a read-only memory mapping of a file.
+class SourceBuffer
+{
+    std::string owned_text;
+    std::string_view text;
+
+    void* mapping;
+    std::size_t mapping_length;
+public:
+    SourceBuffer();
+    ~SourceBuffer();
+
+    SourceBuffer(SourceBuffer const&) = delete;
+    SourceBuffer& operator=(SourceBuffer const&) = delete;
+
+    std::string_view getText() const;
+    std::size_t const getLength() const;
+    bool const isMapped() const;
+
+    static std::unique_ptr<SourceBuffer> copy(std::string const& text);
+    static std::unique_ptr<SourceBuffer> borrow(std::string_view text);
+    static std::unique_ptr<SourceBuffer> map(std::string const& path);
+};
+///--- Source Buffer ---///
+
+///--- Line Table ---///
+// Zero-based line and column of a source offset
+struct SourceLocation
+{
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+// Start offsets of the lines of one source. Tokens and AST nodes only keep a
+// 32-bit offset, the table is filled in from the text when a location is needed.
+class LineTable
+{
+    std::vector<std::uint32_t> line_starts;
+    std::size_t scanned;
+public:
+    LineTable();
+
+    void clear();
+    void extend(std::string_view text, std::size_t text_offset=0);
+    SourceLocation resolve(std::uint32_t offset) const;
+    std::size_t const getLineCount() const;
+};
+///--- Line Table ---///
+
+///--- Source Stream ---///
+// Program text that arrives over time, read by a streaming Lexer in chunks.
+// `read` blocks until at least one byte is available and returns 0 only once
+// the input has ended, short reads are normal for pipes and terminals.
+class SourceStream
+{
+public:
+    virtual ~SourceStream() {}
+
+    virtual std::size_t read(char* buffer, std::size_t size) = 0;
+
+    static std::unique_ptr<SourceStream> fromStream(std::istream& in);
+    static std::unique_ptr<SourceStream> fromFileDescriptor(int fd, bool close_on_destroy=false);
+    static std::unique_ptr<SourceStream> fromText(std::string_view text);
+};
+
+class IStreamSource: public SourceStream
+{
+    std::istream& in;
+public:
+    IStreamSource(std::istream& in);
+
+    std::size_t read(char* buffer, std::size_t size);
+};
+
+// Borrowed text handed out in chunks, the Lexer only tokenizes as far as its Parser asks
+class TextSource: public SourceStream
+{
+    std::string_view text;
+    std::size_t position;
+public:
+    TextSource(std::string_view text);
+
+    std::size_t read(char* buffer, std::size_t size);
+};
+
+class FileDescriptorSource: public SourceStream
+{
+    int fd;
+    bool close_on_destroy;
+public:
+    FileDescriptorSource(int fd, bool close_on_destroy);
+    ~FileDescriptorSource();
+
+    std::size_t read(char* buffer, std::size_t size);
+};
+///--- Source Stream ---///
+
+}
\ No newline at end of file
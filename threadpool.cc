@@ -0,0 +1,79 @@
+#include "threadpool.h"
+
+namespace xeouz
+{
+
+///--- Thread Pool ---///
+ThreadPool::ThreadPool(std::size_t thread_count): pending(0), stopping(false)
+{
+    if(thread_count == 0)
+        thread_count = std::thread::hardware_concurrency();
+    if(thread_count == 0)
+        thread_count = 1;
+
+    workers.reserve(thread_count);
+    for(std::size_t i=0; i<thread_count; ++i)
+        workers.emplace_back([this]() { runWorker(); });
+}
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+
+    for(auto& worker: workers)
+        worker.join();
+}
+
+void ThreadPool::runWorker()
+{
+    while(true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            task_ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if(tasks.empty())
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--pending == 0)
+            tasks_done.notify_all();
+    }
+}
+
+std::size_t const ThreadPool::getThreadCount() const
+{
+    return workers.size();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+        pending++;
+    }
+    task_ready.notify_one();
+}
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks_done.wait(lock, [this]() { return pending == 0; });
+}
+
+std::unique_ptr<ThreadPool> ThreadPool::create(std::size_t thread_count)
+{
+    return std::make_unique<ThreadPool>(thread_count);
+}
+///--- Thread Pool ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace xeouz
+{
+
+///--- Thread Pool ---///
+// Fixed set of worker threads running submitted tasks in FIFO order.
+// `wait` blocks until every task submitted so far has finished.
+class ThreadPool
+{
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    std::condition_variable tasks_done;
+    std::size_t pending;
+    bool stopping;
+
+    void runWorker();
+public:
+    ThreadPool(std::size_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    std::size_t const getThreadCount() const;
+
+    void submit(std::function<void()> task);
+    void wait();
+
+    static std::unique_ptr<ThreadPool> create(std::size_t thread_count = 0);
+};
+///--- Thread Pool ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "tier.h"
+#include "interpret.h"
+
+namespace xeouz
+{
+
+///--- Tiering ---///
+TierSequence::TierSequence(std::vector<FunctionCallAST*> _calls): calls(std::move(_calls)), runs(0), state(TS_COLD)
+{
+
+}
+
+bool const TierSequence::isReady() const
+{
+    return state.load(std::memory_order_acquire) == TS_READY;
+}
+ClosureProgram* const TierSequence::getProgram() const
+{
+    return program.get();
+}
+
+std::shared_ptr<TierSequence> TierSequence::create(std::vector<FunctionCallAST*> calls)
+{
+    return std::make_shared<TierSequence>(std::move(calls));
+}
+
+TierManager::TierManager(Interpreter& _interpreter): interpreter(_interpreter), pool(ThreadPool::create(1)), threshold(64), promoted(0), switched(0)
+{
+
+}
+TierManager::~TierManager()
+{
+    pool->wait();
+}
+
+std::uint32_t const TierManager::getHotThreshold() const
+{
+    return threshold;
+}
+void TierManager::setHotThreshold(std::uint32_t new_threshold)
+{
+    threshold = new_threshold;
+}
+TierStats const TierManager::getStats() const
+{
+    return TierStats{promoted.load(), switched};
+}
+
+// A compile that finds its sequence no longer queued was dropped by finish()
+void TierManager::promote(std::shared_ptr<TierSequence> const& seq)
+{
+    seq->state.store(TS_QUEUED);
+    pool->submit([this, seq]() {
+        int expected = TS_QUEUED;
+        if(!seq->state.compare_exchange_strong(expected, TS_COMPILING))
+            return;
+        seq->program = ClosureProgram::compileCalls(interpreter, seq->calls);
+        seq->state.store(TS_READY, std::memory_order_release);
+        promoted++;
+    });
+}
+bool TierManager::runSequence(std::shared_ptr<TierSequence> const& seq, std::vector<std::shared_ptr<TierSequence>>& queued)
+{
+    if(seq->isReady())
+    {
+        seq->program->run();
+        return true;
+    }
+
+    for(auto* call: seq->calls)
+        interpreter.interpretFunctionCall(call);
+    if(seq->state.load() == TS_COLD && ++seq->runs >= threshold)
+    {
+        promote(seq);
+        queued.push_back(seq);
+    }
+    return false;
+}
+// The loop's ASTs may be released after it, so no compile it queued is left running
+void TierManager::finish(std::vector<std::shared_ptr<TierSequence>>& queued)
+{
+    if(queued.empty())
+        return;
+    for(auto& seq: queued)
+    {
+        int expected = TS_QUEUED;
+        seq->state.compare_exchange_strong(expected, TS_COLD);
+    }
+    pool->wait();
+    queued.clear();
+}
+
+VariableDataBase* const TierManager::runDoFor(DoForAST* const ast, double times)
+{
+    auto const& sequences = ast->getSequences();
+    std::vector<std::shared_ptr<TierSequence>> literals(sequences.size());
+    std::vector<std::shared_ptr<TierSequence>> tiers(sequences.size());
+    std::vector<VariableSequenceData*> values(sequences.size(), nullptr);
+    std::vector<std::shared_ptr<TierSequence>> queued;
+
+    for(int i=0; i<times; ++i)
+    {
+        bool compiled = true;
+        for(std::size_t k=0; k<sequences.size(); ++k)
+        {
+            auto* seq = sequences[k].get();
+            if(seq->type == AST_SEQUENCE)
+            {
+                if(!literals[k])
+                {
+                    std::vector<FunctionCallAST*> calls;
+                    for(auto&& call: ((SequenceAST*)seq)->getBody())
+                        calls.push_back(call.get());
+                    literals[k] = TierSequence::create(std::move(calls));
+                }
+                tiers[k] = literals[k];
+            }
+            else if(seq->type == AST_VAR)
+            {
+                auto* var = interpreter.interpretVariable((VariableAST*)seq);
+                if(!var)
+                {
+                    finish(queued);
+                    return interpreter.LogError("INTERPRETER: interpretDoFor(): Sequence variable given is invalid");
+                }
+                else if(var->getType() != VT_SEQUENCE)
+                {
+                    finish(queued);
+                    return interpreter.LogError("INTERPRETER: interpretDoFor(): Sequence variable given is not of type <sequence>");
+                }
+
+                values[k] = var->getSequence();
+                if(!values[k]->getTier())
+                    values[k]->setTier(TierSequence::create(values[k]->getValue()));
+                tiers[k] = values[k]->getTier();
+            }
+            else
+            {
+                finish(queued);
+                return interpreter.LogError("INTERPRETER: interpretDoFor(): Sequence given is invalid");
+            }
+
+            compiled = runSequence(tiers[k], queued) && compiled;
+            if(values[k])
+                for(auto call: values[k]->getPoolCalls())
+                    interpreter.interpretPoolFunctionCall(call);
+        }
+
+        // On-stack replacement: every sequence ran on its closures this iteration, so their slots are resolved and
+        // the variables are known to hold them. Only calls run from here on, neither can change.
+        if(!compiled || i+1 >= times)
+            continue;
+        ++switched;
+        for(++i; i<times; ++i)
+        {
+            for(std::size_t k=0; k<sequences.size(); ++k)
+            {
+                tiers[k]->program->run();
+                if(values[k])
+                    for(auto call: values[k]->getPoolCalls())
+                        interpreter.interpretPoolFunctionCall(call);
+            }
+        }
+    }
+
+    finish(queued);
+    return nullptr;
+}
+
+std::unique_ptr<TierManager> TierManager::create(Interpreter& interpreter)
+{
+    return std::make_unique<TierManager>(interpreter);
+}
+///--- Tiering ---///
+
+}
\ No newline at end of file
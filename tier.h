@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ast.h"
+#include "closure.h"
+#include "threadpool.h"
+
+namespace xeouz
+{
+
+class Interpreter;
+class VariableDataBase;
+
+///--- Tiering ---///
+enum TierState
+{
+    TS_COLD, // Runs on the tree walker and counts
+    TS_QUEUED, // Hot, waiting for the background compile
+    TS_COMPILING,
+    TS_READY, // Runs its closures
+};
+
+// The calls of one sequence, with how often the tree walker ran them. Kept by the sequence value, so the count
+// carries over between the do-for loops running it.
+class TierSequence
+{
+    friend class TierManager;
+
+    std::vector<FunctionCallAST*> calls;
+    std::uint32_t runs;
+    std::atomic<int> state;
+    std::unique_ptr<ClosureProgram> program; // Written by the background compile before it sets TS_READY
+public:
+    TierSequence(std::vector<FunctionCallAST*> calls);
+
+    bool const isReady() const;
+    ClosureProgram* const getProgram() const;
+
+    static std::shared_ptr<TierSequence> create(std::vector<FunctionCallAST*> calls);
+};
+
+struct TierStats
+{
+    std::size_t promoted; // Sequences compiled in the background
+    std::size_t switched; // Do-for loops that moved to the closures between two iterations
+};
+
+// Tiered execution of do-for loops for the tree walker. Sequences start on the tree walker, once one ran
+// `threshold` times it is compiled to closures on a background thread and the walker uses them from its next
+// run on. A loop whose sequences are all compiled runs its remaining iterations on the closures alone.
+class TierManager
+{
+    Interpreter& interpreter;
+    std::unique_ptr<ThreadPool> pool;
+    std::uint32_t threshold;
+    std::atomic<std::size_t> promoted;
+    std::size_t switched;
+
+    void promote(std::shared_ptr<TierSequence> const& seq);
+    // Runs `seq` on whichever tier it is in, true when that was its closures
+    bool runSequence(std::shared_ptr<TierSequence> const& seq, std::vector<std::shared_ptr<TierSequence>>& queued);
+    void finish(std::vector<std::shared_ptr<TierSequence>>& queued);
+public:
+    TierManager(Interpreter& interpreter);
+    ~TierManager();
+
+    std::uint32_t const getHotThreshold() const;
+    void setHotThreshold(std::uint32_t threshold);
+    TierStats const getStats() const;
+
+    // The loop of Interpreter::interpretDoFor after `times` was evaluated, with its messages. Compiles queued by
+    // the loop do not outlive it, ones that have not started by the end are dropped and queued again later.
+    VariableDataBase* const runDoFor(DoForAST* const ast, double times);
+
+    static std::unique_ptr<TierManager> create(Interpreter& interpreter);
+};
+///--- Tiering ---///
+
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "value.h"
+#include "interpret.h"
+
+namespace xeouz
+{
+
+///--- Value ---///
+void Value::release()
+{
+    delete getData();
+    bits = Value().bits;
+}
+
+int const Value::getType() const
+{
+    switch(getTag())
+    {
+        case TAG_NUMBER: return VT_NUMBER;
+        case TAG_VOID: return VT_VOID;
+        case TAG_BORROWED:
+        case TAG_OWNED: return getData()->getType();
+        default: return -1;
+    }
+}
+VariableStringData* const Value::getString() const
+{
+    return (VariableStringData*)getData();
+}
+VariableSequenceData* const Value::getSequence() const
+{
+    return (VariableSequenceData*)getData();
+}
+
+Value Value::borrow() const
+{
+    int tag = getTag();
+    return tag == TAG_OWNED ? box(TAG_BORROWED, getData()) : Value(bits);
+}
+std::unique_ptr<VariableDataBase> Value::takeData()
+{
+    std::unique_ptr<VariableDataBase> data;
+    switch(getTag())
+    {
+        case TAG_NUMBER: data = VariableNumberData::create(getNumber()); break;
+        case TAG_VOID: data = VariableVoidData::create(); break;
+        case TAG_BORROWED: data.reset(VariableDataBase::copyByType(getData())); break;
+        case TAG_OWNED: data.reset(getData()); break;
+        default: return nullptr;
+    }
+    bits = Value().bits;
+    return data;
+}
+
+Value Value::take()
+{
+    if(getTag() != TAG_BORROWED)
+        return std::move(*this);
+    Value owned = box(TAG_OWNED, VariableDataBase::copyByType(getData()));
+    bits = Value().bits;
+    return owned;
+}
+
+Value Value::createVoid()
+{
+    return box(TAG_VOID, nullptr);
+}
+Value Value::createBorrowed(VariableDataBase* data)
+{
+    if(!data)
+        return Value();
+    switch(data->getType())
+    {
+        case VT_NUMBER: return createNumber(data->getAsNumber()->getValue());
+        case VT_VOID: return createVoid();
+        default: return box(TAG_BORROWED, data);
+    }
+}
+Value Value::createOwned(std::unique_ptr<VariableDataBase> data)
+{
+    if(!data)
+        return Value();
+    switch(data->getType())
+    {
+        case VT_NUMBER: return createNumber(data->getAsNumber()->getValue());
+        case VT_VOID: return createVoid();
+        default: return box(TAG_OWNED, data.release());
+    }
+}
+///--- Value ---///
+
+}
\ No newline at end of file
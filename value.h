@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace xeouz
+{
+
+class VariableDataBase;
+class VariableStringData;
+class VariableSequenceData;
+
+///--- Value ---///
+// A value of the tree walker in 64 bits. A number is its own double, anything else is a negative quiet NaN with a
+// tag in bits 48-50 and, for strings and sequences, their VariableDataBase in the low 48 bits. That object is
+// either owned by the value or borrowed from a variable, which then has to outlive it.
+class Value
+{
+    enum Tag
+    {
+        TAG_NUMBER,
+        TAG_UNDEFINED, // A failed expression, where the VariableDataBase interface has nullptr
+        TAG_VOID,
+        TAG_BORROWED,
+        TAG_OWNED,
+    };
+
+    static constexpr std::uint64_t boxed = 0xFFF8000000000000; // Sign and quiet NaN bits, itself the NaN arithmetic produces
+    static constexpr std::uint64_t tag_shift = 48;
+    static constexpr std::uint64_t pointer_mask = 0x0000FFFFFFFFFFFF;
+
+    std::uint64_t bits;
+
+    explicit Value(std::uint64_t _bits): bits(_bits) {}
+    static Value box(int tag, VariableDataBase* data)
+    {
+        return Value(boxed | ((std::uint64_t)tag << tag_shift) | ((std::uint64_t)data & pointer_mask));
+    }
+    int const getTag() const
+    {
+        return bits < (boxed | ((std::uint64_t)TAG_UNDEFINED << tag_shift)) ? TAG_NUMBER : (int)((bits >> tag_shift) & 7);
+    }
+    void release();
+public:
+    Value(): bits(boxed | ((std::uint64_t)TAG_UNDEFINED << tag_shift)) {}
+    Value(Value&& other) noexcept: bits(other.bits)
+    {
+        other.bits = Value().bits;
+    }
+    Value& operator=(Value&& other) noexcept
+    {
+        if(this != &other)
+        {
+            if(isOwned())
+                release();
+            bits = other.bits;
+            other.bits = Value().bits;
+        }
+        return *this;
+    }
+    Value(Value const&) = delete;
+    Value& operator=(Value const&) = delete;
+    ~Value()
+    {
+        if(isOwned())
+            release();
+    }
+
+    bool const isDefined() const { return getTag() != TAG_UNDEFINED; }
+    bool const isNumber() const { return getTag() == TAG_NUMBER; }
+    bool const isVoid() const { return getTag() == TAG_VOID; }
+    bool const isOwned() const { return getTag() == TAG_OWNED; }
+    explicit operator bool() const { return isDefined(); }
+
+    int const getType() const; // A VariableDataType, -1 while undefined
+    double const getNumber() const
+    {
+        double number;
+        std::memcpy(&number, &bits, sizeof(number));
+        return number;
+    }
+    // The heap object of a string or sequence, nullptr for anything else
+    VariableDataBase* const getData() const
+    {
+        int tag = getTag();
+        return tag == TAG_BORROWED || tag == TAG_OWNED ? (VariableDataBase*)(bits & pointer_mask) : nullptr;
+    }
+    VariableStringData* const getString() const;
+    VariableSequenceData* const getSequence() const;
+
+    Value borrow() const; // The same value, not owning a heap object
+    // Adapter to the VariableDataBase interface, the value is left undefined. A number or void is boxed, an owned
+    // object handed over and a borrowed one copied.
+    std::unique_ptr<VariableDataBase> takeData();
+    // The value to store in a variable, this one is left undefined. A borrowed object is copied.
+    Value take();
+
+    static Value createNumber(double number)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        return Value(bits > boxed ? boxed : bits); // A negative NaN with a payload loses it
+    }
+    static Value createVoid();
+    static Value createBorrowed(VariableDataBase* data); // Numbers and void are copied in, nullptr is undefined
+    static Value createOwned(std::unique_ptr<VariableDataBase> data); // Same, freeing a number or void
+};
+///--- Value ---///
+
+}
\ No newline at end of file